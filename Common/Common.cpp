@@ -1,6 +1,7 @@
 #include "Common.h"
 #include <filesystem>
 #include <iostream>
+#include <cwchar>
 
 int FindDemoMediaFileAbsPath(
   const wchar_t *filePathSuffix,
@@ -55,3 +56,17 @@ int FindDemoMediaFileAbsPath(
   return ret;
 }
 
+
+#ifndef _WIN32
+int _wfopen_s(
+  FILE **ppFile,
+  const wchar_t *pszFileName,
+  const wchar_t *pszMode
+) {
+  std::string fileName = std::filesystem::path(pszFileName).string();
+  std::string mode = std::filesystem::path(pszMode).string();
+
+  *ppFile = fopen(fileName.c_str(), mode.c_str());
+  return *ppFile ? 0 : -1;
+}
+#endif
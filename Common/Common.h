@@ -1,7 +1,64 @@
 #pragma once
 #include <cstdlib>
+#include <cstdio>
 #include <string>
 
+#ifndef _WIN32
+/// Stand-ins for the MSVC specific staffs used across the samples.
+#include <cassert>
+#include <strings.h>
+
+#ifndef _countof
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+#ifndef _stricmp
+#define _stricmp strcasecmp
+#endif
+#ifndef _ASSERT
+#define _ASSERT(x) assert(x)
+#endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef _In_
+#define _In_
+#endif
+#ifndef _In_z_
+#define _In_z_
+#endif
+#ifndef _In_opt_
+#define _In_opt_
+#endif
+#ifndef _Out_
+#define _Out_
+#endif
+#ifndef _Out_opt_
+#define _Out_opt_
+#endif
+#ifndef _Inout_opt_
+#define _Inout_opt_
+#endif
+
+#ifndef fread_s
+#define fread_s(buffer, bufferSize, elementSize, count, stream)                                    \
+  fread(buffer, elementSize, count, stream)
+#endif
+
+extern
+int _wfopen_s(
+  FILE **ppFile,
+  const wchar_t *pszFileName,
+  const wchar_t *pszMode
+);
+#endif
+
 extern
 int FindDemoMediaFileAbsPath(
   const wchar_t *filePathSuffix,
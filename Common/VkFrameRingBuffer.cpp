@@ -0,0 +1,108 @@
+#include "VkFrameRingBuffer.h"
+#include <algorithm>
+#include <string.h>
+
+VkFrameRingBuffer::VkFrameRingBuffer() {
+  m_pBuffer = VK_NULL_HANDLE;
+  m_pBufferMem = nullptr;
+  m_pMappedData = nullptr;
+  m_cbPerFrame = 0;
+  m_cbMaxRange = 0;
+  m_uFrameBase = 0;
+  m_uFrameOffset = 0;
+  m_cbPeak = 0;
+}
+
+VkFrameRingBuffer::~VkFrameRingBuffer() {
+  _ASSERT(!m_pBufferMem && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkFrameRingBuffer::Create(
+  VkDevice pDevice,
+  uint32_t uFrameCount,
+  VkDeviceSize cbPerFrame,
+  VkDeviceSize cbMaxRange
+) {
+  VKHRESULT hr;
+
+  m_cbPerFrame = CalcUniformBufferByteSize((uint32_t)cbPerFrame);
+  m_cbMaxRange = cbMaxRange;
+  /// Dynamic offsets are 32-bit.
+  V_RETURN(!((m_cbPerFrame * uFrameCount + m_cbMaxRange <= UINT32_MAX) &&
+             !!("The frame regions don't fit in 32-bit offsets!")));
+
+  V_RETURN(CreateUploadBuffer(pDevice, m_cbPerFrame * uFrameCount + m_cbMaxRange,
+                              VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &m_pBuffer, &m_pBufferMem,
+                              (void **)&m_pMappedData, VkMemoryCategory::Uniforms));
+
+  m_uFrameBase = 0;
+  m_uFrameOffset = 0;
+  m_cbPeak = 0;
+
+  return hr;
+}
+
+void VkFrameRingBuffer::Destroy() {
+  if (m_pBufferMem) {
+    DestroyVmaBuffer(m_pBuffer, m_pBufferMem);
+    m_pBuffer = VK_NULL_HANDLE;
+    m_pBufferMem = nullptr;
+    m_pMappedData = nullptr;
+  }
+}
+
+void VkFrameRingBuffer::ResetFrame(uint32_t uFrameIndex) {
+  m_cbPeak = std::max(m_cbPeak, GetFrameUsedBytes());
+  m_uFrameBase = m_cbPerFrame * uFrameIndex;
+  m_uFrameOffset = 0;
+}
+
+VKHRESULT VkFrameRingBuffer::Allocate(size_t cbSize, uint32_t *puOffset, void **ppData) {
+  VkDeviceSize cbAligned = CalcUniformBufferByteSize((uint32_t)cbSize);
+  VkDeviceSize uOffset = m_uFrameOffset.fetch_add(cbAligned);
+
+  *puOffset = 0;
+  *ppData = nullptr;
+
+  /// Exhausted, the offset stays past the end and fails the later allocations as well.
+  if (uOffset + cbAligned > m_cbPerFrame)
+    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+  *puOffset = (uint32_t)(m_uFrameBase + uOffset);
+  *ppData = m_pMappedData + m_uFrameBase + uOffset;
+
+  return VK_SUCCESS;
+}
+
+VKHRESULT VkFrameRingBuffer::Push(const void *pData, size_t cbSize, uint32_t *puOffset) {
+  VKHRESULT hr;
+  void *pDest;
+
+  hr = Allocate(cbSize, puOffset, &pDest);
+  if (VK_FAILED(hr))
+    return hr;
+  memcpy(pDest, pData, cbSize);
+
+  return hr;
+}
+
+VkBuffer VkFrameRingBuffer::GetBuffer() const {
+  return m_pBuffer;
+}
+
+VkDescriptorBufferInfo VkFrameRingBuffer::GetDescriptorInfo(VkDeviceSize cbRange) const {
+  _ASSERT(cbRange <= m_cbMaxRange && "Dynamic offsets may overflow the buffer!");
+  return VkDescriptorBufferInfo{m_pBuffer, 0, cbRange};
+}
+
+VkDeviceSize VkFrameRingBuffer::GetFrameUsedBytes() const {
+  return std::min(m_uFrameOffset.load(), m_cbPerFrame);
+}
+
+VkDeviceSize VkFrameRingBuffer::GetPeakUsedBytes() const {
+  return std::max(m_cbPeak, GetFrameUsedBytes());
+}
+
+VkDeviceSize VkFrameRingBuffer::GetBytesPerFrame() const {
+  return m_cbPerFrame;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "VkUtilities.h"
+#include <atomic>
+
+///
+/// Per-frame linear allocator over one persistently mapped uniform buffer. Every frame slot owns
+/// a region of the buffer, allocations bump the slot's offset and are aligned to
+/// minUniformBufferOffsetAlignment, so they are bound by the dynamic offsets of a single
+/// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor. The region is recycled as a whole by
+/// `ResetFrame`, once the slot's frame completed.
+///
+class VkFrameRingBuffer
+{
+public:
+  VkFrameRingBuffer();
+  ~VkFrameRingBuffer();
+
+  /// `cbMaxRange` is the largest range of the descriptors reading the buffer, kept past the last
+  /// region so that every dynamic offset stays within the buffer.
+  VKHRESULT Create(
+    VkDevice pDevice,
+    uint32_t uFrameCount,
+    VkDeviceSize cbPerFrame,
+    VkDeviceSize cbMaxRange
+  );
+  /// The device must be idle.
+  void Destroy();
+
+  /// Rewind the slot's region and allocate from it, call it after the slot's timeline value was
+  /// waited.
+  void ResetFrame(uint32_t uFrameIndex);
+
+  /// Thread safe. `puOffset` receives the dynamic offset, fails with VK_ERROR_OUT_OF_DEVICE_MEMORY
+  /// when the frame's region is exhausted.
+  VKHRESULT Allocate(size_t cbSize, _Out_ uint32_t *puOffset, _Out_ void **ppData);
+  /// Allocate and copy `pData`.
+  VKHRESULT Push(const void *pData, size_t cbSize, _Out_ uint32_t *puOffset);
+
+  VkBuffer GetBuffer() const;
+  /// Write it once into a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor.
+  VkDescriptorBufferInfo GetDescriptorInfo(VkDeviceSize cbRange) const;
+
+  /// Bytes allocated by the current frame, and the most any frame allocated.
+  VkDeviceSize GetFrameUsedBytes() const;
+  VkDeviceSize GetPeakUsedBytes() const;
+  VkDeviceSize GetBytesPerFrame() const;
+
+private:
+  VkBuffer m_pBuffer;
+  VMAHandle m_pBufferMem;
+  char *m_pMappedData;
+  VkDeviceSize m_cbPerFrame; /// Aligned.
+  VkDeviceSize m_cbMaxRange;
+  VkDeviceSize m_uFrameBase; /// Region of the current slot.
+  std::atomic<VkDeviceSize> m_uFrameOffset;
+  VkDeviceSize m_cbPeak;
+};
@@ -0,0 +1,321 @@
+#include "VkFrameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+
+/// Beyond the frames in flight and the queued presents, a frame missing a part never gets it.
+static const size_t s_uMaxPendingFrames = 16;
+
+static const char *const s_aBoundNames[] = {"cpu", "gpu", "present"};
+
+static FrameTimePercentiles CalcPercentiles(std::vector<float> *pValues) {
+  FrameTimePercentiles percentiles = {};
+  size_t n = pValues->size();
+  double total = 0.0;
+
+  auto fnRank = [pValues, n](double p) {
+    size_t rank = (size_t)std::ceil(p * n);
+    return (*pValues)[std::min(n, std::max<size_t>(rank, 1)) - 1];
+  };
+
+  if (n == 0)
+    return percentiles;
+
+  std::sort(pValues->begin(), pValues->end());
+  for (float value : *pValues)
+    total += value;
+
+  percentiles.Count = (uint32_t)n;
+  percentiles.Average = (float)(total / n);
+  percentiles.P50 = fnRank(0.50);
+  percentiles.P95 = fnRank(0.95);
+  percentiles.P99 = fnRank(0.99);
+  percentiles.Max = pValues->back();
+
+  return percentiles;
+}
+
+static void AccumulateStalls(const FrameStalls &stalls, FrameStalls *pTotal, FrameStalls *pMax) {
+  pTotal->AcquireMs += stalls.AcquireMs;
+  pTotal->GpuWaitMs += stalls.GpuWaitMs;
+  pTotal->PresentMs += stalls.PresentMs;
+  pTotal->PacingMs += stalls.PacingMs;
+  pMax->AcquireMs = std::max(pMax->AcquireMs, stalls.AcquireMs);
+  pMax->GpuWaitMs = std::max(pMax->GpuWaitMs, stalls.GpuWaitMs);
+  pMax->PresentMs = std::max(pMax->PresentMs, stalls.PresentMs);
+  pMax->PacingMs = std::max(pMax->PacingMs, stalls.PacingMs);
+}
+
+static void PrintJsonTime(FILE *fd, const char *pszName, float fMs, const char *pszSeparator) {
+  if (fMs < .0f)
+    fprintf(fd, "\"%s\": null%s", pszName, pszSeparator);
+  else
+    fprintf(fd, "\"%s\": %.4f%s", pszName, fMs, pszSeparator);
+}
+
+static void PrintJsonStalls(FILE *fd, const char *pszName, const FrameStalls &stalls) {
+  fprintf(fd,
+          "    \"%s\": {\"acquire_ms\": %.4f, \"gpu_wait_ms\": %.4f, \"present_ms\": %.4f, "
+          "\"pacing_ms\": %.4f},\n",
+          pszName, stalls.AcquireMs, stalls.GpuWaitMs, stalls.PresentMs, stalls.PacingMs);
+}
+
+static void PrintJsonPercentiles(FILE *fd, const char *pszName,
+                                 const FrameTimePercentiles &percentiles) {
+  fprintf(fd,
+          "    \"%s\": {\"count\": %u, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+          "\"p99\": %.4f, \"max\": %.4f},\n",
+          pszName, percentiles.Count, percentiles.Average, percentiles.P50, percentiles.P95,
+          percentiles.P99, percentiles.Max);
+}
+
+const char *GetFrameBoundName(FrameBound bound) {
+  return (uint32_t)bound < _countof(s_aBoundNames) ? s_aBoundNames[(uint32_t)bound] : "?";
+}
+
+VkFrameStats::VkFrameStats() {
+  m_uCapacity = 0;
+  m_uPublishedCount = 0;
+  m_fHitchFactor = 2.0f;
+}
+
+void VkFrameStats::Create(uint32_t uCapacity) {
+  uint32_t i;
+
+  m_uCapacity = 1;
+  while (m_uCapacity < uCapacity)
+    m_uCapacity <<= 1;
+
+  m_aSlots.reset(new Slot[m_uCapacity]);
+  for (i = 0; i < m_uCapacity; ++i)
+    m_aSlots[i].uSequence.store(0, std::memory_order_relaxed);
+  m_uPublishedCount.store(0, std::memory_order_release);
+  m_aPending.clear();
+}
+
+void VkFrameStats::Destroy() {
+  m_uPublishedCount.store(0, std::memory_order_release);
+  m_aSlots.reset();
+  m_uCapacity = 0;
+  m_aPending.clear();
+}
+
+void VkFrameStats::RecordCpu(uint64_t uFrame, float fCpuMs, const FrameStalls &stalls) {
+  float fPresentWaitMs = stalls.AcquireMs + stalls.PresentMs + stalls.PacingMs;
+  float fWorkMs = std::max(.0f, fCpuMs - stalls.AcquireMs - stalls.GpuWaitMs - stalls.PresentMs);
+  FrameBound bound = FrameBound::Cpu;
+
+  if (!m_uCapacity)
+    return;
+
+  if (stalls.GpuWaitMs > fWorkMs && stalls.GpuWaitMs >= fPresentWaitMs)
+    bound = FrameBound::Gpu;
+  else if (fPresentWaitMs > fWorkMs && fPresentWaitMs > stalls.GpuWaitMs)
+    bound = FrameBound::Present;
+
+  m_aPending.push_back(
+      PendingFrame{{uFrame, fCpuMs, -1.0f, -1.0f, stalls, bound}, false, false});
+  Flush();
+}
+
+void VkFrameStats::RecordGpu(uint64_t uFrame, float fGpuMs) {
+  PendingFrame *pPending = FindPending(uFrame);
+
+  if (pPending) {
+    pPending->Sample.GpuMs = fGpuMs;
+    pPending->bGpuKnown = true;
+    Flush();
+  }
+}
+
+void VkFrameStats::RecordPresent(uint64_t uFrame, float fPresentIntervalMs) {
+  PendingFrame *pPending = FindPending(uFrame);
+
+  if (pPending) {
+    pPending->Sample.PresentIntervalMs = fPresentIntervalMs;
+    pPending->bPresentKnown = true;
+    Flush();
+  }
+}
+
+void VkFrameStats::SetHitchFactor(float fFactor) {
+  m_fHitchFactor.store(fFactor, std::memory_order_relaxed);
+}
+
+void VkFrameStats::GetSamples(_Out_ std::vector<FrameTimeSample> *pSamples,
+                              uint32_t uLastFrames) const {
+  uint64_t uEnd = m_uPublishedCount.load(std::memory_order_acquire);
+  uint64_t uBegin, uSequence, i;
+  uint64_t uCount = std::min<uint64_t>(uEnd, m_uCapacity);
+  uint32_t aWords[s_uSampleWords];
+  FrameTimeSample sample;
+  uint32_t j;
+
+  pSamples->clear();
+  if (uLastFrames)
+    uCount = std::min<uint64_t>(uCount, uLastFrames);
+  uBegin = uEnd - uCount;
+
+  for (i = uBegin; i < uEnd; ++i) {
+    const Slot &slot = m_aSlots[i & (m_uCapacity - 1)];
+
+    /// A slot overwritten meanwhile by a newer frame is skipped rather than read torn.
+    uSequence = slot.uSequence.load(std::memory_order_acquire);
+    for (j = 0; j < s_uSampleWords; ++j)
+      aWords[j] = slot.aWords[j].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (uSequence == i + 1 && slot.uSequence.load(std::memory_order_relaxed) == uSequence) {
+      memcpy(&sample, aWords, sizeof(sample));
+      pSamples->push_back(sample);
+    }
+  }
+}
+
+bool VkFrameStats::Summarize(_Out_ FrameStatsSummary *pSummary, uint32_t uLastFrames,
+                             uint64_t uFirstFrame) const {
+  std::vector<FrameTimeSample> aSamples;
+  std::vector<float> aCpuMs, aGpuMs, aPresentIntervalMs;
+  const std::vector<float> *pHitchMs;
+  float fMedianMs;
+
+  *pSummary = {};
+  GetSamples(&aSamples, uLastFrames);
+  aSamples.erase(std::remove_if(aSamples.begin(), aSamples.end(),
+                                [uFirstFrame](const FrameTimeSample &sample) {
+                                  return sample.Frame < uFirstFrame;
+                                }),
+                 aSamples.end());
+  if (aSamples.empty())
+    return false;
+
+  for (auto &sample : aSamples) {
+    AccumulateStalls(sample.Stalls, &pSummary->AverageStalls, &pSummary->MaxStalls);
+    ++pSummary->BoundCounts[std::min((uint32_t)sample.Bound, (uint32_t)FrameBound::Count - 1)];
+    if (sample.CpuMs >= .0f)
+      aCpuMs.push_back(sample.CpuMs);
+    if (sample.GpuMs >= .0f)
+      aGpuMs.push_back(sample.GpuMs);
+    if (sample.PresentIntervalMs >= .0f)
+      aPresentIntervalMs.push_back(sample.PresentIntervalMs);
+  }
+
+  pSummary->FrameCount = (uint32_t)aSamples.size();
+  pSummary->AverageStalls.AcquireMs /= pSummary->FrameCount;
+  pSummary->AverageStalls.GpuWaitMs /= pSummary->FrameCount;
+  pSummary->AverageStalls.PresentMs /= pSummary->FrameCount;
+  pSummary->AverageStalls.PacingMs /= pSummary->FrameCount;
+  pSummary->Cpu = CalcPercentiles(&aCpuMs);
+  pSummary->Gpu = CalcPercentiles(&aGpuMs);
+  pSummary->PresentInterval = CalcPercentiles(&aPresentIntervalMs);
+
+  /// What the user sees, the interval between presents, unless nothing was displayed.
+  pHitchMs = aPresentIntervalMs.empty() ? &aCpuMs : &aPresentIntervalMs;
+  fMedianMs = aPresentIntervalMs.empty() ? pSummary->Cpu.P50 : pSummary->PresentInterval.P50;
+  pSummary->HitchThresholdMs = m_fHitchFactor.load(std::memory_order_relaxed) * fMedianMs;
+  pSummary->HitchCount = (uint32_t)std::count_if(
+      pHitchMs->begin(), pHitchMs->end(),
+      [pSummary](float fMs) { return fMs > pSummary->HitchThresholdMs; });
+
+  return true;
+}
+
+VKHRESULT VkFrameStats::ExportCsv(_In_z_ const char *pszFileName) const {
+  VKHRESULT hr = VK_SUCCESS;
+  std::vector<FrameTimeSample> aSamples;
+  FILE *fd = fopen(pszFileName, "w");
+
+  V_RETURN(!(fd && !!"Can not open the frame statistics file!"));
+
+  GetSamples(&aSamples);
+  fprintf(fd, "frame,cpu_ms,gpu_ms,present_interval_ms,acquire_ms,gpu_wait_ms,present_ms,"
+              "pacing_ms,bound\n");
+  for (auto &sample : aSamples) {
+    fprintf(fd, "%llu", (unsigned long long)sample.Frame);
+    for (float fMs : {sample.CpuMs, sample.GpuMs, sample.PresentIntervalMs}) {
+      if (fMs >= .0f)
+        fprintf(fd, ",%.4f", fMs);
+      else
+        fprintf(fd, ",");
+    }
+    fprintf(fd, ",%.4f,%.4f,%.4f,%.4f,%s\n", sample.Stalls.AcquireMs, sample.Stalls.GpuWaitMs,
+            sample.Stalls.PresentMs, sample.Stalls.PacingMs, GetFrameBoundName(sample.Bound));
+  }
+  fclose(fd);
+
+  return hr;
+}
+
+VKHRESULT VkFrameStats::ExportJson(_In_z_ const char *pszFileName) const {
+  VKHRESULT hr = VK_SUCCESS;
+  std::vector<FrameTimeSample> aSamples;
+  FrameStatsSummary summary;
+  FILE *fd = fopen(pszFileName, "w");
+  size_t i;
+
+  V_RETURN(!(fd && !!"Can not open the frame statistics file!"));
+
+  GetSamples(&aSamples);
+  Summarize(&summary);
+  fprintf(fd, "{\n  \"summary\": {\n    \"frames\": %u,\n", summary.FrameCount);
+  PrintJsonPercentiles(fd, "cpu_ms", summary.Cpu);
+  PrintJsonPercentiles(fd, "gpu_ms", summary.Gpu);
+  PrintJsonPercentiles(fd, "present_interval_ms", summary.PresentInterval);
+  PrintJsonStalls(fd, "average_stalls", summary.AverageStalls);
+  PrintJsonStalls(fd, "max_stalls", summary.MaxStalls);
+  fprintf(fd, "    \"bound\": {\"cpu\": %u, \"gpu\": %u, \"present\": %u},\n",
+          summary.BoundCounts[(uint32_t)FrameBound::Cpu],
+          summary.BoundCounts[(uint32_t)FrameBound::Gpu],
+          summary.BoundCounts[(uint32_t)FrameBound::Present]);
+  fprintf(fd, "    \"hitches\": %u,\n    \"hitch_threshold_ms\": %.4f\n  },\n  \"frames\": [\n",
+          summary.HitchCount, summary.HitchThresholdMs);
+  for (i = 0; i < aSamples.size(); ++i) {
+    fprintf(fd, "    {\"frame\": %llu, ", (unsigned long long)aSamples[i].Frame);
+    PrintJsonTime(fd, "cpu_ms", aSamples[i].CpuMs, ", ");
+    PrintJsonTime(fd, "gpu_ms", aSamples[i].GpuMs, ", ");
+    PrintJsonTime(fd, "present_interval_ms", aSamples[i].PresentIntervalMs, ", ");
+    fprintf(fd,
+            "\"acquire_ms\": %.4f, \"gpu_wait_ms\": %.4f, \"present_ms\": %.4f, "
+            "\"pacing_ms\": %.4f, \"bound\": \"%s\"}%s\n",
+            aSamples[i].Stalls.AcquireMs, aSamples[i].Stalls.GpuWaitMs,
+            aSamples[i].Stalls.PresentMs, aSamples[i].Stalls.PacingMs,
+            GetFrameBoundName(aSamples[i].Bound), i + 1 < aSamples.size() ? "," : "");
+  }
+  fprintf(fd, "  ]\n}\n");
+  fclose(fd);
+
+  return hr;
+}
+
+VkFrameStats::PendingFrame *VkFrameStats::FindPending(uint64_t uFrame) {
+  for (auto &pending : m_aPending) {
+    if (pending.Sample.Frame == uFrame)
+      return &pending;
+  }
+  return nullptr;
+}
+
+void VkFrameStats::Flush() {
+  while (!m_aPending.empty() &&
+         ((m_aPending.front().bGpuKnown && m_aPending.front().bPresentKnown) ||
+          m_aPending.size() > s_uMaxPendingFrames)) {
+    Publish(m_aPending.front().Sample);
+    m_aPending.pop_front();
+  }
+}
+
+void VkFrameStats::Publish(const FrameTimeSample &sample) {
+  uint64_t uIndex = m_uPublishedCount.load(std::memory_order_relaxed);
+  Slot &slot = m_aSlots[uIndex & (m_uCapacity - 1)];
+  uint32_t aWords[s_uSampleWords];
+  uint32_t i;
+
+  /// Single writer, readers retry nothing, they drop the slot when the sequence changed.
+  slot.uSequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(aWords, &sample, sizeof(sample));
+  for (i = 0; i < s_uSampleWords; ++i)
+    slot.aWords[i].store(aWords[i], std::memory_order_relaxed);
+  slot.uSequence.store(uIndex + 1, std::memory_order_release);
+  m_uPublishedCount.store(uIndex + 1, std::memory_order_release);
+}
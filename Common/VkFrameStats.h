@@ -0,0 +1,128 @@
+#pragma once
+#include "VkUtilities.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/// Frames kept by the frame statistics, rounded up to a power of two.
+#ifndef VK_FRAME_STATS_CAPACITY
+#define VK_FRAME_STATS_CAPACITY 4096
+#endif
+
+/// Time the CPU was blocked within a frame, at each blocking point.
+struct FrameStalls {
+  float AcquireMs; /// vkAcquireNextImageKHR.
+  float GpuWaitMs; /// Waiting the frame slot and the swap chain image on the graphics timeline.
+  float PresentMs; /// vkQueuePresentKHR.
+  float PacingMs;  /// Queued presents over the latency policy's bound, before the frame start.
+};
+
+/// What a frame waited on the most: its own CPU work, the GPU, or the presentation engine.
+enum class FrameBound : uint32_t { Cpu, Gpu, Present, Count };
+
+extern const char *GetFrameBoundName(FrameBound bound);
+
+/// Times of one frame, negative when unknown. The GPU time needs timestamp queries, the present
+/// interval a previous present.
+struct FrameTimeSample {
+  uint64_t Frame; /// Graphics timeline value of the frame.
+  float CpuMs;    /// Frame start to the present submission, stalls included.
+  float GpuMs;
+  float PresentIntervalMs;
+  FrameStalls Stalls;
+  FrameBound Bound;
+};
+
+/// Nearest rank percentiles over the known samples only.
+struct FrameTimePercentiles {
+  uint32_t Count;
+  float Average;
+  float P50;
+  float P95;
+  float P99;
+  float Max;
+};
+
+struct FrameStatsSummary {
+  uint32_t FrameCount;
+  FrameTimePercentiles Cpu;
+  FrameTimePercentiles Gpu;
+  FrameTimePercentiles PresentInterval;
+  /// Frames taking longer than the hitch factor times the median, measured between presents or on
+  /// the CPU when no present interval is known.
+  uint32_t HitchCount;
+  float HitchThresholdMs;
+  /// Frames per `FrameBound`, and where their CPU was blocked.
+  uint32_t BoundCounts[(uint32_t)FrameBound::Count];
+  FrameStalls AverageStalls;
+  FrameStalls MaxStalls;
+};
+
+static_assert(std::is_trivially_copyable<FrameTimeSample>::value &&
+                  sizeof(FrameTimeSample) % sizeof(uint32_t) == 0,
+              "Frame samples are published as words!");
+
+///
+/// Per frame CPU, GPU and present times. The parts of a frame arrive frames apart, the GPU time
+/// once its slot is reused and the present interval once the display retired it, so frames wait
+/// in a pending list of the render thread until complete. Complete frames are published into a
+/// ring of seqlocked slots, read from any thread without blocking the render thread.
+///
+class VkFrameStats
+{
+public:
+  VkFrameStats();
+
+  void Create(uint32_t uCapacity = VK_FRAME_STATS_CAPACITY);
+  void Destroy();
+
+  /// Render thread only. A part of a frame which is not pending is ignored. The frame is
+  /// classified by its largest wait against its CPU work, the acquire, present and pacing waits
+  /// all count towards the presentation engine.
+  void RecordCpu(uint64_t uFrame, float fCpuMs, const FrameStalls &stalls);
+  void RecordGpu(uint64_t uFrame, float fGpuMs);
+  void RecordPresent(uint64_t uFrame, float fPresentIntervalMs);
+
+  /// Frames slower than `fFactor` times the median count as hitches, 2 by default.
+  void SetHitchFactor(float fFactor);
+
+  /// Published frames, oldest first, from any thread. `uLastFrames` of zero returns all.
+  void GetSamples(_Out_ std::vector<FrameTimeSample> *pSamples, uint32_t uLastFrames = 0) const;
+  /// Frames before `uFirstFrame` are left out. False when no frame was published yet.
+  bool Summarize(_Out_ FrameStatsSummary *pSummary, uint32_t uLastFrames = 0,
+                 uint64_t uFirstFrame = 0) const;
+
+  /// One row per frame, empty fields for unknown times.
+  VKHRESULT ExportCsv(_In_z_ const char *pszFileName) const;
+  /// The summary followed by the frames, unknown times are null.
+  VKHRESULT ExportJson(_In_z_ const char *pszFileName) const;
+
+private:
+  static const uint32_t s_uSampleWords = sizeof(FrameTimeSample) / sizeof(uint32_t);
+
+  /// The sample is copied word by word, a torn read is detected by the sequence.
+  struct Slot {
+    std::atomic<uint64_t> uSequence; /// Publish count once written, zero while writing.
+    std::atomic<uint32_t> aWords[s_uSampleWords];
+  };
+
+  struct PendingFrame {
+    FrameTimeSample Sample;
+    bool bGpuKnown;
+    bool bPresentKnown;
+  };
+
+  PendingFrame *FindPending(uint64_t uFrame);
+  /// Publishes the complete frames at the front, and the oldest ones once too many are pending.
+  void Flush();
+  void Publish(const FrameTimeSample &sample);
+
+  std::unique_ptr<Slot[]> m_aSlots;
+  uint32_t m_uCapacity;
+  std::atomic<uint64_t> m_uPublishedCount;
+  std::atomic<float> m_fHitchFactor;
+
+  std::deque<PendingFrame> m_aPending;
+};
@@ -0,0 +1,237 @@
+#include "VkGeometryPool.h"
+#include <iterator>
+#include <string.h>
+
+void VkGeometryPool::RangeAllocator::Reset(VkDeviceSize uCapacity) {
+  m_aFreeRanges.clear();
+  if (uCapacity)
+    m_aFreeRanges[0] = uCapacity;
+  m_uCapacity = uCapacity;
+  m_uFreeSize = uCapacity;
+}
+
+bool VkGeometryPool::RangeAllocator::Allocate(
+  VkDeviceSize uSize,
+  VkDeviceSize uAlignment,
+  VkDeviceSize *puOffset
+) {
+  VkDeviceSize uOffset, uEnd;
+
+  *puOffset = 0;
+
+  for (auto it = m_aFreeRanges.begin(); it != m_aFreeRanges.end(); ++it) {
+    /// Strides aren't powers of two.
+    uOffset = (it->first + uAlignment - 1) / uAlignment * uAlignment;
+    uEnd = it->first + it->second;
+    if (uOffset + uSize > uEnd)
+      continue;
+
+    /// The padding in front stays free, as does the tail.
+    if (uOffset > it->first)
+      it->second = uOffset - it->first;
+    else
+      m_aFreeRanges.erase(it);
+    if (uOffset + uSize < uEnd)
+      m_aFreeRanges[uOffset + uSize] = uEnd - uOffset - uSize;
+
+    m_uFreeSize -= uSize;
+    *puOffset = uOffset;
+    return true;
+  }
+
+  return false;
+}
+
+void VkGeometryPool::RangeAllocator::Free(VkDeviceSize uOffset, VkDeviceSize uSize) {
+  auto next = m_aFreeRanges.lower_bound(uOffset);
+
+  m_uFreeSize += uSize;
+
+  if (next != m_aFreeRanges.end() && uOffset + uSize == next->first) {
+    uSize += next->second;
+    next = m_aFreeRanges.erase(next);
+  }
+  if (next != m_aFreeRanges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == uOffset) {
+      prev->second += uSize;
+      return;
+    }
+  }
+  m_aFreeRanges.emplace_hint(next, uOffset, uSize);
+}
+
+VkDeviceSize VkGeometryPool::RangeAllocator::GetCapacity() const {
+  return m_uCapacity;
+}
+
+VkDeviceSize VkGeometryPool::RangeAllocator::GetFreeSize() const {
+  return m_uFreeSize;
+}
+
+VkGeometryPool::VkGeometryPool() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_pVertexBuffer = VK_NULL_HANDLE;
+  m_pVertexMem = nullptr;
+  m_pIndexBuffer = VK_NULL_HANDLE;
+  m_pIndexMem = nullptr;
+  m_VertexRanges.Reset(0);
+  m_IndexRanges.Reset(0);
+}
+
+VkGeometryPool::~VkGeometryPool() {
+  _ASSERT(!m_pVertexMem && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkGeometryPool::Create(
+  VkDevice pDevice,
+  VkDeviceSize cbVertexCapacity,
+  VkDeviceSize cbIndexCapacity
+) {
+  VKHRESULT hr;
+
+  m_pDevice = pDevice;
+
+  V_RETURN(CreateDeviceBuffer(m_pDevice, (size_t)cbVertexCapacity,
+                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pVertexBuffer, &m_pVertexMem,
+                              VkMemoryCategory::Meshes));
+  V_RETURN(CreateDeviceBuffer(m_pDevice, (size_t)cbIndexCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                              &m_pIndexBuffer, &m_pIndexMem, VkMemoryCategory::Meshes));
+  m_VertexRanges.Reset(cbVertexCapacity);
+  m_IndexRanges.Reset(cbIndexCapacity);
+
+  return hr;
+}
+
+void VkGeometryPool::Destroy() {
+  if (m_pVertexMem) {
+    DestroyVmaBuffer(m_pVertexBuffer, m_pVertexMem);
+    m_pVertexBuffer = VK_NULL_HANDLE;
+    m_pVertexMem = nullptr;
+  }
+  if (m_pIndexMem) {
+    DestroyVmaBuffer(m_pIndexBuffer, m_pIndexMem);
+    m_pIndexBuffer = VK_NULL_HANDLE;
+    m_pIndexMem = nullptr;
+  }
+  m_VertexRanges.Reset(0);
+  m_IndexRanges.Reset(0);
+}
+
+VKHRESULT VkGeometryPool::Upload(
+  VkUploadContext *pUploader,
+  VkBuffer pDstBuffer,
+  VkDeviceSize uDstOffset,
+  const void *pData,
+  VkDeviceSize uSize,
+  VkAccessFlags dstAccessMask
+) {
+  VKHRESULT hr;
+  VkStagingAllocation staging;
+
+  /// Staged and queued one after the other, a submission to stay within the staging budget
+  /// never leaves a staged copy behind.
+  V_RETURN(pUploader->AllocateStaging(uSize, &staging));
+  memcpy(staging.pData, pData, (size_t)uSize);
+
+  VkBufferCopy copyRegion = {
+    staging.uOffset, // srcOffset;
+    uDstOffset, // dstOffset;
+    uSize // size;
+  };
+  pUploader->QueueBufferUpload(staging.pBuffer, pDstBuffer, 1, &copyRegion, dstAccessMask,
+                               VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+
+  return hr;
+}
+
+VKHRESULT VkGeometryPool::Allocate(
+  VkUploadContext *pUploader,
+  const void *pVertices,
+  uint32_t uVertexCount,
+  uint32_t uVertexStride,
+  const uint32_t *pIndices,
+  uint32_t uIndexCount,
+  VkMeshRange *pRange
+) {
+  VKHRESULT hr;
+  VkDeviceSize cbVertices = (VkDeviceSize)uVertexCount * uVertexStride;
+  VkDeviceSize cbIndices = (VkDeviceSize)uIndexCount * sizeof(uint32_t);
+  VkDeviceSize uVertexOffset, uIndexOffset;
+
+  *pRange = {};
+
+  V_RETURN(!(uVertexCount && uIndexCount && uVertexStride && !!("Empty mesh!")));
+  if (!m_VertexRanges.Allocate(cbVertices, uVertexStride, &uVertexOffset))
+    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+  if (!m_IndexRanges.Allocate(cbIndices, sizeof(uint32_t), &uIndexOffset)) {
+    m_VertexRanges.Free(uVertexOffset, cbVertices);
+    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+  }
+
+  V(Upload(pUploader, m_pVertexBuffer, uVertexOffset, pVertices, cbVertices,
+           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT));
+  if (VK_FAILED(hr)) {
+    m_VertexRanges.Free(uVertexOffset, cbVertices);
+    m_IndexRanges.Free(uIndexOffset, cbIndices);
+    return hr;
+  }
+  V(Upload(pUploader, m_pIndexBuffer, uIndexOffset, pIndices, cbIndices,
+           VK_ACCESS_INDEX_READ_BIT));
+  if (VK_FAILED(hr)) {
+    /// The vertex copy is queued, its range is lost rather than written twice.
+    m_IndexRanges.Free(uIndexOffset, cbIndices);
+    return hr;
+  }
+
+  pRange->uFirstIndex = (uint32_t)(uIndexOffset / sizeof(uint32_t));
+  pRange->uIndexCount = uIndexCount;
+  pRange->iVertexOffset = (int32_t)(uVertexOffset / uVertexStride);
+  pRange->uVertexCount = uVertexCount;
+  pRange->uVertexStride = uVertexStride;
+
+  return hr;
+}
+
+void VkGeometryPool::Free(const VkMeshRange &range) {
+  if (!range.uIndexCount)
+    return;
+
+  m_VertexRanges.Free((VkDeviceSize)range.iVertexOffset * range.uVertexStride,
+                      (VkDeviceSize)range.uVertexCount * range.uVertexStride);
+  m_IndexRanges.Free((VkDeviceSize)range.uFirstIndex * sizeof(uint32_t),
+                     (VkDeviceSize)range.uIndexCount * sizeof(uint32_t));
+}
+
+void VkGeometryPool::CmdBind(VkCommandBuffer pCmdBuffer) const {
+  VkDeviceSize uOffset = 0;
+
+  vkCmdBindVertexBuffers(pCmdBuffer, 0, 1, &m_pVertexBuffer, &uOffset);
+  vkCmdBindIndexBuffer(pCmdBuffer, m_pIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void VkGeometryPool::CmdDraw(
+  VkCommandBuffer pCmdBuffer,
+  const VkMeshRange &range,
+  uint32_t uInstanceCount,
+  uint32_t uFirstInstance
+) const {
+  vkCmdDrawIndexed(pCmdBuffer, range.uIndexCount, uInstanceCount, range.uFirstIndex,
+                   range.iVertexOffset, uFirstInstance);
+}
+
+VkBuffer VkGeometryPool::GetVertexBuffer() const {
+  return m_pVertexBuffer;
+}
+
+VkBuffer VkGeometryPool::GetIndexBuffer() const {
+  return m_pIndexBuffer;
+}
+
+VkDeviceSize VkGeometryPool::GetUsedBytes() const {
+  return GetCapacityBytes() - m_VertexRanges.GetFreeSize() - m_IndexRanges.GetFreeSize();
+}
+
+VkDeviceSize VkGeometryPool::GetCapacityBytes() const {
+  return m_VertexRanges.GetCapacity() + m_IndexRanges.GetCapacity();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "VkUploadContext.h"
+#include <map>
+
+/// Where a mesh lives in the pool, the arguments of its indexed draws.
+struct VkMeshRange {
+  uint32_t uFirstIndex;
+  uint32_t uIndexCount;
+  int32_t iVertexOffset;
+  uint32_t uVertexCount;
+  uint32_t uVertexStride;
+};
+
+///
+/// Vertices and 32-bit indices of every mesh, sub-allocated from one large device local vertex
+/// buffer and one index buffer. Both are bound once per command buffer, meshes are told apart by
+/// the first index and vertex offset of their draws. A vertex range starts at a multiple of its
+/// stride, so meshes of different layouts share the vertex buffer. Freed ranges are merged with
+/// their free neighbours.
+///
+class VkGeometryPool
+{
+public:
+  VkGeometryPool();
+  ~VkGeometryPool();
+
+  VKHRESULT Create(VkDevice pDevice, VkDeviceSize cbVertexCapacity, VkDeviceSize cbIndexCapacity);
+  /// The device must be idle.
+  void Destroy();
+
+  /// Sub-allocate the mesh and queue its upload into `pUploader`. Fails with
+  /// VK_ERROR_OUT_OF_DEVICE_MEMORY when no free range of either buffer is large enough.
+  VKHRESULT Allocate(
+    VkUploadContext *pUploader,
+    const void *pVertices,
+    uint32_t uVertexCount,
+    uint32_t uVertexStride,
+    const uint32_t *pIndices,
+    uint32_t uIndexCount,
+    _Out_ VkMeshRange *pRange
+  );
+  /// Call it once no submitted work draws the mesh, from `VkTimeline::Retire` for instance.
+  void Free(const VkMeshRange &range);
+
+  /// Bind both buffers for every mesh of the pool, bindings don't carry over into secondary
+  /// command buffers.
+  void CmdBind(VkCommandBuffer pCmdBuffer) const;
+  /// `uFirstInstance` offsets gl_InstanceIndex, for per-draw data indexed by it.
+  void CmdDraw(VkCommandBuffer pCmdBuffer, const VkMeshRange &range,
+               uint32_t uInstanceCount = 1, uint32_t uFirstInstance = 0) const;
+
+  VkBuffer GetVertexBuffer() const;
+  VkBuffer GetIndexBuffer() const;
+  /// Bytes allocated from both buffers, and their capacity.
+  VkDeviceSize GetUsedBytes() const;
+  VkDeviceSize GetCapacityBytes() const;
+
+private:
+  /// First fit over the free ranges of a buffer.
+  class RangeAllocator
+  {
+  public:
+    void Reset(VkDeviceSize uCapacity);
+    bool Allocate(VkDeviceSize uSize, VkDeviceSize uAlignment, _Out_ VkDeviceSize *puOffset);
+    void Free(VkDeviceSize uOffset, VkDeviceSize uSize);
+
+    VkDeviceSize GetCapacity() const;
+    VkDeviceSize GetFreeSize() const;
+
+  private:
+    std::map<VkDeviceSize, VkDeviceSize> m_aFreeRanges; /// Offset to size, never adjacent.
+    VkDeviceSize m_uCapacity;
+    VkDeviceSize m_uFreeSize;
+  };
+
+  VKHRESULT Upload(
+    VkUploadContext *pUploader,
+    VkBuffer pDstBuffer,
+    VkDeviceSize uDstOffset,
+    const void *pData,
+    VkDeviceSize uSize,
+    VkAccessFlags dstAccessMask
+  );
+
+  VkDevice m_pDevice;
+  VkBuffer m_pVertexBuffer;
+  VMAHandle m_pVertexMem;
+  VkBuffer m_pIndexBuffer;
+  VMAHandle m_pIndexMem;
+  RangeAllocator m_VertexRanges;
+  RangeAllocator m_IndexRanges;
+};
@@ -0,0 +1,301 @@
+#include "VkGpuProfiler.h"
+#include <algorithm>
+
+/// Same order as the members of GpuPipelineStatistics.
+static const VkQueryPipelineStatisticFlags s_PipelineStatisticsFlags =
+  VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+VkGpuProfiler::VkGpuProfiler() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_uMaxScopesPerFrame = 0;
+  m_uRecordingFrame = UINT32_MAX;
+  m_uScopeDepth = 0;
+  m_uActiveStatisticsScope = UINT32_MAX;
+  m_bPipelineStatistics = false;
+  m_fTimestampPeriod = 1.0f;
+  m_uTimestampMask = UINT64_MAX;
+  m_fLastFrameMs = 0.0f;
+  m_LastFrameStatistics = {};
+  m_bLastFrameHasStatistics = false;
+  m_uResolvedFrameCount = 0;
+  m_pCsvFile = nullptr;
+}
+
+VkGpuProfiler::~VkGpuProfiler() {
+  _ASSERT(m_aFrames.empty() && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkGpuProfiler::Create(
+  VkDevice pDevice,
+  VkPhysicalDevice pPhysicalDevice,
+  uint32_t uQueueFamilyIndex,
+  uint32_t uFrameCount,
+  bool bPipelineStatistics,
+  uint32_t uMaxScopesPerFrame
+) {
+  VKHRESULT hr = VK_SUCCESS;
+  VkPhysicalDeviceProperties properties;
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties;
+  uint32_t queueFamilyCount = 0;
+  uint32_t uValidBits;
+
+  m_pDevice = pDevice;
+  m_uMaxScopesPerFrame = uMaxScopesPerFrame;
+
+  vkGetPhysicalDeviceProperties(pPhysicalDevice, &properties);
+  vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &queueFamilyCount, NULL);
+  queueFamilyProperties.resize(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &queueFamilyCount,
+    queueFamilyProperties.data());
+
+  /// Leave the profiler empty, scopes turn into no-ops.
+  uValidBits = queueFamilyProperties[uQueueFamilyIndex].timestampValidBits;
+  if (uValidBits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+    VK_TRACE("Timestamp queries are unsupported, GPU profiling is disabled.\n");
+    return hr;
+  }
+  m_fTimestampPeriod = properties.limits.timestampPeriod;
+  m_uTimestampMask = uValidBits >= 64 ? UINT64_MAX : ((1ull << uValidBits) - 1);
+
+  VkQueryPoolCreateInfo queryPoolInfo = {
+    VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, // sType;
+    nullptr, // pNext;
+    0, // flags;
+    VK_QUERY_TYPE_TIMESTAMP, // queryType;
+    2 * m_uMaxScopesPerFrame, // queryCount;
+    0 // pipelineStatistics;
+  };
+
+  VkQueryPoolCreateInfo statisticsPoolInfo = {
+    VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, // sType;
+    nullptr, // pNext;
+    0, // flags;
+    VK_QUERY_TYPE_PIPELINE_STATISTICS, // queryType;
+    m_uMaxScopesPerFrame, // queryCount;
+    s_PipelineStatisticsFlags // pipelineStatistics;
+  };
+  m_bPipelineStatistics = bPipelineStatistics;
+
+  m_aFrames.resize(uFrameCount);
+  for (auto &frame : m_aFrames) {
+    frame.pQueryPool = VK_NULL_HANDLE;
+    frame.pStatisticsQueryPool = VK_NULL_HANDLE;
+    frame.uStatisticsCount = 0;
+    frame.bRecorded = false;
+    V_RETURN(vkCreateQueryPool(m_pDevice, &queryPoolInfo, nullptr, &frame.pQueryPool));
+    if (m_bPipelineStatistics) {
+      V_RETURN(vkCreateQueryPool(m_pDevice, &statisticsPoolInfo, nullptr,
+        &frame.pStatisticsQueryPool));
+    }
+  }
+  m_aTimestamps.resize(2 * m_uMaxScopesPerFrame);
+  m_aStatistics.resize(m_uMaxScopesPerFrame);
+
+  return hr;
+}
+
+void VkGpuProfiler::Destroy() {
+  for (auto &frame : m_aFrames) {
+    vkDestroyQueryPool(m_pDevice, frame.pQueryPool, nullptr);
+    vkDestroyQueryPool(m_pDevice, frame.pStatisticsQueryPool, nullptr);
+  }
+  m_aFrames.clear();
+  m_aLastFrameTimings.clear();
+  CloseCsvLog();
+}
+
+bool VkGpuProfiler::IsSupported() const {
+  return !m_aFrames.empty();
+}
+
+bool VkGpuProfiler::IsPipelineStatisticsSupported() const {
+  return IsSupported() && m_bPipelineStatistics;
+}
+
+VkQueryPipelineStatisticFlags VkGpuProfiler::GetPipelineStatisticsFlags() const {
+  return IsPipelineStatisticsSupported() ? s_PipelineStatisticsFlags : 0;
+}
+
+bool VkGpuProfiler::ResolveFrame(uint32_t uFrameIndex) {
+  FrameQueries *pFrame;
+  uint32_t uScopeCount, uStatistics, i;
+  uint64_t uBegin, uEnd, uFirst = UINT64_MAX, uLast = 0;
+  double msPerTick = m_fTimestampPeriod * 1e-6;
+
+  if (uFrameIndex >= m_aFrames.size() || !m_aFrames[uFrameIndex].bRecorded)
+    return false;
+
+  pFrame = &m_aFrames[uFrameIndex];
+  pFrame->bRecorded = false;
+  uScopeCount = (uint32_t)pFrame->aScopeNames.size();
+  if (uScopeCount == 0)
+    return false;
+
+  /// No wait flag, a frame that isn't available yet is dropped rather than stalling.
+  if (vkGetQueryPoolResults(m_pDevice, pFrame->pQueryPool, 0, 2 * uScopeCount,
+    2 * uScopeCount * sizeof(uint64_t), m_aTimestamps.data(), sizeof(uint64_t),
+    VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    return false;
+  if (pFrame->uStatisticsCount &&
+    vkGetQueryPoolResults(m_pDevice, pFrame->pStatisticsQueryPool, 0, pFrame->uStatisticsCount,
+    pFrame->uStatisticsCount * sizeof(GpuPipelineStatistics), m_aStatistics.data(),
+    sizeof(GpuPipelineStatistics), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    return false;
+
+  m_aLastFrameTimings.resize(uScopeCount);
+  m_LastFrameStatistics = {};
+  m_bLastFrameHasStatistics = pFrame->uStatisticsCount > 0;
+  for (i = 0; i < uScopeCount; ++i) {
+    uBegin = m_aTimestamps[2 * i] & m_uTimestampMask;
+    uEnd = m_aTimestamps[2 * i + 1] & m_uTimestampMask;
+
+    m_aLastFrameTimings[i].Name = pFrame->aScopeNames[i];
+    m_aLastFrameTimings[i].Depth = pFrame->aScopeDepths[i];
+    m_aLastFrameTimings[i].Milliseconds = (float)((uEnd - uBegin) * msPerTick);
+
+    uStatistics = pFrame->aScopeStatistics[i];
+    m_aLastFrameTimings[i].HasStatistics = uStatistics != UINT32_MAX;
+    m_aLastFrameTimings[i].Statistics = {};
+    if (uStatistics != UINT32_MAX) {
+      const GpuPipelineStatistics &stats = m_aStatistics[uStatistics];
+      m_aLastFrameTimings[i].Statistics = stats;
+      /// Statistics scopes never nest, so the sum counts each draw once.
+      m_LastFrameStatistics.InputVertices += stats.InputVertices;
+      m_LastFrameStatistics.InputPrimitives += stats.InputPrimitives;
+      m_LastFrameStatistics.VertexInvocations += stats.VertexInvocations;
+      m_LastFrameStatistics.ClippingInvocations += stats.ClippingInvocations;
+      m_LastFrameStatistics.ClippingPrimitives += stats.ClippingPrimitives;
+      m_LastFrameStatistics.FragmentInvocations += stats.FragmentInvocations;
+    }
+
+    uFirst = std::min(uFirst, uBegin);
+    uLast = std::max(uLast, uEnd);
+  }
+  m_fLastFrameMs = (float)((uLast - uFirst) * msPerTick);
+
+  if (m_pCsvFile) {
+    for (auto &timing : m_aLastFrameTimings) {
+      fprintf(m_pCsvFile, "%llu,%s,%u,%.4f", (unsigned long long)m_uResolvedFrameCount,
+        timing.Name.c_str(), timing.Depth, timing.Milliseconds);
+      if (timing.HasStatistics) {
+        fprintf(m_pCsvFile, ",%llu,%llu,%llu,%llu,%llu,%llu\n",
+          (unsigned long long)timing.Statistics.InputVertices,
+          (unsigned long long)timing.Statistics.InputPrimitives,
+          (unsigned long long)timing.Statistics.VertexInvocations,
+          (unsigned long long)timing.Statistics.ClippingInvocations,
+          (unsigned long long)timing.Statistics.ClippingPrimitives,
+          (unsigned long long)timing.Statistics.FragmentInvocations);
+      } else {
+        fprintf(m_pCsvFile, ",,,,,,\n");
+      }
+    }
+  }
+  ++m_uResolvedFrameCount;
+
+  return true;
+}
+
+void VkGpuProfiler::CmdResetFrame(VkCommandBuffer pCmdBuffer, uint32_t uFrameIndex) {
+  FrameQueries *pFrame;
+
+  if (uFrameIndex >= m_aFrames.size())
+    return;
+
+  pFrame = &m_aFrames[uFrameIndex];
+  _ASSERT(!pFrame->bRecorded && "Frame queries reset before they were resolved!");
+
+  vkCmdResetQueryPool(pCmdBuffer, pFrame->pQueryPool, 0, 2 * m_uMaxScopesPerFrame);
+  if (pFrame->pStatisticsQueryPool)
+    vkCmdResetQueryPool(pCmdBuffer, pFrame->pStatisticsQueryPool, 0, m_uMaxScopesPerFrame);
+  pFrame->aScopeNames.clear();
+  pFrame->aScopeDepths.clear();
+  pFrame->aScopeStatistics.clear();
+  pFrame->uStatisticsCount = 0;
+  pFrame->bRecorded = true;
+
+  m_uRecordingFrame = uFrameIndex;
+  m_uScopeDepth = 0;
+  m_uActiveStatisticsScope = UINT32_MAX;
+}
+
+uint32_t VkGpuProfiler::CmdBeginScope(VkCommandBuffer pCmdBuffer, const char *pszName,
+  bool bCollectStatistics) {
+  FrameQueries *pFrame;
+  uint32_t uScope;
+
+  if (m_uRecordingFrame >= m_aFrames.size())
+    return UINT32_MAX;
+
+  pFrame = &m_aFrames[m_uRecordingFrame];
+  uScope = (uint32_t)pFrame->aScopeNames.size();
+  if (uScope >= m_uMaxScopesPerFrame)
+    return UINT32_MAX;
+
+  pFrame->aScopeNames.push_back(pszName);
+  pFrame->aScopeDepths.push_back(m_uScopeDepth++);
+  pFrame->aScopeStatistics.push_back(UINT32_MAX);
+  vkCmdWriteTimestamp(pCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pFrame->pQueryPool,
+    2 * uScope);
+
+  if (bCollectStatistics && pFrame->pStatisticsQueryPool &&
+    m_uActiveStatisticsScope == UINT32_MAX) {
+    pFrame->aScopeStatistics[uScope] = pFrame->uStatisticsCount;
+    vkCmdBeginQuery(pCmdBuffer, pFrame->pStatisticsQueryPool, pFrame->uStatisticsCount++, 0);
+    m_uActiveStatisticsScope = uScope;
+  }
+
+  return uScope;
+}
+
+void VkGpuProfiler::CmdEndScope(VkCommandBuffer pCmdBuffer, uint32_t uScope) {
+  if (uScope == UINT32_MAX || m_uRecordingFrame >= m_aFrames.size())
+    return;
+
+  FrameQueries *pFrame = &m_aFrames[m_uRecordingFrame];
+
+  --m_uScopeDepth;
+  if (m_uActiveStatisticsScope == uScope) {
+    vkCmdEndQuery(pCmdBuffer, pFrame->pStatisticsQueryPool, pFrame->aScopeStatistics[uScope]);
+    m_uActiveStatisticsScope = UINT32_MAX;
+  }
+  vkCmdWriteTimestamp(pCmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pFrame->pQueryPool,
+    2 * uScope + 1);
+}
+
+const std::vector<GpuPassTiming> &VkGpuProfiler::GetLastFrameTimings() const {
+  return m_aLastFrameTimings;
+}
+
+float VkGpuProfiler::GetLastFrameMs() const {
+  return m_fLastFrameMs;
+}
+
+bool VkGpuProfiler::GetLastFrameStatistics(_Out_opt_ GpuPipelineStatistics *pStatistics) const {
+  if (pStatistics)
+    *pStatistics = m_LastFrameStatistics;
+  return m_bLastFrameHasStatistics;
+}
+
+VKHRESULT VkGpuProfiler::OpenCsvLog(_In_z_ const char *pszFileName) {
+  VKHRESULT hr = VK_SUCCESS;
+
+  CloseCsvLog();
+  m_pCsvFile = fopen(pszFileName, "w");
+  V_RETURN(!(m_pCsvFile && !!"Can not open the GPU profiler log!"));
+  fprintf(m_pCsvFile, "frame,pass,depth,ms,ia_vertices,ia_primitives,vs_invocations,"
+    "clipping_invocations,clipping_primitives,fs_invocations\n");
+
+  return hr;
+}
+
+void VkGpuProfiler::CloseCsvLog() {
+  if (m_pCsvFile) {
+    fclose(m_pCsvFile);
+    m_pCsvFile = nullptr;
+  }
+}
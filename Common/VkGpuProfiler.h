@@ -0,0 +1,129 @@
+#pragma once
+#include "VkUtilities.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// Counters of VK_QUERY_TYPE_PIPELINE_STATISTICS, in the order of their flag bits.
+struct GpuPipelineStatistics {
+  uint64_t InputVertices;
+  uint64_t InputPrimitives;
+  uint64_t VertexInvocations;
+  uint64_t ClippingInvocations;
+  uint64_t ClippingPrimitives;
+  uint64_t FragmentInvocations;
+};
+
+struct GpuPassTiming {
+  std::string Name;
+  uint32_t Depth; /// Nesting level of the scope.
+  float Milliseconds;
+  bool HasStatistics;
+  GpuPipelineStatistics Statistics;
+};
+
+///
+/// Timestamp query profiler. Each frame slot owns a query pool, so a slot is only read back after
+/// the frame ring came around and its timeline value was waited, which never blocks on the GPU.
+///
+class VkGpuProfiler
+{
+public:
+  VkGpuProfiler();
+  ~VkGpuProfiler();
+
+  VKHRESULT Create(
+    VkDevice pDevice,
+    VkPhysicalDevice pPhysicalDevice,
+    uint32_t uQueueFamilyIndex,
+    uint32_t uFrameCount,
+    bool bPipelineStatistics,
+    uint32_t uMaxScopesPerFrame = 64
+  );
+
+  void Destroy();
+
+  bool IsSupported() const;
+  /// Requires the pipelineStatisticsQuery device feature.
+  bool IsPipelineStatisticsSupported() const;
+  /// Inherited by secondary command buffers executed within a collecting scope, which requires
+  /// the inheritedQueries device feature.
+  VkQueryPipelineStatisticFlags GetPipelineStatisticsFlags() const;
+
+  /// Read back the results of the slot's last frame, call it after the slot was waited. False
+  /// when the slot recorded nothing or its results were dropped.
+  bool ResolveFrame(uint32_t uFrameIndex);
+
+  /// Reset the slot's queries, record it before any scope and outside render passes.
+  void CmdResetFrame(VkCommandBuffer pCmdBuffer, uint32_t uFrameIndex);
+
+  /// Returns the scope index passed to `CmdEndScope`, or UINT32_MAX when out of queries.
+  /// Pipeline statistics can't nest, they are only collected by the outermost collecting scope.
+  uint32_t CmdBeginScope(VkCommandBuffer pCmdBuffer, const char *pszName,
+    bool bCollectStatistics = false);
+  void CmdEndScope(VkCommandBuffer pCmdBuffer, uint32_t uScope);
+
+  /// Timings of the latest resolved frame.
+  const std::vector<GpuPassTiming> &GetLastFrameTimings() const;
+  /// From the first begin to the last end of the latest resolved frame.
+  float GetLastFrameMs() const;
+  /// Sum of the scopes of the latest resolved frame, false without statistics.
+  bool GetLastFrameStatistics(_Out_opt_ GpuPipelineStatistics *pStatistics) const;
+
+  /// Append every resolved frame to a CSV file: frame, pass, depth, milliseconds, followed by
+  /// the pipeline statistics of the pass when collected.
+  VKHRESULT OpenCsvLog(_In_z_ const char *pszFileName);
+  void CloseCsvLog();
+
+private:
+  struct FrameQueries {
+    VkQueryPool pQueryPool;
+    VkQueryPool pStatisticsQueryPool;
+    std::vector<std::string> aScopeNames;
+    std::vector<uint32_t> aScopeDepths;
+    std::vector<uint32_t> aScopeStatistics; /// Statistics query of the scope, or UINT32_MAX.
+    uint32_t uStatisticsCount;
+    bool bRecorded;
+  };
+
+  VkDevice m_pDevice;
+  std::vector<FrameQueries> m_aFrames;
+  uint32_t m_uMaxScopesPerFrame;
+  uint32_t m_uRecordingFrame;
+  uint32_t m_uScopeDepth;
+  uint32_t m_uActiveStatisticsScope;
+  bool m_bPipelineStatistics;
+  float m_fTimestampPeriod; /// Nanoseconds per tick.
+  uint64_t m_uTimestampMask;
+
+  std::vector<uint64_t> m_aTimestamps;
+  std::vector<GpuPipelineStatistics> m_aStatistics;
+  std::vector<GpuPassTiming> m_aLastFrameTimings;
+  float m_fLastFrameMs;
+  GpuPipelineStatistics m_LastFrameStatistics;
+  bool m_bLastFrameHasStatistics;
+  uint64_t m_uResolvedFrameCount;
+
+  FILE *m_pCsvFile;
+};
+
+///
+/// Timestamps the commands recorded during its lifetime.
+///
+class VkGpuProfileScope
+{
+public:
+  VkGpuProfileScope(VkGpuProfiler *pProfiler, VkCommandBuffer pCmdBuffer, const char *pszName,
+                    bool bCollectStatistics = false)
+      : m_pProfiler(pProfiler), m_pCmdBuffer(pCmdBuffer) {
+    m_uScope = m_pProfiler->CmdBeginScope(m_pCmdBuffer, pszName, bCollectStatistics);
+  }
+  ~VkGpuProfileScope() {
+    m_pProfiler->CmdEndScope(m_pCmdBuffer, m_uScope);
+  }
+
+private:
+  VkGpuProfiler *m_pProfiler;
+  VkCommandBuffer m_pCmdBuffer;
+  uint32_t m_uScope;
+};
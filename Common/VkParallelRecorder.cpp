@@ -0,0 +1,209 @@
+#include "VkParallelRecorder.h"
+#include <algorithm>
+
+VkParallelRecorder::VkParallelRecorder() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_uThreadCount = 0;
+  m_uJobSerial = 0;
+  m_uPendingWorkers = 0;
+  m_bExit = false;
+  m_uFrameIndex = 0;
+  m_uItemCount = 0;
+  m_uRangeCount = 0;
+  m_pInheritanceInfo = nullptr;
+  m_pfnRecord = nullptr;
+}
+
+VkParallelRecorder::~VkParallelRecorder() {
+  _ASSERT(m_aPools.empty() && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkParallelRecorder::Create(
+  VkDevice pDevice,
+  uint32_t uQueueFamilyIndex,
+  uint32_t uFrameCount,
+  uint32_t uThreadCount
+) {
+  VKHRESULT hr = VK_SUCCESS;
+  VkCommandPoolCreateInfo poolInfo = {
+    VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, // sType;
+    nullptr, // pNext;
+    VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, // flags;
+    uQueueFamilyIndex // queueFamilyIndex;
+  };
+  uint32_t i;
+
+  m_pDevice = pDevice;
+  m_uThreadCount = std::max(1u, uThreadCount);
+  m_bExit = false;
+
+  /// No individual resets, the whole pool is reset with the frame slot.
+  m_aPools.assign(uFrameCount * m_uThreadCount, ThreadPool{});
+  for (auto &pool : m_aPools)
+    V_RETURN(vkCreateCommandPool(m_pDevice, &poolInfo, nullptr, &pool.pCommandPool));
+
+  for (i = 1; i < m_uThreadCount; ++i)
+    m_aWorkers.emplace_back(&VkParallelRecorder::WorkerMain, this, i);
+
+  return hr;
+}
+
+void VkParallelRecorder::Destroy() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bExit = true;
+  }
+  m_WorkCond.notify_all();
+  for (auto &worker : m_aWorkers)
+    worker.join();
+  m_aWorkers.clear();
+
+  /// Frees the command buffers along with them.
+  for (auto &pool : m_aPools)
+    vkDestroyCommandPool(m_pDevice, pool.pCommandPool, nullptr);
+  m_aPools.clear();
+  m_aRecorded.clear();
+}
+
+uint32_t VkParallelRecorder::GetThreadCount() const {
+  return m_uThreadCount;
+}
+
+VKHRESULT VkParallelRecorder::ResetFrame(uint32_t uFrameIndex) {
+  VKHRESULT hr = VK_SUCCESS;
+  uint32_t i;
+
+  /// The memory is kept for the next frame of the slot.
+  for (i = 0; i < m_uThreadCount; ++i) {
+    ThreadPool &pool = GetPool(uFrameIndex, i);
+    if (pool.uUsedCount) {
+      V_RETURN(vkResetCommandPool(m_pDevice, pool.pCommandPool, 0));
+      pool.uUsedCount = 0;
+    }
+  }
+
+  return hr;
+}
+
+VKHRESULT VkParallelRecorder::Record(
+  uint32_t uFrameIndex,
+  const VkCommandBufferInheritanceInfo &inheritanceInfo,
+  uint32_t uItemCount,
+  uint32_t uMinItemsPerThread,
+  const RecordFunc &fnRecord
+) {
+  VKHRESULT hr = VK_SUCCESS;
+  uint32_t uMinItems = std::max(1u, uMinItemsPerThread);
+
+  /// Published under the lock, a worker woken late by the previous job may still be looking.
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_uFrameIndex = uFrameIndex;
+    m_uItemCount = uItemCount;
+    m_uRangeCount = std::min(m_uThreadCount, (uItemCount + uMinItems - 1) / uMinItems);
+    m_pInheritanceInfo = &inheritanceInfo;
+    m_pfnRecord = &fnRecord;
+    m_aRecorded.assign(m_uRangeCount, VK_NULL_HANDLE);
+    m_aResults.assign(m_uRangeCount, VK_SUCCESS);
+    if (m_uRangeCount > 1) {
+      m_uPendingWorkers = m_uRangeCount - 1;
+      ++m_uJobSerial;
+    }
+  }
+
+  if (m_uRangeCount == 0)
+    return hr;
+  if (m_uRangeCount > 1)
+    m_WorkCond.notify_all();
+
+  m_aResults[0] = RecordRange(0);
+
+  if (m_uRangeCount > 1) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCond.wait(lock, [this]() { return m_uPendingWorkers == 0; });
+  }
+
+  m_pInheritanceInfo = nullptr;
+  m_pfnRecord = nullptr;
+
+  for (auto result : m_aResults) {
+    if (result != VK_SUCCESS)
+      return result;
+  }
+
+  return hr;
+}
+
+void VkParallelRecorder::CmdExecute(VkCommandBuffer pPrimaryCmdBuffer) const {
+  if (!m_aRecorded.empty())
+    vkCmdExecuteCommands(pPrimaryCmdBuffer, (uint32_t)m_aRecorded.size(), m_aRecorded.data());
+}
+
+VkParallelRecorder::ThreadPool &VkParallelRecorder::GetPool(uint32_t uFrameIndex,
+  uint32_t uThread) {
+  return m_aPools[uFrameIndex * m_uThreadCount + uThread];
+}
+
+VKHRESULT VkParallelRecorder::RecordRange(uint32_t uThread) {
+  VKHRESULT hr;
+  ThreadPool &pool = GetPool(m_uFrameIndex, uThread);
+  VkCommandBuffer pCmdBuffer;
+  uint32_t uBegin = (uint32_t)((uint64_t)m_uItemCount * uThread / m_uRangeCount);
+  uint32_t uEnd = (uint32_t)((uint64_t)m_uItemCount * (uThread + 1) / m_uRangeCount);
+  VkCommandBufferAllocateInfo allocInfo = {
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // sType;
+    nullptr, // pNext;
+    pool.pCommandPool, // commandPool;
+    VK_COMMAND_BUFFER_LEVEL_SECONDARY, // level;
+    1 // commandBufferCount;
+  };
+  VkCommandBufferBeginInfo beginInfo = {
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, // sType;
+    nullptr, // pNext;
+    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, // flags;
+    m_pInheritanceInfo // pInheritanceInfo;
+  };
+
+  if (pool.uUsedCount == pool.aCmdBuffers.size()) {
+    V_RETURN(vkAllocateCommandBuffers(m_pDevice, &allocInfo, &pCmdBuffer));
+    pool.aCmdBuffers.push_back(pCmdBuffer);
+  }
+  pCmdBuffer = pool.aCmdBuffers[pool.uUsedCount++];
+
+  V_RETURN(vkBeginCommandBuffer(pCmdBuffer, &beginInfo));
+  (*m_pfnRecord)(pCmdBuffer, uBegin, uEnd);
+  V_RETURN(vkEndCommandBuffer(pCmdBuffer));
+
+  m_aRecorded[uThread] = pCmdBuffer;
+
+  return hr;
+}
+
+void VkParallelRecorder::WorkerMain(uint32_t uThread) {
+  uint64_t uSeenSerial = 0;
+  bool bRecord;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_WorkCond.wait(lock, [&]() { return m_bExit || m_uJobSerial != uSeenSerial; });
+      if (m_bExit)
+        return;
+      uSeenSerial = m_uJobSerial;
+      bRecord = uThread < m_uRangeCount;
+    }
+
+    /// Threads beyond the ranges of the job sit it out.
+    if (!bRecord)
+      continue;
+
+    m_aResults[uThread] = RecordRange(uThread);
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (--m_uPendingWorkers == 0)
+        m_DoneCond.notify_one();
+    }
+  }
+}
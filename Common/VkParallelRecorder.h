@@ -0,0 +1,89 @@
+#pragma once
+#include "VkUtilities.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///
+/// Records the draws of a subpass on worker threads. Every thread owns a command pool per frame
+/// slot, so recording needs no locking and a slot's pools are reset as a whole once the slot was
+/// waited. The items are split into contiguous ranges, one secondary command buffer per thread,
+/// which the primary command buffer executes in item order. The calling thread records the first
+/// range itself.
+///
+class VkParallelRecorder
+{
+public:
+  /// Record the items `uBegin` to `uEnd` (exclusive) into a secondary command buffer.
+  using RecordFunc = std::function<void(VkCommandBuffer pCmdBuffer, uint32_t uBegin, uint32_t uEnd)>;
+
+  VkParallelRecorder();
+  ~VkParallelRecorder();
+
+  VKHRESULT Create(
+    VkDevice pDevice,
+    uint32_t uQueueFamilyIndex,
+    uint32_t uFrameCount,
+    uint32_t uThreadCount
+  );
+
+  /// Joins the workers, the device must be idle.
+  void Destroy();
+
+  /// Including the calling thread.
+  uint32_t GetThreadCount() const;
+
+  /// Reset every pool of the slot, call it after the slot's timeline value was waited.
+  VKHRESULT ResetFrame(uint32_t uFrameIndex);
+
+  /// Split `uItemCount` items over the threads, no range smaller than `uMinItemsPerThread`, and
+  /// record them within the render pass and subpass of `inheritanceInfo`. Blocks until every
+  /// range was recorded. May be called several times per frame.
+  VKHRESULT Record(
+    uint32_t uFrameIndex,
+    const VkCommandBufferInheritanceInfo &inheritanceInfo,
+    uint32_t uItemCount,
+    uint32_t uMinItemsPerThread,
+    const RecordFunc &fnRecord
+  );
+
+  /// Execute the buffers of the last `Record`, the subpass must have been begun with
+  /// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+  void CmdExecute(VkCommandBuffer pPrimaryCmdBuffer) const;
+
+private:
+  struct ThreadPool {
+    VkCommandPool pCommandPool;
+    /// Allocated on demand and kept, the pool reset only rewinds `uUsedCount`.
+    std::vector<VkCommandBuffer> aCmdBuffers;
+    uint32_t uUsedCount;
+  };
+
+  ThreadPool &GetPool(uint32_t uFrameIndex, uint32_t uThread);
+  VKHRESULT RecordRange(uint32_t uThread);
+  void WorkerMain(uint32_t uThread);
+
+  VkDevice m_pDevice;
+  uint32_t m_uThreadCount;
+  /// Indexed by frame slot, then by thread.
+  std::vector<ThreadPool> m_aPools;
+
+  std::vector<std::thread> m_aWorkers;
+  std::mutex m_Mutex;
+  std::condition_variable m_WorkCond;
+  std::condition_variable m_DoneCond;
+  uint64_t m_uJobSerial;
+  uint32_t m_uPendingWorkers;
+  bool m_bExit;
+
+  /// Job shared with the workers, only changed while none is pending.
+  uint32_t m_uFrameIndex;
+  uint32_t m_uItemCount;
+  uint32_t m_uRangeCount;
+  const VkCommandBufferInheritanceInfo *m_pInheritanceInfo;
+  const RecordFunc *m_pfnRecord;
+  std::vector<VkCommandBuffer> m_aRecorded; /// One per range, in item order.
+  std::vector<VKHRESULT> m_aResults;
+};
@@ -0,0 +1,220 @@
+#include "VkPersistentPipelineCache.h"
+#include <chrono>
+#include <string.h>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/// "VKPC", bump the header size when the layout changes.
+static const uint32_t s_uFileMagic = 0x43504b56;
+
+static uint64_t Fnv1a64(const void *pData, size_t uByteSize) {
+  const uint8_t *pBytes = (const uint8_t *)pData;
+  uint64_t uHash = 0xcbf29ce484222325ull;
+  size_t i;
+
+  for (i = 0; i < uByteSize; ++i) {
+    uHash ^= pBytes[i];
+    uHash *= 0x100000001b3ull;
+  }
+  return uHash;
+}
+
+VkPersistentPipelineCache::VkPersistentPipelineCache() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_Properties = {};
+  m_pPipelineCache = VK_NULL_HANDLE;
+  m_Stats = {};
+}
+
+VkPersistentPipelineCache::~VkPersistentPipelineCache() {
+  _ASSERT(!m_pPipelineCache && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkPersistentPipelineCache::Create(
+  VkDevice pDevice,
+  VkPhysicalDevice pPhysicalDevice,
+  _In_z_ const char *pszFileName
+) {
+  VKHRESULT hr;
+  std::string initialData;
+  VkPipelineCacheCreateInfo createInfo = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+
+  m_pDevice = pDevice;
+  m_FileName = pszFileName ? pszFileName : "";
+  m_Stats = {};
+  vkGetPhysicalDeviceProperties(pPhysicalDevice, &m_Properties);
+
+  if (!m_FileName.empty())
+    initialData = LoadFile();
+
+  createInfo.initialDataSize = initialData.size();
+  createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+  hr = vkCreatePipelineCache(m_pDevice, &createInfo, nullptr, &m_pPipelineCache);
+  if (hr != VK_SUCCESS && !initialData.empty()) {
+    /// The driver may still reject it, start over empty.
+    VK_TRACE("The pipeline cache %s was rejected by the driver.\n", m_FileName.c_str());
+    initialData.clear();
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+    hr = vkCreatePipelineCache(m_pDevice, &createInfo, nullptr, &m_pPipelineCache);
+  }
+  V_RETURN(hr);
+
+  m_Stats.WarmStart = !initialData.empty();
+  m_Stats.LoadedBytes = initialData.size();
+
+  return hr;
+}
+
+void VkPersistentPipelineCache::Destroy() {
+  VKHRESULT hr;
+
+  if (!m_pPipelineCache)
+    return;
+
+  if (!m_FileName.empty())
+    V(Save());
+
+  vkDestroyPipelineCache(m_pDevice, m_pPipelineCache, nullptr);
+  m_pPipelineCache = VK_NULL_HANDLE;
+}
+
+VkPipelineCache VkPersistentPipelineCache::GetPipelineCache() const {
+  return m_pPipelineCache;
+}
+
+VKHRESULT VkPersistentPipelineCache::CreateGraphicsPipelines(
+  uint32_t uCreateInfoCount,
+  const VkGraphicsPipelineCreateInfo *pCreateInfos,
+  VkPipeline *pPipelines
+) {
+  VKHRESULT hr;
+  auto start = std::chrono::steady_clock::now();
+
+  hr = vkCreateGraphicsPipelines(m_pDevice, m_pPipelineCache, uCreateInfoCount, pCreateInfos,
+    nullptr, pPipelines);
+
+  float fCreateMs =
+    std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(m_StatsMutex);
+  m_Stats.CreateMs += fCreateMs;
+  m_Stats.PipelineCount += uCreateInfoCount;
+
+  return hr;
+}
+
+VKHRESULT VkPersistentPipelineCache::CreateComputePipelines(
+  uint32_t uCreateInfoCount,
+  const VkComputePipelineCreateInfo *pCreateInfos,
+  VkPipeline *pPipelines
+) {
+  VKHRESULT hr;
+  auto start = std::chrono::steady_clock::now();
+
+  hr = vkCreateComputePipelines(m_pDevice, m_pPipelineCache, uCreateInfoCount, pCreateInfos,
+    nullptr, pPipelines);
+
+  float fCreateMs =
+    std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(m_StatsMutex);
+  m_Stats.CreateMs += fCreateMs;
+  m_Stats.PipelineCount += uCreateInfoCount;
+
+  return hr;
+}
+
+VKHRESULT VkPersistentPipelineCache::Save() {
+  VKHRESULT hr;
+  FileHeader header;
+  std::vector<uint8_t> data;
+  size_t uDataSize = 0;
+  std::string tempFileName = m_FileName + ".tmp";
+  FILE *fp;
+  bool bWritten;
+
+  V_RETURN(vkGetPipelineCacheData(m_pDevice, m_pPipelineCache, &uDataSize, nullptr));
+  data.resize(uDataSize);
+  V_RETURN(vkGetPipelineCacheData(m_pDevice, m_pPipelineCache, &uDataSize, data.data()));
+
+  InitHeader(&header);
+  header.uDataSize = uDataSize;
+  header.uChecksum = Fnv1a64(data.data(), uDataSize);
+
+  fp = fopen(tempFileName.c_str(), "wb");
+  V_RETURN(!(fp && !!"Can not write the pipeline cache!"));
+  bWritten = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             (uDataSize == 0 || fwrite(data.data(), uDataSize, 1, fp) == 1);
+  bWritten = fclose(fp) == 0 && bWritten;
+  if (!bWritten) {
+    remove(tempFileName.c_str());
+    V_RETURN(VK_ERROR_INITIALIZATION_FAILED);
+  }
+
+  /// Replace the old file in one step.
+#ifdef _WIN32
+  bWritten = !!MoveFileExA(tempFileName.c_str(), m_FileName.c_str(),
+    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+  bWritten = rename(tempFileName.c_str(), m_FileName.c_str()) == 0;
+#endif
+  if (!bWritten) {
+    remove(tempFileName.c_str());
+    V_RETURN(VK_ERROR_INITIALIZATION_FAILED);
+  }
+
+  return hr;
+}
+
+void VkPersistentPipelineCache::GetStats(_Out_opt_ PipelineCacheStats *pStats) const {
+  std::lock_guard<std::mutex> lock(m_StatsMutex);
+  if (pStats)
+    *pStats = m_Stats;
+}
+
+void VkPersistentPipelineCache::InitHeader(FileHeader *pHeader) const {
+  memset(pHeader, 0, sizeof(*pHeader));
+  pHeader->uMagic = s_uFileMagic;
+  pHeader->uHeaderSize = sizeof(FileHeader);
+  pHeader->uVendorID = m_Properties.vendorID;
+  pHeader->uDeviceID = m_Properties.deviceID;
+  pHeader->uDriverVersion = m_Properties.driverVersion;
+  memcpy(pHeader->aPipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+std::string VkPersistentPipelineCache::LoadFile() const {
+  FileHeader expected, header;
+  std::string data;
+  FILE *fp;
+  long fileSize;
+
+  fp = fopen(m_FileName.c_str(), "rb");
+  if (!fp)
+    return data;
+
+  fseek(fp, 0, SEEK_END);
+  fileSize = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  InitHeader(&expected);
+  /// The size is checked against the file before allocating, the header may be garbage.
+  if (fread(&header, sizeof(header), 1, fp) == 1 && header.uMagic == expected.uMagic &&
+    header.uHeaderSize == expected.uHeaderSize && header.uVendorID == expected.uVendorID &&
+    header.uDeviceID == expected.uDeviceID && header.uDriverVersion == expected.uDriverVersion &&
+    memcmp(header.aPipelineCacheUUID, expected.aPipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+    header.uDataSize == (uint64_t)fileSize - sizeof(header)) {
+    data.resize((size_t)header.uDataSize);
+    if (header.uDataSize == 0 || fread(&data[0], data.size(), 1, fp) != 1 ||
+      Fnv1a64(data.data(), data.size()) != header.uChecksum)
+      data.clear();
+  }
+  fclose(fp);
+
+  if (data.empty())
+    VK_TRACE("The pipeline cache %s is stale, starting cold.\n", m_FileName.c_str());
+
+  return data;
+}
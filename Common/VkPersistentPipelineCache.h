@@ -0,0 +1,76 @@
+#pragma once
+#include "VkUtilities.h"
+#include <mutex>
+#include <string>
+
+struct PipelineCacheStats {
+  bool WarmStart;         /// Data was loaded from disk and matched the device.
+  size_t LoadedBytes;
+  uint32_t PipelineCount; /// Created through the cache since startup.
+  float CreateMs;         /// Spent creating them.
+};
+
+///
+/// VkPipelineCache backed by a file. The data is prefixed with the vendor, device, driver version
+/// and pipeline cache UUID of the device it came from plus a checksum, and is only handed to the
+/// driver when all of them match. Writing goes to a temporary file which then replaces the old
+/// one, so a crash never leaves a truncated cache behind.
+///
+class VkPersistentPipelineCache
+{
+public:
+  VkPersistentPipelineCache();
+  ~VkPersistentPipelineCache();
+
+  /// Starts empty when the file is missing or stale, an empty name disables the persistence.
+  VKHRESULT Create(
+    VkDevice pDevice,
+    VkPhysicalDevice pPhysicalDevice,
+    _In_z_ const char *pszFileName
+  );
+
+  /// Saves the cache before destroying it.
+  void Destroy();
+
+  VkPipelineCache GetPipelineCache() const;
+
+  /// Timed pipeline creation through the cache, callable from any thread.
+  VKHRESULT CreateGraphicsPipelines(
+    uint32_t uCreateInfoCount,
+    const VkGraphicsPipelineCreateInfo *pCreateInfos,
+    VkPipeline *pPipelines
+  );
+  VKHRESULT CreateComputePipelines(
+    uint32_t uCreateInfoCount,
+    const VkComputePipelineCreateInfo *pCreateInfos,
+    VkPipeline *pPipelines
+  );
+
+  VKHRESULT Save();
+
+  void GetStats(_Out_opt_ PipelineCacheStats *pStats) const;
+
+private:
+  struct FileHeader {
+    uint32_t uMagic;
+    uint32_t uHeaderSize;
+    uint32_t uVendorID;
+    uint32_t uDeviceID;
+    uint32_t uDriverVersion;
+    uint8_t aPipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t uDataSize;
+    uint64_t uChecksum; /// FNV-1a of the data.
+  };
+
+  void InitHeader(FileHeader *pHeader) const;
+  /// Returns the data to seed the cache with, empty when missing or stale.
+  std::string LoadFile() const;
+
+  VkDevice m_pDevice;
+  VkPhysicalDeviceProperties m_Properties;
+  VkPipelineCache m_pPipelineCache;
+  std::string m_FileName;
+
+  mutable std::mutex m_StatsMutex;
+  PipelineCacheStats m_Stats;
+};
@@ -0,0 +1,209 @@
+#include "VkPipelineCompiler.h"
+#include "VkPersistentPipelineCache.h"
+#include <algorithm>
+
+VkPipelineCompiler::VkPipelineCompiler() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_pPipelineCache = nullptr;
+  m_bExit = false;
+  m_uPendingCount = 0;
+}
+
+VkPipelineCompiler::~VkPipelineCompiler() {
+  _ASSERT(m_aJobs.empty() && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkPipelineCompiler::Create(
+  VkDevice pDevice,
+  VkPersistentPipelineCache *pPipelineCache,
+  uint32_t uThreadCount
+) {
+  uint32_t i;
+
+  m_pDevice = pDevice;
+  m_pPipelineCache = pPipelineCache;
+  m_bExit = false;
+
+  for (i = 0; i < std::max(1u, uThreadCount); ++i)
+    m_aWorkers.emplace_back(&VkPipelineCompiler::WorkerMain, this);
+
+  return VK_SUCCESS;
+}
+
+void VkPipelineCompiler::Destroy() {
+  WaitIdle();
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bExit = true;
+  }
+  m_WorkCond.notify_all();
+  for (auto &worker : m_aWorkers)
+    worker.join();
+  m_aWorkers.clear();
+
+  for (auto &job : m_aJobs)
+    vkDestroyPipeline(m_pDevice, job.pPipeline, nullptr);
+  m_aJobs.clear();
+}
+
+VkPipelineCompiler::Handle VkPipelineCompiler::Submit(
+  _In_z_ const char *pszName,
+  VkGraphicsPipelineDesc &&desc
+) {
+  Handle hPipeline;
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    hPipeline = (Handle)m_aJobs.size();
+    m_aJobs.push_back(Job{pszName ? pszName : "", std::move(desc), VK_NULL_HANDLE, false,
+                          VK_SUCCESS, .0f, .0f, std::chrono::steady_clock::now()});
+    m_aQueue.push_back(hPipeline);
+    ++m_uPendingCount;
+  }
+  m_WorkCond.notify_one();
+
+  return hPipeline;
+}
+
+VkPipeline VkPipelineCompiler::GetPipeline(Handle hPipeline) const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return hPipeline < m_aJobs.size() ? m_aJobs[hPipeline].pPipeline : VK_NULL_HANDLE;
+}
+
+bool VkPipelineCompiler::IsReady(Handle hPipeline) const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return hPipeline < m_aJobs.size() && m_aJobs[hPipeline].bReady;
+}
+
+void VkPipelineCompiler::WaitIdle() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_IdleCond.wait(lock, [this]() { return m_uPendingCount == 0; });
+}
+
+void VkPipelineCompiler::GetStats(std::vector<PipelineCompileStats> *pStats) const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+
+  pStats->clear();
+  for (auto &job : m_aJobs)
+    pStats->push_back({job.Name, job.bReady, job.Result, job.CompileMs, job.QueuedMs});
+}
+
+VkShaderModule VkPipelineCompiler::CreateShaderModule(VkDevice pDevice,
+  const std::wstring &fileName, const std::vector<uint32_t> &code) {
+  if (code.empty())
+    return CreateShaderModuleFromSPIRVFile(pDevice, fileName.c_str());
+  return ::CreateShaderModule(pDevice, code.data(), code.size() * sizeof(uint32_t));
+}
+
+VKHRESULT VkPipelineCompiler::Compile(const VkGraphicsPipelineDesc &desc,
+  VkPipeline *ppPipeline) {
+  VKHRESULT hr = VK_SUCCESS;
+  VkShaderModule shaderModules[2] = {};
+  const VkShaderStageFlagBits aShaderStages[2] = {VK_SHADER_STAGE_VERTEX_BIT,
+    VK_SHADER_STAGE_FRAGMENT_BIT};
+  VkPipelineShaderStageCreateInfo shaderStageInfos[2] = {};
+  VkPipelineVertexInputStateCreateInfo VIinfo = {};
+  VkPipelineViewportStateCreateInfo VPinfo = {};
+  VkPipelineColorBlendStateCreateInfo BSinfo = {};
+  VkPipelineDynamicStateCreateInfo DSinfo = {};
+  VkGraphicsPipelineCreateInfo PSOinfo = {};
+  uint32_t i;
+
+  shaderModules[0] = CreateShaderModule(m_pDevice, desc.VertexShaderFile, desc.VertexShaderCode);
+  shaderModules[1] = CreateShaderModule(m_pDevice, desc.FragmentShaderFile,
+                                        desc.FragmentShaderCode);
+  if (!shaderModules[0] || !shaderModules[1])
+    hr = VK_ERROR_INITIALIZATION_FAILED;
+
+  if (hr == VK_SUCCESS) {
+    for (i = 0; i < _countof(shaderStageInfos); ++i) {
+      shaderStageInfos[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+      shaderStageInfos[i].stage = aShaderStages[i];
+      shaderStageInfos[i].module = shaderModules[i];
+      shaderStageInfos[i].pName = "main";
+    }
+
+    VIinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VIinfo.vertexBindingDescriptionCount = (uint32_t)desc.VertexBindings.size();
+    VIinfo.pVertexBindingDescriptions = desc.VertexBindings.data();
+    VIinfo.vertexAttributeDescriptionCount = (uint32_t)desc.VertexAttributes.size();
+    VIinfo.pVertexAttributeDescriptions = desc.VertexAttributes.data();
+
+    VPinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    VPinfo.viewportCount = desc.ViewportCount;
+    VPinfo.scissorCount = desc.ViewportCount;
+
+    BSinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    BSinfo.logicOpEnable = VK_FALSE;
+    BSinfo.logicOp = VK_LOGIC_OP_COPY;
+    BSinfo.attachmentCount = (uint32_t)desc.BlendAttachments.size();
+    BSinfo.pAttachments = desc.BlendAttachments.data();
+
+    DSinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    DSinfo.dynamicStateCount = (uint32_t)desc.DynamicStates.size();
+    DSinfo.pDynamicStates = desc.DynamicStates.data();
+
+    PSOinfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    PSOinfo.stageCount = _countof(shaderStageInfos);
+    PSOinfo.pStages = shaderStageInfos;
+    PSOinfo.pVertexInputState = &VIinfo;
+    PSOinfo.pInputAssemblyState = &desc.InputAssembly;
+    PSOinfo.pViewportState = &VPinfo;
+    PSOinfo.pRasterizationState = &desc.Rasterization;
+    PSOinfo.pMultisampleState = &desc.Multisample;
+    PSOinfo.pDepthStencilState = &desc.DepthStencil;
+    PSOinfo.pColorBlendState = &BSinfo;
+    PSOinfo.pDynamicState = &DSinfo;
+    PSOinfo.layout = desc.Layout;
+    PSOinfo.renderPass = desc.RenderPass;
+    PSOinfo.subpass = desc.Subpass;
+    PSOinfo.basePipelineHandle = VK_NULL_HANDLE;
+    PSOinfo.basePipelineIndex = -1;
+
+    hr = m_pPipelineCache->CreateGraphicsPipelines(1, &PSOinfo, ppPipeline);
+  }
+
+  vkDestroyShaderModule(m_pDevice, shaderModules[0], nullptr);
+  vkDestroyShaderModule(m_pDevice, shaderModules[1], nullptr);
+
+  return hr;
+}
+
+void VkPipelineCompiler::WorkerMain() {
+  Job *pJob;
+  VkPipeline pPipeline;
+  VKHRESULT hr;
+  std::chrono::steady_clock::time_point start;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_WorkCond.wait(lock, [this]() { return m_bExit || !m_aQueue.empty(); });
+      if (m_aQueue.empty())
+        return;
+      /// The deque never erases, the job stays put while the lock is released.
+      pJob = &m_aJobs[m_aQueue.front()];
+      m_aQueue.pop_front();
+    }
+
+    start = std::chrono::steady_clock::now();
+    pPipeline = VK_NULL_HANDLE;
+    hr = Compile(pJob->Desc, &pPipeline);
+    if (hr != VK_SUCCESS)
+      VK_TRACE("Failed to compile the pipeline %s.\n", pJob->Name.c_str());
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      pJob->pPipeline = pPipeline;
+      pJob->bReady = true;
+      pJob->Result = hr;
+      pJob->CompileMs = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+      pJob->QueuedMs =
+        std::chrono::duration<float, std::milli>(start - pJob->SubmitTime).count();
+      if (--m_uPendingCount == 0)
+        m_IdleCond.notify_all();
+    }
+  }
+}
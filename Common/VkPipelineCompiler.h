@@ -0,0 +1,110 @@
+#pragma once
+#include "VkUtilities.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VkPersistentPipelineCache;
+
+///
+/// Everything a graphics pipeline is created from, held by value so the description outlives the
+/// caller's stack while a worker compiles it. The shaders are loaded on the worker as well, unless
+/// their code was loaded beforehand.
+///
+struct VkGraphicsPipelineDesc {
+  std::wstring VertexShaderFile;
+  std::wstring FragmentShaderFile;
+  std::vector<uint32_t> VertexShaderCode;   /// Preferred over the file when not empty.
+  std::vector<uint32_t> FragmentShaderCode;
+  std::vector<VkVertexInputBindingDescription> VertexBindings;
+  std::vector<VkVertexInputAttributeDescription> VertexAttributes;
+  VkPipelineInputAssemblyStateCreateInfo InputAssembly;
+  uint32_t ViewportCount; /// Viewports and scissors are dynamic.
+  VkPipelineRasterizationStateCreateInfo Rasterization;
+  VkPipelineMultisampleStateCreateInfo Multisample;
+  VkPipelineDepthStencilStateCreateInfo DepthStencil;
+  std::vector<VkPipelineColorBlendAttachmentState> BlendAttachments;
+  std::vector<VkDynamicState> DynamicStates;
+  VkPipelineLayout Layout;
+  VkRenderPass RenderPass; /// Must stay alive until the pipeline is ready.
+  uint32_t Subpass;
+};
+
+struct PipelineCompileStats {
+  std::string Name;
+  bool Ready;
+  VKHRESULT Result; /// Of the compilation, once ready.
+  float CompileMs;  /// Shader loading included.
+  float QueuedMs;   /// From the submission to a worker picking it up.
+};
+
+///
+/// Compiles graphics pipelines on worker threads through the shared pipeline cache, which the
+/// driver synchronizes internally. `Submit` hands out a handle right away, draws look the pipeline
+/// up every frame and skip while it is not ready. The compiler owns the pipelines.
+///
+class VkPipelineCompiler
+{
+public:
+  using Handle = uint32_t;
+  static const Handle InvalidHandle = UINT32_MAX;
+
+  VkPipelineCompiler();
+  ~VkPipelineCompiler();
+
+  VKHRESULT Create(
+    VkDevice pDevice,
+    VkPersistentPipelineCache *pPipelineCache,
+    uint32_t uThreadCount
+  );
+
+  /// Joins the workers after the queued compilations and destroys the pipelines, the device must
+  /// be idle.
+  void Destroy();
+
+  Handle Submit(_In_z_ const char *pszName, VkGraphicsPipelineDesc &&desc);
+
+  /// VK_NULL_HANDLE until compiled, or when the compilation failed.
+  VkPipeline GetPipeline(Handle hPipeline) const;
+  bool IsReady(Handle hPipeline) const;
+
+  /// Block until every submitted pipeline is ready.
+  void WaitIdle();
+
+  void GetStats(std::vector<PipelineCompileStats> *pStats) const;
+
+private:
+  struct Job {
+    std::string Name;
+    VkGraphicsPipelineDesc Desc;
+    VkPipeline pPipeline;
+    bool bReady;
+    VKHRESULT Result;
+    float CompileMs;
+    float QueuedMs;
+    std::chrono::steady_clock::time_point SubmitTime;
+  };
+
+  static VkShaderModule CreateShaderModule(VkDevice pDevice, const std::wstring &fileName,
+                                           const std::vector<uint32_t> &code);
+  VKHRESULT Compile(const VkGraphicsPipelineDesc &desc, VkPipeline *ppPipeline);
+  void WorkerMain();
+
+  VkDevice m_pDevice;
+  VkPersistentPipelineCache *m_pPipelineCache;
+
+  std::vector<std::thread> m_aWorkers;
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_WorkCond;
+  std::condition_variable m_IdleCond;
+  bool m_bExit;
+
+  /// Never shrinks, so the handles are indices and the jobs keep their address.
+  std::deque<Job> m_aJobs;
+  std::deque<Handle> m_aQueue;
+  uint32_t m_uPendingCount; /// Queued or compiling.
+};
@@ -0,0 +1,850 @@
+#include "VkRenderGraph.h"
+#include <algorithm>
+#include <string.h>
+
+struct RenderGraphAccessInfo {
+  VkPipelineStageFlags Stages; /// Of graphics passes.
+  VkAccessFlags Access;
+  VkImageLayout Layout;
+  bool bWrite;
+  VkImageUsageFlags ImageUsage;
+  VkBufferUsageFlags BufferUsage;
+};
+
+static const VkPipelineStageFlags s_ShaderStages =
+    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+static const VkPipelineStageFlags s_DepthStencilStages =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+static const VkAccessFlags s_WriteAccess =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+/// In the order of `RenderGraphAccess`.
+static const RenderGraphAccessInfo s_aAccessInfos[(uint32_t)RenderGraphAccess::Count] = {
+  /// ColorAttachment
+  {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+   VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0},
+  /// ResolveAttachment
+  {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0},
+  /// DepthStencilAttachment
+  {s_DepthStencilStages,
+   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true,
+   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0},
+  /// DepthStencilReadOnly
+  {s_DepthStencilStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+   VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false,
+   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0},
+  /// ShaderRead
+  {s_ShaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false,
+   VK_IMAGE_USAGE_SAMPLED_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT},
+  /// ShaderWrite
+  {s_ShaderStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+   VK_IMAGE_LAYOUT_GENERAL, true, VK_IMAGE_USAGE_STORAGE_BIT,
+   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT},
+  /// UniformBuffer
+  {s_ShaderStages, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false, 0,
+   VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT},
+  /// VertexBuffer
+  {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+   VK_IMAGE_LAYOUT_UNDEFINED, false, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+  /// IndexBuffer
+  {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false,
+   0, VK_BUFFER_USAGE_INDEX_BUFFER_BIT},
+  /// IndirectBuffer
+  {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+   VK_IMAGE_LAYOUT_UNDEFINED, false, 0, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT},
+  /// TransferRead
+  {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false, VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+   VK_BUFFER_USAGE_TRANSFER_SRC_BIT},
+  /// TransferWrite
+  {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+   VK_BUFFER_USAGE_TRANSFER_DST_BIT},
+};
+
+static const RenderGraphAccessInfo &GetAccessInfo(RenderGraphAccess access) {
+  return s_aAccessInfos[(uint32_t)access];
+}
+
+static VkPipelineStageFlags GetStages(RenderGraphAccess access, RenderGraphPassType type) {
+  VkPipelineStageFlags stages = GetAccessInfo(access).Stages;
+
+  /// Shaders of the other passes are compute shaders.
+  if (type != RenderGraphPassType::Graphics && (stages & s_ShaderStages))
+    stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  return stages;
+}
+
+/// Whether the use depends on the previous contents, which keeps their writers alive.
+static bool ReadsContents(RenderGraphAccess access, VkAttachmentLoadOp loadOp) {
+  switch (access) {
+  case RenderGraphAccess::ColorAttachment:
+  case RenderGraphAccess::DepthStencilAttachment:
+    return loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+  case RenderGraphAccess::ResolveAttachment:
+  case RenderGraphAccess::TransferWrite:
+    return false;
+  default:
+    return true;
+  }
+}
+
+static VkImageAspectFlags GetAspectMask(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_D16_UNORM:
+  case VK_FORMAT_X8_D24_UNORM_PACK32:
+  case VK_FORMAT_D32_SFLOAT:
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+  case VK_FORMAT_S8_UINT:
+    return VK_IMAGE_ASPECT_STENCIL_BIT;
+  case VK_FORMAT_D16_UNORM_S8_UINT:
+  case VK_FORMAT_D24_UNORM_S8_UINT:
+  case VK_FORMAT_D32_SFLOAT_S8_UINT:
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+  default:
+    return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+VkRenderGraph::VkRenderGraph() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_bLazilyAllocated = false;
+  m_bCompiled = false;
+  m_uActivePassCount = 0;
+  m_uBarrierCount = 0;
+}
+
+VkRenderGraph::~VkRenderGraph() {
+  _ASSERT(m_aPools.empty() && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkRenderGraph::Create(VkDevice pDevice, uint32_t uFrameCount, bool bLazilyAllocated) {
+  m_pDevice = pDevice;
+  m_bLazilyAllocated = bLazilyAllocated;
+  m_aPools.resize(uFrameCount);
+
+  return VK_SUCCESS;
+}
+
+void VkRenderGraph::Destroy() {
+  for (auto &pool : m_aPools)
+    DestroyPool(&pool);
+  m_aPools.clear();
+
+  for (auto &entry : m_aRenderPasses)
+    vkDestroyRenderPass(m_pDevice, entry.pRenderPass, nullptr);
+  m_aRenderPasses.clear();
+
+  Reset();
+}
+
+void VkRenderGraph::Reset() {
+  m_aResources.clear();
+  m_aPasses.clear();
+  m_aFinalBarriers.clear();
+  m_bCompiled = false;
+  m_uActivePassCount = 0;
+  m_uBarrierCount = 0;
+}
+
+VkRenderGraph::ResourceId VkRenderGraph::AddResource(Resource &&resource) {
+  resource.uFirstPass = UINT32_MAX;
+  resource.uLastPass = 0;
+  resource.uPoolIndex = UINT32_MAX;
+  resource.State = {};
+  m_aResources.push_back(std::move(resource));
+  m_bCompiled = false;
+  return (ResourceId)m_aResources.size() - 1;
+}
+
+VkRenderGraph::ResourceId VkRenderGraph::ImportImage(
+  _In_z_ const char *pszName,
+  VkImage pImage,
+  VkImageView pView,
+  VkFormat format,
+  VkExtent2D extent,
+  VkSampleCountFlagBits samples,
+  const RenderGraphImportState &initialState,
+  VkImageLayout finalLayout
+) {
+  Resource resource = {};
+
+  resource.Name = pszName;
+  resource.bImage = true;
+  resource.bImported = true;
+  resource.bKeepContents = finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+  resource.pImage = pImage;
+  resource.pView = pView;
+  resource.Format = format;
+  resource.Extent = extent;
+  resource.Samples = samples;
+  resource.InitialState = initialState;
+  resource.FinalLayout = finalLayout;
+  return AddResource(std::move(resource));
+}
+
+VkRenderGraph::ResourceId VkRenderGraph::ImportBuffer(
+  _In_z_ const char *pszName,
+  VkBuffer pBuffer,
+  VkDeviceSize uSize,
+  const RenderGraphImportState &initialState,
+  bool bKeepContents
+) {
+  Resource resource = {};
+
+  resource.Name = pszName;
+  resource.bImported = true;
+  resource.bKeepContents = bKeepContents;
+  resource.pBuffer = pBuffer;
+  resource.uSize = uSize;
+  resource.InitialState = initialState;
+  return AddResource(std::move(resource));
+}
+
+VkRenderGraph::ResourceId VkRenderGraph::CreateImage(_In_z_ const char *pszName, VkFormat format,
+                                                     VkExtent2D extent,
+                                                     VkSampleCountFlagBits samples) {
+  Resource resource = {};
+
+  resource.Name = pszName;
+  resource.bImage = true;
+  resource.Format = format;
+  resource.Extent = extent;
+  resource.Samples = samples;
+  return AddResource(std::move(resource));
+}
+
+VkRenderGraph::ResourceId VkRenderGraph::CreateBuffer(_In_z_ const char *pszName,
+                                                      VkDeviceSize uSize) {
+  Resource resource = {};
+
+  resource.Name = pszName;
+  resource.uSize = uSize;
+  return AddResource(std::move(resource));
+}
+
+VkRenderGraph::PassId VkRenderGraph::AddPass(
+  _In_z_ const char *pszName,
+  RenderGraphPassType type,
+  ExecuteFunc &&fnExecute,
+  VkSubpassContents contents
+) {
+  Pass pass = {};
+
+  pass.Name = pszName;
+  pass.Type = type;
+  pass.fnExecute = std::move(fnExecute);
+  pass.Contents = contents;
+  m_aPasses.push_back(std::move(pass));
+  m_bCompiled = false;
+  return (PassId)m_aPasses.size() - 1;
+}
+
+void VkRenderGraph::AddUse(PassId pass, const Use &use) {
+  _ASSERT(pass < m_aPasses.size() && use.Target < m_aResources.size());
+  Resource &resource = m_aResources[use.Target];
+  const RenderGraphAccessInfo &info = GetAccessInfo(use.Access);
+
+  _ASSERT((resource.bImage || !info.ImageUsage) && "Attachments must be images!");
+  resource.ImageUsage |= info.ImageUsage;
+  resource.BufferUsage |= info.BufferUsage;
+  m_aPasses[pass].aUses.push_back(use);
+  m_bCompiled = false;
+}
+
+void VkRenderGraph::UseColorAttachment(PassId pass, ResourceId image, VkAttachmentLoadOp loadOp,
+                                       const VkClearColorValue &clearColor, ResourceId resolve) {
+  Use use = {image, RenderGraphAccess::ColorAttachment, loadOp, {}, resolve};
+
+  use.ClearValue.color = clearColor;
+  AddUse(pass, use);
+  if (resolve != InvalidResource)
+    AddUse(pass, Use{resolve, RenderGraphAccess::ResolveAttachment,
+                     VK_ATTACHMENT_LOAD_OP_DONT_CARE, {}, InvalidResource});
+}
+
+void VkRenderGraph::UseDepthStencilAttachment(PassId pass, ResourceId image,
+                                              VkAttachmentLoadOp loadOp,
+                                              const VkClearDepthStencilValue &clearValue,
+                                              bool bReadOnly) {
+  Use use = {image,
+             bReadOnly ? RenderGraphAccess::DepthStencilReadOnly
+                       : RenderGraphAccess::DepthStencilAttachment,
+             loadOp, {}, InvalidResource};
+
+  use.ClearValue.depthStencil = clearValue;
+  AddUse(pass, use);
+}
+
+void VkRenderGraph::UseImage(PassId pass, ResourceId image, RenderGraphAccess access) {
+  AddUse(pass, Use{image, access, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {}, InvalidResource});
+}
+
+void VkRenderGraph::UseBuffer(PassId pass, ResourceId buffer, RenderGraphAccess access) {
+  AddUse(pass, Use{buffer, access, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {}, InvalidResource});
+}
+
+VKHRESULT VkRenderGraph::Compile() {
+  VKHRESULT hr = VK_SUCCESS;
+  bool bAttachments;
+
+  for (auto &pass : m_aPasses) {
+    bAttachments = std::any_of(pass.aUses.begin(), pass.aUses.end(), [](const Use &use) {
+      return GetAccessInfo(use.Access).ImageUsage &
+             (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    });
+    V_RETURN(!((bAttachments == (pass.Type == RenderGraphPassType::Graphics)) &&
+               !!("Only graphics passes have attachments, and at least one!")));
+  }
+
+  Cull();
+  ComputeBarriers();
+  m_bCompiled = true;
+
+  return hr;
+}
+
+void VkRenderGraph::Cull() {
+  std::vector<bool> aNeeded(m_aResources.size());
+  uint32_t i;
+
+  for (i = 0; i < m_aResources.size(); ++i)
+    aNeeded[i] = m_aResources[i].bImported && m_aResources[i].bKeepContents;
+
+  /// Backwards, a pass writing what a later pass needs makes its own inputs needed.
+  m_uActivePassCount = 0;
+  for (i = (uint32_t)m_aPasses.size(); i-- > 0;) {
+    Pass &pass = m_aPasses[i];
+
+    pass.bActive = std::any_of(pass.aUses.begin(), pass.aUses.end(), [&](const Use &use) {
+      return GetAccessInfo(use.Access).bWrite && aNeeded[use.Target];
+    });
+    if (!pass.bActive)
+      continue;
+
+    for (auto &use : pass.aUses) {
+      if (ReadsContents(use.Access, use.LoadOp))
+        aNeeded[use.Target] = true;
+    }
+    ++m_uActivePassCount;
+  }
+}
+
+void VkRenderGraph::ComputeBarriers() {
+  std::vector<Use> aAttachments;
+  /// Transients which ended, whose memory the ones starting may alias.
+  VkPipelineStageFlags aliasStages = 0;
+  VkAccessFlags aliasAccess = 0;
+  VkPipelineStageFlags stages;
+  VkAccessFlags access;
+  VkImageLayout layout;
+  Barrier barrier;
+  bool bWrite, bLayout, bStore;
+  uint32_t p, q, i;
+
+  for (auto &resource : m_aResources) {
+    const RenderGraphImportState &initial = resource.InitialState;
+
+    resource.uFirstPass = UINT32_MAX;
+    resource.uLastPass = 0;
+    resource.State = {initial.Layout, initial.Access ? initial.Stages : 0, initial.Access,
+                      initial.Access ? 0 : initial.Stages, 0};
+  }
+
+  for (p = 0; p < m_aPasses.size(); ++p) {
+    if (!m_aPasses[p].bActive)
+      continue;
+    for (auto &use : m_aPasses[p].aUses) {
+      m_aResources[use.Target].uFirstPass = std::min(m_aResources[use.Target].uFirstPass, p);
+      m_aResources[use.Target].uLastPass = std::max(m_aResources[use.Target].uLastPass, p);
+    }
+  }
+
+  m_uBarrierCount = 0;
+  m_aFinalBarriers.clear();
+  for (p = 0; p < m_aPasses.size(); ++p) {
+    Pass &pass = m_aPasses[p];
+
+    pass.aBarriers.clear();
+    pass.aStoreOps.clear();
+    pass.aFinalLayouts.clear();
+    if (!pass.bActive)
+      continue;
+
+    for (auto &resource : m_aResources) {
+      if (!resource.bImported && resource.uFirstPass == p) {
+        resource.State.WriteStages = aliasStages;
+        resource.State.WriteAccess = aliasAccess;
+      }
+    }
+
+    for (auto &use : pass.aUses) {
+      Resource &resource = m_aResources[use.Target];
+      ResourceState &state = resource.State;
+
+      stages = GetStages(use.Access, pass.Type);
+      access = GetAccessInfo(use.Access).Access;
+      layout = resource.bImage ? GetAccessInfo(use.Access).Layout : VK_IMAGE_LAYOUT_UNDEFINED;
+      bWrite = GetAccessInfo(use.Access).bWrite;
+      bLayout = resource.bImage && layout != state.Layout;
+      barrier = {use.Target, 0, 0, stages, access, state.Layout, bLayout ? layout : state.Layout};
+
+      if (bLayout || bWrite) {
+        /// Waits for the readers as well, a write or a transition must not overtake them.
+        barrier.SrcStages = state.WriteStages | state.ReadStages;
+        barrier.SrcAccess = state.WriteAccess;
+        if (bLayout || barrier.SrcStages)
+          pass.aBarriers.push_back(barrier);
+
+        /// A transition is a write as well, later readers chain on the pass's stages.
+        if (bWrite)
+          state = {layout, stages, access & s_WriteAccess, 0, 0};
+        else
+          state = {layout, stages, 0, stages, access};
+      } else {
+        /// Reads of the same write only need a barrier for stages or access not yet covered.
+        if (state.WriteStages &&
+            ((stages & ~state.ReadStages) || (access & ~state.ReadAccess))) {
+          barrier.SrcStages = state.WriteStages;
+          barrier.SrcAccess = state.WriteAccess;
+          pass.aBarriers.push_back(barrier);
+        }
+        state.ReadStages |= stages;
+        state.ReadAccess |= access;
+      }
+    }
+    if (!pass.aBarriers.empty())
+      ++m_uBarrierCount;
+
+    if (pass.Type == RenderGraphPassType::Graphics) {
+      GetAttachments(pass, &aAttachments);
+      for (i = 0; i < aAttachments.size(); ++i) {
+        Resource &resource = m_aResources[aAttachments[i].Target];
+
+        /// Stored only when the next frame or a later pass reads the contents.
+        bStore = resource.bImported && resource.bKeepContents;
+        for (q = p + 1; q < m_aPasses.size() && !bStore; ++q) {
+          if (!m_aPasses[q].bActive)
+            continue;
+          for (auto &use : m_aPasses[q].aUses) {
+            if (use.Target == aAttachments[i].Target && ReadsContents(use.Access, use.LoadOp))
+              bStore = true;
+          }
+        }
+        pass.aStoreOps.push_back(bStore ? VK_ATTACHMENT_STORE_OP_STORE
+                                        : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+
+        /// The last render pass of an imported image transitions it for after the frame.
+        layout = GetAccessInfo(aAttachments[i].Access).Layout;
+        if (resource.bImported && resource.bKeepContents && resource.uLastPass == p) {
+          layout = resource.FinalLayout;
+          resource.State.Layout = layout;
+        }
+        pass.aFinalLayouts.push_back(layout);
+      }
+    }
+
+    for (auto &resource : m_aResources) {
+      if (!resource.bImported && resource.uLastPass == p &&
+          resource.uFirstPass != UINT32_MAX) {
+        aliasStages |= resource.State.WriteStages | resource.State.ReadStages;
+        aliasAccess |= resource.State.WriteAccess;
+      }
+    }
+  }
+
+  for (i = 0; i < m_aResources.size(); ++i) {
+    Resource &resource = m_aResources[i];
+
+    if (!resource.bImage || !resource.bImported || !resource.bKeepContents ||
+        resource.State.Layout == resource.FinalLayout)
+      continue;
+    m_aFinalBarriers.push_back(Barrier{i, resource.State.WriteStages | resource.State.ReadStages,
+                                       resource.State.WriteAccess,
+                                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                       resource.State.Layout, resource.FinalLayout});
+  }
+  if (!m_aFinalBarriers.empty())
+    ++m_uBarrierCount;
+}
+
+void VkRenderGraph::GetAttachments(const Pass &pass, std::vector<Use> *pAttachments) const {
+  pAttachments->clear();
+
+  for (auto &use : pass.aUses) {
+    if (use.Access == RenderGraphAccess::ColorAttachment)
+      pAttachments->push_back(use);
+  }
+  for (auto &use : pass.aUses) {
+    if (use.Access == RenderGraphAccess::DepthStencilAttachment ||
+        use.Access == RenderGraphAccess::DepthStencilReadOnly)
+      pAttachments->push_back(use);
+  }
+  for (auto &use : pass.aUses) {
+    if (use.Access == RenderGraphAccess::ColorAttachment && use.Resolve != InvalidResource)
+      pAttachments->push_back(Use{use.Resolve, RenderGraphAccess::ResolveAttachment,
+                                  VK_ATTACHMENT_LOAD_OP_DONT_CARE, {}, InvalidResource});
+  }
+}
+
+VKHRESULT VkRenderGraph::AllocateTransients(FramePool *pPool) {
+  VKHRESULT hr = VK_SUCCESS;
+  std::vector<PoolEntry> aEntries;
+  PoolEntry entry;
+  VkImageCreateInfo imageInfo;
+  VkBufferCreateInfo bufferInfo;
+  VkImageViewCreateInfo viewInfo;
+  VkImageView pView;
+  bool bReuse;
+  uint32_t i;
+
+  for (auto &resource : m_aResources) {
+    if (resource.bImported || resource.uFirstPass == UINT32_MAX)
+      continue;
+    resource.uPoolIndex = (uint32_t)aEntries.size();
+    entry = {resource.bImage,    resource.Format,
+             resource.Extent,    resource.Samples,
+             resource.uSize,     resource.bImage ? resource.ImageUsage : resource.BufferUsage,
+             resource.uFirstPass, resource.uLastPass};
+    aEntries.push_back(entry);
+  }
+
+  bReuse = aEntries.size() == pPool->aEntries.size();
+  for (i = 0; bReuse && i < aEntries.size(); ++i) {
+    const PoolEntry &a = aEntries[i], &b = pPool->aEntries[i];
+    bReuse = a.bImage == b.bImage && a.Format == b.Format && a.Extent.width == b.Extent.width &&
+             a.Extent.height == b.Extent.height && a.Samples == b.Samples &&
+             a.uSize == b.uSize && a.Usage == b.Usage && a.uFirstPass == b.uFirstPass &&
+             a.uLastPass == b.uLastPass;
+  }
+
+  /// The slot's previous frame completed, nothing uses the old resources anymore.
+  if (!bReuse) {
+    DestroyPool(pPool);
+
+    for (auto &e : aEntries) {
+      if (e.bImage) {
+        imageInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = e.Format;
+        imageInfo.extent = {e.Extent.width, e.Extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = e.Samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = e.Usage;
+        /// Attachments only, never leaving the tiles.
+        if (!(e.Usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)))
+          imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        pPool->Allocator.AddImage(imageInfo, e.uFirstPass, e.uLastPass);
+      } else {
+        bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufferInfo.size = e.uSize;
+        bufferInfo.usage = e.Usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        pPool->Allocator.AddBuffer(bufferInfo, e.uFirstPass, e.uLastPass);
+      }
+    }
+    V(pPool->Allocator.Allocate(m_pDevice, m_bLazilyAllocated));
+
+    for (i = 0; VK_SUCCEEDED(hr) && i < aEntries.size(); ++i) {
+      pView = VK_NULL_HANDLE;
+      if (aEntries[i].bImage) {
+        viewInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        viewInfo.image = pPool->Allocator.GetImage(i);
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = aEntries[i].Format;
+        viewInfo.subresourceRange = {GetAspectMask(aEntries[i].Format), 0, 1, 0, 1};
+        V(vkCreateImageView(m_pDevice, &viewInfo, nullptr, &pView));
+      }
+      pPool->aViews.push_back(pView);
+    }
+
+    if (VK_FAILED(hr)) {
+      DestroyPool(pPool);
+      return hr;
+    }
+    pPool->aEntries = std::move(aEntries);
+  }
+
+  for (auto &resource : m_aResources) {
+    if (resource.uPoolIndex == UINT32_MAX)
+      continue;
+    resource.pImage = pPool->Allocator.GetImage(resource.uPoolIndex);
+    resource.pView = pPool->aViews[resource.uPoolIndex];
+    resource.pBuffer = pPool->Allocator.GetBuffer(resource.uPoolIndex);
+  }
+
+  return hr;
+}
+
+VKHRESULT VkRenderGraph::GetRenderPass(const Pass &pass, const std::vector<Use> &aAttachments,
+                                       VkRenderPass *ppRenderPass) {
+  VKHRESULT hr = VK_SUCCESS;
+  RenderPassEntry entry = {};
+  VkAttachmentDescription description;
+  std::vector<VkAttachmentReference> aColorRefs, aResolveRefs;
+  std::vector<uint32_t> aResolvedColors;
+  VkAttachmentReference depthStencilRef = {};
+  VkSubpassDescription subpass = {};
+  VkRenderPassCreateInfo createInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+  uint32_t i, uResolve = 0;
+
+  for (i = 0; i < aAttachments.size(); ++i) {
+    const Use &attachment = aAttachments[i];
+    const Resource &resource = m_aResources[attachment.Target];
+    VkImageLayout layout = GetAccessInfo(attachment.Access).Layout;
+    bool bStencil = (GetAspectMask(resource.Format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+    /// Zeroed, the descriptions are compared as memory.
+    memset(&description, 0, sizeof(description));
+    description.format = resource.Format;
+    description.samples = resource.Samples;
+    description.loadOp = attachment.LoadOp;
+    description.storeOp = pass.aStoreOps[i];
+    description.stencilLoadOp = bStencil ? attachment.LoadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    description.stencilStoreOp = bStencil ? pass.aStoreOps[i] : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    description.initialLayout = layout;
+    description.finalLayout = pass.aFinalLayouts[i];
+    entry.aAttachments.push_back(description);
+
+    switch (attachment.Access) {
+    case RenderGraphAccess::ColorAttachment:
+      if (attachment.Resolve != InvalidResource) {
+        entry.uResolveMask |= 1u << entry.uColorCount;
+        aResolvedColors.push_back(entry.uColorCount);
+      }
+      aColorRefs.push_back({i, layout});
+      aResolveRefs.push_back({VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+      ++entry.uColorCount;
+      break;
+    case RenderGraphAccess::ResolveAttachment:
+      aResolveRefs[aResolvedColors[uResolve++]] = {i, layout};
+      break;
+    default:
+      entry.bDepthStencil = true;
+      entry.bDepthStencilReadOnly = attachment.Access == RenderGraphAccess::DepthStencilReadOnly;
+      depthStencilRef = {i, layout};
+      break;
+    }
+  }
+
+  for (auto &cached : m_aRenderPasses) {
+    if (cached.uColorCount == entry.uColorCount && cached.bDepthStencil == entry.bDepthStencil &&
+        cached.bDepthStencilReadOnly == entry.bDepthStencilReadOnly &&
+        cached.uResolveMask == entry.uResolveMask &&
+        cached.aAttachments.size() == entry.aAttachments.size() &&
+        !memcmp(cached.aAttachments.data(), entry.aAttachments.data(),
+                entry.aAttachments.size() * sizeof(VkAttachmentDescription))) {
+      *ppRenderPass = cached.pRenderPass;
+      return hr;
+    }
+  }
+
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = entry.uColorCount;
+  subpass.pColorAttachments = aColorRefs.data();
+  subpass.pResolveAttachments = entry.uResolveMask ? aResolveRefs.data() : nullptr;
+  subpass.pDepthStencilAttachment = entry.bDepthStencil ? &depthStencilRef : nullptr;
+
+  /// No dependencies, the graph's barriers before the pass synchronize it.
+  createInfo.attachmentCount = (uint32_t)entry.aAttachments.size();
+  createInfo.pAttachments = entry.aAttachments.data();
+  createInfo.subpassCount = 1;
+  createInfo.pSubpasses = &subpass;
+
+  V_RETURN(vkCreateRenderPass(m_pDevice, &createInfo, nullptr, &entry.pRenderPass));
+  m_aRenderPasses.push_back(std::move(entry));
+  *ppRenderPass = m_aRenderPasses.back().pRenderPass;
+
+  return hr;
+}
+
+VKHRESULT VkRenderGraph::GetFramebuffer(FramePool *pPool, VkRenderPass pRenderPass,
+                                        const std::vector<Use> &aAttachments,
+                                        VkFramebuffer *ppFramebuffer, VkExtent2D *pExtent) {
+  VKHRESULT hr = VK_SUCCESS;
+  FramebufferEntry entry = {pRenderPass, {}, m_aResources[aAttachments[0].Target].Extent,
+                            VK_NULL_HANDLE, true};
+  VkFramebufferCreateInfo createInfo = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+
+  for (auto &attachment : aAttachments)
+    entry.aViews.push_back(m_aResources[attachment.Target].pView);
+  *pExtent = entry.Extent;
+
+  for (auto &cached : pPool->aFramebuffers) {
+    if (cached.pRenderPass == pRenderPass && cached.aViews == entry.aViews &&
+        cached.Extent.width == entry.Extent.width && cached.Extent.height == entry.Extent.height) {
+      cached.bUsed = true;
+      *ppFramebuffer = cached.pFramebuffer;
+      return hr;
+    }
+  }
+
+  createInfo.renderPass = pRenderPass;
+  createInfo.attachmentCount = (uint32_t)entry.aViews.size();
+  createInfo.pAttachments = entry.aViews.data();
+  createInfo.width = entry.Extent.width;
+  createInfo.height = entry.Extent.height;
+  createInfo.layers = 1;
+
+  V_RETURN(vkCreateFramebuffer(m_pDevice, &createInfo, nullptr, &entry.pFramebuffer));
+  *ppFramebuffer = entry.pFramebuffer;
+  pPool->aFramebuffers.push_back(std::move(entry));
+
+  return hr;
+}
+
+void VkRenderGraph::CmdBarriers(VkCommandBuffer pCmdBuffer,
+                                const std::vector<Barrier> &aBarriers) const {
+  VkMemoryBarrier memoryBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  std::vector<VkImageMemoryBarrier> aImageBarriers;
+  VkImageMemoryBarrier imageBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  VkPipelineStageFlags srcStages = 0, dstStages = 0;
+
+  if (aBarriers.empty())
+    return;
+
+  /// Layout transitions need an image barrier, everything else folds into one memory barrier.
+  for (auto &barrier : aBarriers) {
+    srcStages |= barrier.SrcStages;
+    dstStages |= barrier.DstStages;
+    if (barrier.OldLayout != barrier.NewLayout) {
+      imageBarrier.srcAccessMask = barrier.SrcAccess;
+      imageBarrier.dstAccessMask = barrier.DstAccess;
+      imageBarrier.oldLayout = barrier.OldLayout;
+      imageBarrier.newLayout = barrier.NewLayout;
+      imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      imageBarrier.image = m_aResources[barrier.Target].pImage;
+      imageBarrier.subresourceRange = {GetAspectMask(m_aResources[barrier.Target].Format), 0,
+                                       VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+      aImageBarriers.push_back(imageBarrier);
+    } else {
+      memoryBarrier.srcAccessMask |= barrier.SrcAccess;
+      memoryBarrier.dstAccessMask |= barrier.DstAccess;
+    }
+  }
+
+  /// Nothing ran before a first transition.
+  if (!srcStages)
+    srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+  vkCmdPipelineBarrier(pCmdBuffer, srcStages, dstStages, 0,
+                       (memoryBarrier.srcAccessMask || memoryBarrier.dstAccessMask) ? 1 : 0,
+                       &memoryBarrier, 0, nullptr, (uint32_t)aImageBarriers.size(),
+                       aImageBarriers.data());
+}
+
+VKHRESULT VkRenderGraph::Execute(VkCommandBuffer pCmdBuffer, uint32_t uFrameIndex) {
+  VKHRESULT hr = VK_SUCCESS;
+  FramePool *pPool;
+  std::vector<Use> aAttachments;
+  std::vector<VkClearValue> aClearValues;
+  RenderGraphPassContext context;
+  VkRenderPassBeginInfo beginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+  VkExtent2D extent;
+
+  if (!m_bCompiled)
+    V_RETURN(Compile());
+
+  _ASSERT(uFrameIndex < m_aPools.size());
+  pPool = &m_aPools[uFrameIndex];
+  V_RETURN(AllocateTransients(pPool));
+
+  for (auto &framebuffer : pPool->aFramebuffers)
+    framebuffer.bUsed = false;
+
+  for (auto &pass : m_aPasses) {
+    if (!pass.bActive)
+      continue;
+
+    CmdBarriers(pCmdBuffer, pass.aBarriers);
+    context = {pCmdBuffer, VK_NULL_HANDLE, VK_NULL_HANDLE, {}, uFrameIndex};
+    if (pass.Type != RenderGraphPassType::Graphics) {
+      pass.fnExecute(context);
+      continue;
+    }
+
+    GetAttachments(pass, &aAttachments);
+    V_RETURN(GetRenderPass(pass, aAttachments, &context.pRenderPass));
+    V_RETURN(
+        GetFramebuffer(pPool, context.pRenderPass, aAttachments, &context.pFramebuffer, &extent));
+    context.RenderArea = {{0, 0}, extent};
+
+    aClearValues.clear();
+    for (auto &attachment : aAttachments)
+      aClearValues.push_back(attachment.ClearValue);
+
+    beginInfo.renderPass = context.pRenderPass;
+    beginInfo.framebuffer = context.pFramebuffer;
+    beginInfo.renderArea = context.RenderArea;
+    beginInfo.clearValueCount = (uint32_t)aClearValues.size();
+    beginInfo.pClearValues = aClearValues.data();
+    vkCmdBeginRenderPass(pCmdBuffer, &beginInfo, pass.Contents);
+    pass.fnExecute(context);
+    vkCmdEndRenderPass(pCmdBuffer);
+  }
+
+  CmdBarriers(pCmdBuffer, m_aFinalBarriers);
+
+  /// Only the slot's frames used them, and its previous frame completed.
+  auto itUnused = std::remove_if(pPool->aFramebuffers.begin(), pPool->aFramebuffers.end(),
+                                 [this](const FramebufferEntry &framebuffer) {
+                                   if (!framebuffer.bUsed)
+                                     vkDestroyFramebuffer(m_pDevice, framebuffer.pFramebuffer,
+                                                          nullptr);
+                                   return !framebuffer.bUsed;
+                                 });
+  pPool->aFramebuffers.erase(itUnused, pPool->aFramebuffers.end());
+
+  return hr;
+}
+
+VkImage VkRenderGraph::GetImage(ResourceId image) const {
+  return image < m_aResources.size() ? m_aResources[image].pImage : VK_NULL_HANDLE;
+}
+
+VkImageView VkRenderGraph::GetImageView(ResourceId image) const {
+  return image < m_aResources.size() ? m_aResources[image].pView : VK_NULL_HANDLE;
+}
+
+VkBuffer VkRenderGraph::GetBuffer(ResourceId buffer) const {
+  return buffer < m_aResources.size() ? m_aResources[buffer].pBuffer : VK_NULL_HANDLE;
+}
+
+uint32_t VkRenderGraph::GetActivePassCount() const {
+  return m_uActivePassCount;
+}
+
+uint32_t VkRenderGraph::GetBarrierCount() const {
+  return m_uBarrierCount;
+}
+
+void VkRenderGraph::ReleaseFramebuffers(std::vector<VkFramebuffer> *pFramebuffers) {
+  for (auto &pool : m_aPools) {
+    for (auto &framebuffer : pool.aFramebuffers)
+      pFramebuffers->push_back(framebuffer.pFramebuffer);
+    pool.aFramebuffers.clear();
+  }
+}
+
+void VkRenderGraph::DestroyPool(FramePool *pPool) {
+  for (auto &framebuffer : pPool->aFramebuffers)
+    vkDestroyFramebuffer(m_pDevice, framebuffer.pFramebuffer, nullptr);
+  for (auto pView : pPool->aViews)
+    vkDestroyImageView(m_pDevice, pView, nullptr);
+  pPool->Allocator.Destroy(m_pDevice);
+
+  pPool->aFramebuffers.clear();
+  pPool->aViews.clear();
+  pPool->aEntries.clear();
+}
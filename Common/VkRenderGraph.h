@@ -0,0 +1,268 @@
+#pragma once
+#include "VkTransientAllocator.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/// How a pass uses a resource, mapped to the pipeline stages, access and image layout.
+enum class RenderGraphAccess : uint32_t {
+  ColorAttachment,        /// Declared by `UseColorAttachment`.
+  ResolveAttachment,      /// Declared by `UseColorAttachment`.
+  DepthStencilAttachment, /// Declared by `UseDepthStencilAttachment`.
+  DepthStencilReadOnly,   /// Declared by `UseDepthStencilAttachment`.
+  ShaderRead,             /// Sampled image or storage buffer read by the pass's shaders.
+  ShaderWrite,            /// Storage image or buffer.
+  UniformBuffer,
+  VertexBuffer,
+  IndexBuffer,
+  IndirectBuffer,
+  TransferRead,
+  TransferWrite,
+  Count
+};
+
+enum class RenderGraphPassType : uint32_t {
+  Graphics, /// Runs within a render pass made of its attachments.
+  Compute,
+  Transfer,
+};
+
+/// What an imported resource went through before the frame, waited by its first use.
+struct RenderGraphImportState {
+  VkImageLayout Layout; /// UNDEFINED discards the contents.
+  VkPipelineStageFlags Stages;
+  VkAccessFlags Access; /// Writes to make visible.
+};
+
+/// Passed to the pass when it executes.
+struct RenderGraphPassContext {
+  VkCommandBuffer pCmdBuffer;
+  /// Graphics passes only, for the inheritance of secondary command buffers.
+  VkRenderPass pRenderPass;
+  VkFramebuffer pFramebuffer;
+  VkRect2D RenderArea;
+  uint32_t uFrameIndex;
+};
+
+///
+/// Frame graph, rebuilt every frame. Passes declare the images and buffers they read and write,
+/// passes contributing to no imported resource are culled, and the barriers and layout
+/// transitions needed before each pass are batched into a single pipeline barrier. Graphics
+/// passes get a render pass and framebuffer from caches, storing only what a later pass or the
+/// next frame reads. Resources created by the graph live from their first to their last pass in
+/// a pool per frame slot, aliased when their lifetimes don't overlap.
+///
+/// Render passes have no subpass dependencies, every one of them is compatible with a render pass
+/// of the same attachments, colors first, then the depth stencil and the resolves.
+///
+class VkRenderGraph
+{
+public:
+  using ResourceId = uint32_t;
+  using PassId = uint32_t;
+  using ExecuteFunc = std::function<void(const RenderGraphPassContext &context)>;
+
+  static const ResourceId InvalidResource = UINT32_MAX;
+
+  VkRenderGraph();
+  ~VkRenderGraph();
+
+  VKHRESULT Create(VkDevice pDevice, uint32_t uFrameCount, bool bLazilyAllocated);
+  /// The device must be idle.
+  void Destroy();
+
+  /// Forget the passes and resources of the previous frame, the caches are kept.
+  void Reset();
+
+  /// Resources living outside the graph. The contents are kept for `finalLayout`, so passes
+  /// writing them are never culled, and discarded when it is VK_IMAGE_LAYOUT_UNDEFINED.
+  ResourceId ImportImage(
+    _In_z_ const char *pszName,
+    VkImage pImage,
+    VkImageView pView,
+    VkFormat format,
+    VkExtent2D extent,
+    VkSampleCountFlagBits samples,
+    const RenderGraphImportState &initialState,
+    VkImageLayout finalLayout
+  );
+  ResourceId ImportBuffer(
+    _In_z_ const char *pszName,
+    VkBuffer pBuffer,
+    VkDeviceSize uSize,
+    const RenderGraphImportState &initialState,
+    bool bKeepContents
+  );
+
+  /// Created by the graph from its pool, the usage follows the passes' declarations.
+  ResourceId CreateImage(_In_z_ const char *pszName, VkFormat format, VkExtent2D extent,
+                         VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+  ResourceId CreateBuffer(_In_z_ const char *pszName, VkDeviceSize uSize);
+
+  /// Passes execute in the order added. `contents` of a graphics pass tells whether it executes
+  /// secondary command buffers.
+  PassId AddPass(
+    _In_z_ const char *pszName,
+    RenderGraphPassType type,
+    ExecuteFunc &&fnExecute,
+    VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE
+  );
+
+  /// Attachments are ordered as declared, `resolve` receives the resolved samples of `image`.
+  void UseColorAttachment(PassId pass, ResourceId image, VkAttachmentLoadOp loadOp,
+                          const VkClearColorValue &clearColor = {},
+                          ResourceId resolve = InvalidResource);
+  void UseDepthStencilAttachment(PassId pass, ResourceId image, VkAttachmentLoadOp loadOp,
+                                 const VkClearDepthStencilValue &clearValue = {1.0f, 0},
+                                 bool bReadOnly = false);
+  void UseImage(PassId pass, ResourceId image, RenderGraphAccess access);
+  void UseBuffer(PassId pass, ResourceId buffer, RenderGraphAccess access);
+
+  /// Cull the passes and compute the barriers, CPU only.
+  VKHRESULT Compile();
+  /// Compile if not yet, allocate the slot's resources and record every pass. Call it after the
+  /// slot's timeline value was waited.
+  VKHRESULT Execute(VkCommandBuffer pCmdBuffer, uint32_t uFrameIndex);
+
+  /// Resources of the executed frame, valid until the slot executes again.
+  VkImage GetImage(ResourceId image) const;
+  VkImageView GetImageView(ResourceId image) const;
+  VkBuffer GetBuffer(ResourceId buffer) const;
+
+  /// Passes of the last compilation left after culling, and the barriers they record.
+  uint32_t GetActivePassCount() const;
+  uint32_t GetBarrierCount() const;
+
+  /// Hand the cached framebuffers over to be destroyed once the GPU is done with them, call it
+  /// before any imported view they reference is destroyed.
+  void ReleaseFramebuffers(_Out_ std::vector<VkFramebuffer> *pFramebuffers);
+
+private:
+  /// Stages, access and layout of a resource as far as the recorded passes got.
+  struct ResourceState {
+    VkImageLayout Layout;
+    VkPipelineStageFlags WriteStages; /// Last write, not yet made visible to every reader.
+    VkAccessFlags WriteAccess;
+    VkPipelineStageFlags ReadStages; /// Reading since the last write, waited by the next write.
+    VkAccessFlags ReadAccess;        /// Made visible since the last write.
+  };
+
+  struct Resource {
+    std::string Name;
+    bool bImage;
+    bool bImported;
+    bool bKeepContents;
+    VkImage pImage;
+    VkImageView pView;
+    VkBuffer pBuffer;
+    VkFormat Format;
+    VkExtent2D Extent;
+    VkSampleCountFlagBits Samples;
+    VkDeviceSize uSize;
+    VkImageUsageFlags ImageUsage;
+    VkBufferUsageFlags BufferUsage;
+    RenderGraphImportState InitialState;
+    VkImageLayout FinalLayout;
+    /// Compilation.
+    uint32_t uFirstPass;
+    uint32_t uLastPass;
+    uint32_t uPoolIndex; /// In the slot's transient allocator.
+    ResourceState State;
+  };
+
+  struct Use {
+    ResourceId Target;
+    RenderGraphAccess Access;
+    VkAttachmentLoadOp LoadOp;
+    VkClearValue ClearValue;
+    ResourceId Resolve;
+  };
+
+  struct Barrier {
+    ResourceId Target;
+    VkPipelineStageFlags SrcStages;
+    VkAccessFlags SrcAccess;
+    VkPipelineStageFlags DstStages;
+    VkAccessFlags DstAccess;
+    VkImageLayout OldLayout;
+    VkImageLayout NewLayout; /// Equal to `OldLayout` for a memory barrier.
+  };
+
+  struct Pass {
+    std::string Name;
+    RenderGraphPassType Type;
+    ExecuteFunc fnExecute;
+    VkSubpassContents Contents;
+    std::vector<Use> aUses;
+    /// Compilation.
+    bool bActive;
+    std::vector<Barrier> aBarriers;
+    std::vector<VkAttachmentStoreOp> aStoreOps; /// Per attachment, in the render pass order.
+    std::vector<VkImageLayout> aFinalLayouts;
+  };
+
+  struct RenderPassEntry {
+    std::vector<VkAttachmentDescription> aAttachments;
+    uint32_t uColorCount;
+    bool bDepthStencil;
+    bool bDepthStencilReadOnly;
+    uint32_t uResolveMask; /// Colors with a resolve attachment.
+    VkRenderPass pRenderPass;
+  };
+
+  struct FramebufferEntry {
+    VkRenderPass pRenderPass;
+    std::vector<VkImageView> aViews;
+    VkExtent2D Extent;
+    VkFramebuffer pFramebuffer;
+    bool bUsed;
+  };
+
+  /// A transient resource as planned, the pool is reused as long as every entry matches.
+  struct PoolEntry {
+    bool bImage;
+    VkFormat Format;
+    VkExtent2D Extent;
+    VkSampleCountFlagBits Samples;
+    VkDeviceSize uSize;
+    VkFlags Usage;
+    uint32_t uFirstPass;
+    uint32_t uLastPass;
+  };
+
+  /// Transient resources and framebuffers of a frame slot, only used by the slot's frames.
+  struct FramePool {
+    VkTransientAllocator Allocator;
+    std::vector<PoolEntry> aEntries;
+    std::vector<VkImageView> aViews; /// Per entry, VK_NULL_HANDLE for buffers.
+    std::vector<FramebufferEntry> aFramebuffers;
+  };
+
+  ResourceId AddResource(Resource &&resource);
+  void AddUse(PassId pass, const Use &use);
+  void Cull();
+  void ComputeBarriers();
+  /// The attachments of a graphics pass in the render pass order, the resolves included.
+  void GetAttachments(const Pass &pass, _Out_ std::vector<Use> *pAttachments) const;
+  VKHRESULT AllocateTransients(FramePool *pPool);
+  VKHRESULT GetRenderPass(const Pass &pass, const std::vector<Use> &aAttachments,
+                          _Out_ VkRenderPass *ppRenderPass);
+  VKHRESULT GetFramebuffer(FramePool *pPool, VkRenderPass pRenderPass,
+                           const std::vector<Use> &aAttachments, _Out_ VkFramebuffer *ppFramebuffer,
+                           _Out_ VkExtent2D *pExtent);
+  void CmdBarriers(VkCommandBuffer pCmdBuffer, const std::vector<Barrier> &aBarriers) const;
+  void DestroyPool(FramePool *pPool);
+
+  VkDevice m_pDevice;
+  bool m_bLazilyAllocated;
+  std::vector<FramePool> m_aPools;
+  std::vector<RenderPassEntry> m_aRenderPasses;
+
+  std::vector<Resource> m_aResources;
+  std::vector<Pass> m_aPasses;
+  /// Final transitions of the imported images, after the last pass.
+  std::vector<Barrier> m_aFinalBarriers;
+  bool m_bCompiled;
+  uint32_t m_uActivePassCount;
+  uint32_t m_uBarrierCount;
+};
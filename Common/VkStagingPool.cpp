@@ -0,0 +1,157 @@
+#include "VkStagingPool.h"
+#include <algorithm>
+
+VkStagingPool::VkStagingPool() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_cbBlockSize = 0;
+  m_cbBudget = 0;
+  m_cbReserved = 0;
+  m_cbPeak = 0;
+}
+
+VkStagingPool::~VkStagingPool() {
+  _ASSERT(m_aBlocks.empty() && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkStagingPool::Create(VkDevice pDevice, VkDeviceSize cbBlockSize, VkDeviceSize cbBudget) {
+  m_pDevice = pDevice;
+  m_cbBlockSize = cbBlockSize;
+  m_cbBudget = cbBudget;
+  m_cbReserved = 0;
+  m_cbPeak = 0;
+
+  return VK_SUCCESS;
+}
+
+void VkStagingPool::Destroy() {
+  for (auto &block : m_aBlocks) {
+    _ASSERT(!block.uLiveCount && "Staging memory is still in use!");
+    DestroyBlock(&block);
+  }
+  m_aBlocks.clear();
+  m_pDevice = VK_NULL_HANDLE;
+}
+
+VKHRESULT VkStagingPool::CreateBlock(VkDeviceSize cbSize, bool bDedicated, uint32_t *puBlock) {
+  VKHRESULT hr;
+  Block block = {};
+  uint32_t i;
+
+  *puBlock = UINT32_MAX;
+
+  /// Idle blocks make room for a request they can't hold.
+  for (auto &idle : m_aBlocks) {
+    if (m_cbReserved + cbSize <= m_cbBudget)
+      break;
+    if (idle.pMem && !idle.uLiveCount)
+      DestroyBlock(&idle);
+  }
+  if (m_cbReserved && m_cbReserved + cbSize > m_cbBudget)
+    return VK_ERROR_OUT_OF_POOL_MEMORY;
+
+  V(CreateUploadBuffer(m_pDevice, (size_t)cbSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                       &block.pBuffer, &block.pMem, (void **)&block.pMappedData));
+  if (VK_FAILED(hr))
+    return hr;
+  block.cbSize = cbSize;
+  block.bDedicated = bDedicated;
+
+  for (i = 0; i < (uint32_t)m_aBlocks.size() && m_aBlocks[i].pMem; ++i)
+    ;
+  if (i == m_aBlocks.size())
+    m_aBlocks.push_back(block);
+  else
+    m_aBlocks[i] = block;
+
+  m_cbReserved += cbSize;
+  m_cbPeak = std::max(m_cbPeak, m_cbReserved);
+  *puBlock = i;
+
+  return hr;
+}
+
+void VkStagingPool::DestroyBlock(Block *pBlock) {
+  if (pBlock->pMem) {
+    DestroyVmaBuffer(pBlock->pBuffer, pBlock->pMem);
+    m_cbReserved -= pBlock->cbSize;
+    *pBlock = {};
+  }
+}
+
+VKHRESULT VkStagingPool::Allocate(
+  VkDeviceSize cbSize,
+  VkDeviceSize uAlignment,
+  VkStagingAllocation *pAllocation
+) {
+  VKHRESULT hr = VK_SUCCESS;
+  VkDeviceSize uOffset = 0;
+  uint32_t uBlock = UINT32_MAX;
+  uint32_t i;
+
+  *pAllocation = {};
+
+  if (cbSize > m_cbBlockSize) {
+    V(CreateBlock(cbSize, true, &uBlock));
+    if (VK_FAILED(hr))
+      return hr;
+  } else {
+    /// First fit, blocks are rewound as a whole so there's only the tail to look at.
+    for (i = 0; i < (uint32_t)m_aBlocks.size(); ++i) {
+      const Block &block = m_aBlocks[i];
+      if (!block.pMem || block.bDedicated)
+        continue;
+      uOffset = (block.uOffset + uAlignment - 1) / uAlignment * uAlignment;
+      if (uOffset + cbSize <= block.cbSize) {
+        uBlock = i;
+        break;
+      }
+    }
+    if (uBlock == UINT32_MAX) {
+      V(CreateBlock(m_cbBlockSize, false, &uBlock));
+      if (VK_FAILED(hr))
+        return hr;
+      uOffset = 0;
+    }
+  }
+
+  Block &block = m_aBlocks[uBlock];
+  block.uOffset = uOffset + cbSize;
+  ++block.uLiveCount;
+
+  pAllocation->pBuffer = block.pBuffer;
+  pAllocation->uOffset = uOffset;
+  pAllocation->pData = block.pMappedData + uOffset;
+  pAllocation->uBlock = uBlock;
+
+  return hr;
+}
+
+void VkStagingPool::Release(const VkStagingAllocation &allocation) {
+  Block &block = m_aBlocks[allocation.uBlock];
+
+  _ASSERT(block.uLiveCount && block.pBuffer == allocation.pBuffer);
+  if (--block.uLiveCount)
+    return;
+
+  /// Idle blocks past a lowered budget are given back as well.
+  if (block.bDedicated || m_cbReserved > m_cbBudget)
+    DestroyBlock(&block);
+  else
+    block.uOffset = 0;
+}
+
+void VkStagingPool::SetBudget(VkDeviceSize cbBudget) {
+  m_cbBudget = cbBudget;
+}
+
+VkDeviceSize VkStagingPool::GetBudget() const {
+  return m_cbBudget;
+}
+
+VkDeviceSize VkStagingPool::GetReservedBytes() const {
+  return m_cbReserved;
+}
+
+VkDeviceSize VkStagingPool::GetPeakReservedBytes() const {
+  return m_cbPeak;
+}
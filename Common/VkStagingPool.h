@@ -0,0 +1,66 @@
+#pragma once
+#include "VkUtilities.h"
+#include <vector>
+
+/// A range of a staging block, written through `pData` and read by the copies at `uOffset`.
+struct VkStagingAllocation {
+  VkBuffer pBuffer;
+  VkDeviceSize uOffset;
+  void *pData;
+  uint32_t uBlock;
+};
+
+///
+/// Staging memory sub-allocated from a few large persistently mapped blocks. Each block is a
+/// linear allocator rewound once every allocation it holds was released, requests larger than a
+/// block get a dedicated one, freed along with the allocation. The blocks never grow past the
+/// budget, allocations fail instead and succeed again once earlier ones are released.
+///
+class VkStagingPool
+{
+public:
+  VkStagingPool();
+  ~VkStagingPool();
+
+  VKHRESULT Create(VkDevice pDevice, VkDeviceSize cbBlockSize, VkDeviceSize cbBudget);
+  /// Every allocation must be released.
+  void Destroy();
+
+  /// Fails with VK_ERROR_OUT_OF_POOL_MEMORY when a new block would exceed the budget. A request
+  /// larger than the budget only succeeds when no block is left.
+  VKHRESULT Allocate(
+    VkDeviceSize cbSize,
+    VkDeviceSize uAlignment,
+    _Out_ VkStagingAllocation *pAllocation
+  );
+  /// Call it once the copies reading the allocation completed.
+  void Release(const VkStagingAllocation &allocation);
+
+  void SetBudget(VkDeviceSize cbBudget);
+  VkDeviceSize GetBudget() const;
+  /// Bytes held by the blocks, and the most they ever held.
+  VkDeviceSize GetReservedBytes() const;
+  VkDeviceSize GetPeakReservedBytes() const;
+
+private:
+  struct Block {
+    VkBuffer pBuffer;
+    VMAHandle pMem;
+    char *pMappedData;
+    VkDeviceSize cbSize;
+    VkDeviceSize uOffset;
+    uint32_t uLiveCount;
+    bool bDedicated;
+  };
+
+  VKHRESULT CreateBlock(VkDeviceSize cbSize, bool bDedicated, _Out_ uint32_t *puBlock);
+  void DestroyBlock(Block *pBlock);
+
+  VkDevice m_pDevice;
+  VkDeviceSize m_cbBlockSize;
+  VkDeviceSize m_cbBudget;
+  VkDeviceSize m_cbReserved;
+  VkDeviceSize m_cbPeak;
+  /// Freed blocks leave an empty slot, allocations keep their block index.
+  std::vector<Block> m_aBlocks;
+};
@@ -0,0 +1,104 @@
+#include "VkTaskGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+VkTaskGraph::TaskId VkTaskGraph::Add(
+  _In_z_ const char *pszName,
+  TaskFunc &&fnTask,
+  std::initializer_list<TaskId> aDependencies,
+  bool bCallingThread
+) {
+  TaskId id = (TaskId)m_aTasks.size();
+
+  m_aTasks.push_back(Task{std::move(fnTask), {}, (uint32_t)aDependencies.size(), bCallingThread,
+                          false});
+  m_aTimings.push_back(TaskTiming{pszName ? pszName : "", .0f, .0f, 0, VK_SUCCESS, false});
+  for (TaskId dependency : aDependencies) {
+    _ASSERT(dependency < id && "Add the dependencies first!");
+    m_aTasks[dependency].aDependents.push_back(id);
+  }
+
+  return id;
+}
+
+VKHRESULT VkTaskGraph::Run(uint32_t uThreadCount) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  std::mutex mutex;
+  std::condition_variable readyCond;
+  std::deque<TaskId> aReady, aCallingThreadReady;
+  uint32_t uRemaining = (uint32_t)m_aTasks.size();
+  VKHRESULT firstFailure = VK_SUCCESS;
+  std::vector<std::thread> aWorkers;
+  uint32_t i;
+
+  for (i = 0; i < m_aTasks.size(); ++i) {
+    if (m_aTasks[i].uPendingDependencies == 0)
+      (m_aTasks[i].bCallingThread ? aCallingThreadReady : aReady).push_back(i);
+  }
+
+  auto fnElapsedMs = [start]() {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+  };
+
+  /// Pops ready tasks until none is left to run, the calling thread takes its pinned ones first.
+  auto fnThreadMain = [&](uint32_t uThread) {
+    std::unique_lock<std::mutex> lock(mutex);
+    TaskId id;
+
+    for (;;) {
+      readyCond.wait(lock, [&]() {
+        return uRemaining == 0 || !aReady.empty() ||
+               (uThread == 0 && !aCallingThreadReady.empty());
+      });
+      if (uThread == 0 && !aCallingThreadReady.empty()) {
+        id = aCallingThreadReady.front();
+        aCallingThreadReady.pop_front();
+      } else if (!aReady.empty()) {
+        id = aReady.front();
+        aReady.pop_front();
+      } else {
+        return;
+      }
+
+      Task &task = m_aTasks[id];
+      TaskTiming &timing = m_aTimings[id];
+      timing.Thread = uThread;
+      timing.Skipped = task.bSkip;
+      lock.unlock();
+
+      timing.StartMs = fnElapsedMs();
+      timing.Result = task.bSkip ? VK_SUCCESS : task.fnTask();
+      timing.EndMs = fnElapsedMs();
+
+      lock.lock();
+      if (timing.Result != VK_SUCCESS && firstFailure == VK_SUCCESS)
+        firstFailure = timing.Result;
+      for (TaskId dependent : task.aDependents) {
+        Task &dependentTask = m_aTasks[dependent];
+        dependentTask.bSkip |= task.bSkip || timing.Result != VK_SUCCESS;
+        if (--dependentTask.uPendingDependencies == 0)
+          (dependentTask.bCallingThread ? aCallingThreadReady : aReady).push_back(dependent);
+      }
+      --uRemaining;
+      readyCond.notify_all();
+    }
+  };
+
+  uThreadCount = std::max(1u, std::min(uThreadCount, (uint32_t)m_aTasks.size()));
+  for (i = 1; i < uThreadCount; ++i)
+    aWorkers.emplace_back(fnThreadMain, i);
+  fnThreadMain(0);
+  for (auto &worker : aWorkers)
+    worker.join();
+
+  return firstFailure;
+}
+
+const std::vector<TaskTiming> &VkTaskGraph::GetTimings() const {
+  return m_aTimings;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "VkUtilities.h"
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+struct TaskTiming {
+  std::string Name;
+  float StartMs; /// Since `Run` was called.
+  float EndMs;
+  uint32_t Thread; /// Zero for the thread calling `Run`.
+  VKHRESULT Result;
+  bool Skipped; /// A dependency failed, the task did not run.
+};
+
+///
+/// Tasks with dependencies, run once on a set of threads which only lives for `Run`. Tasks using
+/// objects which are not thread safe, the upload context for instance, are pinned to the calling
+/// thread. Every task is timed, so the graph doubles as a timeline of where the time went.
+///
+class VkTaskGraph
+{
+public:
+  using TaskId = uint32_t;
+  using TaskFunc = std::function<VKHRESULT()>;
+
+  /// Dependencies must have been added before.
+  TaskId Add(
+    _In_z_ const char *pszName,
+    TaskFunc &&fnTask,
+    std::initializer_list<TaskId> aDependencies = {},
+    bool bCallingThread = false
+  );
+
+  /// Blocks until every task ran or was skipped, on up to `uThreadCount` threads including the
+  /// calling one. Returns the first failure.
+  VKHRESULT Run(uint32_t uThreadCount);
+
+  const std::vector<TaskTiming> &GetTimings() const;
+
+private:
+  struct Task {
+    TaskFunc fnTask;
+    std::vector<TaskId> aDependents;
+    uint32_t uPendingDependencies;
+    bool bCallingThread;
+    bool bSkip;
+  };
+
+  std::vector<Task> m_aTasks;
+  std::vector<TaskTiming> m_aTimings;
+};
@@ -22,6 +22,43 @@ VkTexture::~VkTexture() {
   _ASSERT(!m_pUploadBufferMem && !m_pDefaultBufferMem && !m_pTextureView && "Clean up not possible on ctor!");
 }
 
+VKHRESULT VkTexture::DecodeDDSFile(_In_z_ const wchar_t *pszFileName) {
+  VKHRESULT hr;
+  wchar_t szPath[MAX_PATH];
+
+  if(FindDemoMediaFileAbsPath(pszFileName, MAX_PATH, szPath))
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  m_pDecoded.reset(new DirectX::ScratchImage());
+  hr = DirectX::LoadFromDDSFile(szPath, DirectX::DDS_FLAGS_ALLOW_LARGE_FILES, nullptr,
+    *m_pDecoded);
+  if (FAILED(hr)) {
+    m_pDecoded.reset();
+    V(!(hr && "Can not load dds texture from file!"));
+    return hr;
+  }
+
+  return VK_SUCCESS;
+}
+
+VKHRESULT VkTexture::UploadDecoded(
+  _In_ VkDevice pDevice,
+  _In_ VkUploadContext *pUploader,
+  _In_ VkAccessFlags accessFlags,
+  _In_ VkImageLayout destLayout,
+  _In_ VkPipelineStageFlags destPipelineStage
+) {
+  VKHRESULT hr;
+  VkStagingAllocation staging;
+
+  V_RETURN(!(m_pDecoded && !!"DecodeDDSFile must succeed first!"));
+  /// Staged before `Begin`, staying within the budget may submit the current batch.
+  V_RETURN(pUploader->AllocateStaging(m_pDecoded->GetPixelsSize(), &staging));
+
+  return UploadDecodedInternal(pDevice, VK_NULL_HANDLE, pUploader, &staging, accessFlags,
+    destLayout, destPipelineStage);
+}
+
 void VkTexture::DisposeUploaders() {
   DestroyVmaBuffer(m_pUploadBuffer, m_pUploadBufferMem);
   m_pUploadBuffer = nullptr; m_pUploadBufferMem = nullptr;
@@ -73,19 +110,41 @@ VKHRESULT VkTexture::LoadFromDDSFile(
 ) {
   VKHRESULT hr;
 
-  DirectX::ScratchImage images;
-  DirectX::TexMetadata metaData;
-  WCHAR szPath[MAX_PATH];
+  V_RETURN(DecodeDDSFile(pszFileName));
+  return UploadDecodedInternal(pDevice, pCmdBuffer, nullptr, nullptr, accessFlags, destLayout,
+    destPipelineStage);
+}
 
-  if(FindDemoMediaFileAbsPath(pszFileName, MAX_PATH, szPath))
-    return VK_NULL_HANDLE;
+VKHRESULT VkTexture::LoadFromDDSFile(
+  _In_ VkDevice pDevice,
+  _In_ VkUploadContext *pUploader,
+  _In_z_ const wchar_t *pszFileName,
+  _In_ VkAccessFlags accessFlags,
+  _In_ VkImageLayout destLayout,
+  _In_ VkPipelineStageFlags destPipelineStage
+) {
+  VKHRESULT hr;
 
-  hr = DirectX::LoadFromDDSFile(szPath, DirectX::DDS_FLAGS_ALLOW_LARGE_FILES,
-    &metaData, images);
-  if (FAILED(hr)) {
-    V(!(hr && "Can not load dds texture from file!"));
-    return hr;
-  }
+  V_RETURN(DecodeDDSFile(pszFileName));
+  return UploadDecoded(pDevice, pUploader, accessFlags, destLayout, destPipelineStage);
+}
+
+VKHRESULT VkTexture::UploadDecodedInternal(
+  _In_ VkDevice pDevice,
+  _In_ VkCommandBuffer pCmdBuffer,
+  _In_opt_ VkUploadContext *pUploader,
+  _In_opt_ const VkStagingAllocation *pStaging,
+  _In_ VkAccessFlags accessFlags,
+  _In_ VkImageLayout destLayout,
+  _In_ VkPipelineStageFlags destPipelineStage
+) {
+  VKHRESULT hr;
+
+  V_RETURN(!(m_pDecoded && !!"DecodeDDSFile must succeed first!"));
+  /// Copied into the staging buffer, freed on return.
+  std::unique_ptr<DirectX::ScratchImage> pDecoded = std::move(m_pDecoded);
+  DirectX::ScratchImage &images = *pDecoded;
+  const DirectX::TexMetadata &metaData = images.GetMetadata();
 
   VkImageCreateInfo imageInfo = {
     VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO, // sType;
@@ -149,15 +208,25 @@ VKHRESULT VkTexture::LoadFromDDSFile(
   }
 
   /// Copy texels' data.
+  VkBuffer pStagingBuffer;
+  VkDeviceSize uStagingOffset = 0;
   void *pMappedData;
 
-  V(CreateUploadBuffer(pDevice, images.GetPixelsSize(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &m_pUploadBuffer, &m_pUploadBufferMem, &pMappedData));
-  if (VK_FAILED(hr)) {
-    DestroyVmaBuffer(m_pUploadBuffer, m_pUploadBufferMem);
-    m_pUploadBuffer = nullptr; m_pUploadBufferMem = nullptr;
-    vkDestroyImageView(pDevice, m_pTextureView, nullptr);
-    m_pTextureView = nullptr;
-    return hr;
+  if (pStaging) {
+    /// Pooled by the uploader, released along with its batch.
+    pStagingBuffer = pStaging->pBuffer;
+    uStagingOffset = pStaging->uOffset;
+    pMappedData = pStaging->pData;
+  } else {
+    V(CreateUploadBuffer(pDevice, images.GetPixelsSize(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &m_pUploadBuffer, &m_pUploadBufferMem, &pMappedData));
+    if (VK_FAILED(hr)) {
+      DestroyVmaBuffer(m_pUploadBuffer, m_pUploadBufferMem);
+      m_pUploadBuffer = nullptr; m_pUploadBufferMem = nullptr;
+      vkDestroyImageView(pDevice, m_pTextureView, nullptr);
+      m_pTextureView = nullptr;
+      return hr;
+    }
+    pStagingBuffer = m_pUploadBuffer;
   }
   memcpy(pMappedData, images.GetPixels(), images.GetPixelsSize());
 
@@ -175,7 +244,7 @@ VKHRESULT VkTexture::LoadFromDDSFile(
           pImage = images.GetImage(k, j, i);
 
           auto &copyRegion = copyRegions[index];
-          copyRegion.bufferOffset = pImage->pixels - images.GetPixels();
+          copyRegion.bufferOffset = uStagingOffset + (pImage->pixels - images.GetPixels());
           copyRegion.bufferRowLength = 0;
           copyRegion.bufferImageHeight = 0;
           copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -196,50 +265,59 @@ VKHRESULT VkTexture::LoadFromDDSFile(
     return hr;
   }
 
-  VkImageMemoryBarrier barrier = {
-    VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType;
-    nullptr, // pNext;
-    0, // srcAccessMask;
-    VK_ACCESS_TRANSFER_WRITE_BIT, // dstAccessMask;
-    VK_IMAGE_LAYOUT_UNDEFINED, // oldLayout;
-    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, // newLayout;
-    VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex;
-    VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex;
-    m_pDefaultBuffer, // image;
-    {
-      VK_IMAGE_ASPECT_COLOR_BIT, // aspectMask;
-      0, // baseMipLevel;
-      (uint32_t)metaData.mipLevels, // levelCount;
-      0, // baseArrayLayer;
-      (uint32_t)metaData.arraySize // layerCount;
-    }
+  VkImageSubresourceRange subresourceRange = {
+    VK_IMAGE_ASPECT_COLOR_BIT, // aspectMask;
+    0, // baseMipLevel;
+    (uint32_t)metaData.mipLevels, // levelCount;
+    0, // baseArrayLayer;
+    (uint32_t)metaData.arraySize // layerCount;
   };
-  vkCmdPipelineBarrier(
-    pCmdBuffer,
-    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-    0, 0, 0,
-    0, nullptr,
-    1, &barrier
-  );
-
-  /// Recorde a command and a barrier to copy the resource.
-  vkCmdCopyBufferToImage(pCmdBuffer,
-    m_pUploadBuffer, m_pDefaultBuffer,
-    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-    (uint32_t)copyRegions.size(),
-    copyRegions.data());
-
-  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  barrier.dstAccessMask = accessFlags;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.newLayout = destLayout;
-  vkCmdPipelineBarrier(
-    pCmdBuffer,
-    VK_PIPELINE_STAGE_TRANSFER_BIT, destPipelineStage,
-    0, 0, 0,
-    0, nullptr,
-    1, &barrier
-  );
+
+  if (pUploader) {
+    /// Batched with the other uploads, which also hands the image over to the graphics queue.
+    pUploader->QueueImageUpload(pStagingBuffer, m_pDefaultBuffer, subresourceRange,
+      (uint32_t)copyRegions.size(), copyRegions.data(), destLayout, accessFlags,
+      destPipelineStage);
+  } else {
+    VkImageMemoryBarrier barrier = {
+      VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType;
+      nullptr, // pNext;
+      0, // srcAccessMask;
+      VK_ACCESS_TRANSFER_WRITE_BIT, // dstAccessMask;
+      VK_IMAGE_LAYOUT_UNDEFINED, // oldLayout;
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, // newLayout;
+      VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex;
+      VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex;
+      m_pDefaultBuffer, // image;
+      subresourceRange // subresourceRange;
+    };
+    vkCmdPipelineBarrier(
+      pCmdBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 0, 0,
+      0, nullptr,
+      1, &barrier
+    );
+
+    /// Recorde a command and a barrier to copy the resource.
+    vkCmdCopyBufferToImage(pCmdBuffer,
+      pStagingBuffer, m_pDefaultBuffer,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      (uint32_t)copyRegions.size(),
+      copyRegions.data());
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = accessFlags;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = destLayout;
+    vkCmdPipelineBarrier(
+      pCmdBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, destPipelineStage,
+      0, 0, 0,
+      0, nullptr,
+      1, &barrier
+    );
+  }
 
   /// Texture information.
   m_Format = imageInfo.format;
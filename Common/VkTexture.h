@@ -1,5 +1,11 @@
 #pragma once
 #include "VkUtilities.h"
+#include "VkUploadContext.h"
+#include <memory>
+
+namespace DirectX {
+class ScratchImage;
+}
 
 class VkTexture
 {
@@ -16,6 +22,29 @@ public:
     _In_ VkPipelineStageFlags destPipelineStage
   );
 
+  /// Record the upload into `pUploader`, staging the texels in its pool.
+  VKHRESULT LoadFromDDSFile(
+    _In_ VkDevice pDevice,
+    _In_ VkUploadContext *pUploader,
+    _In_z_ const wchar_t *pszFileName,
+    _In_ VkAccessFlags accessFlags,
+    _In_ VkImageLayout destLayout,
+    _In_ VkPipelineStageFlags destPipelineStage
+  );
+
+  /// Read and decode the file only. Touches neither the device nor an uploader, so it may run on
+  /// any thread ahead of them.
+  VKHRESULT DecodeDDSFile(_In_z_ const wchar_t *pszFileName);
+
+  /// Create the image of the decoded texels and record their upload into `pUploader`.
+  VKHRESULT UploadDecoded(
+    _In_ VkDevice pDevice,
+    _In_ VkUploadContext *pUploader,
+    _In_ VkAccessFlags accessFlags,
+    _In_ VkImageLayout destLayout,
+    _In_ VkPipelineStageFlags destPipelineStage
+  );
+
   void DisposeUploaders();
 
   void DisposeFinally(_In_ VkDevice pDevice);
@@ -23,6 +52,20 @@ public:
   const VkImageView& GetResourceView() const;
 
 private:
+  /// Records into `pCmdBuffer`, or queues into `pUploader` when set.
+  VKHRESULT UploadDecodedInternal(
+    _In_ VkDevice pDevice,
+    _In_ VkCommandBuffer pCmdBuffer,
+    _In_opt_ VkUploadContext *pUploader,
+    _In_opt_ const VkStagingAllocation *pStaging,
+    _In_ VkAccessFlags accessFlags,
+    _In_ VkImageLayout destLayout,
+    _In_ VkPipelineStageFlags destPipelineStage
+  );
+
+  /// Texels between `DecodeDDSFile` and their upload.
+  std::unique_ptr<DirectX::ScratchImage> m_pDecoded;
+
   VkImage m_pDefaultBuffer;
   VMAHandle m_pDefaultBufferMem;
   VkBuffer m_pUploadBuffer;
@@ -0,0 +1,116 @@
+#include "VkTimeline.h"
+#include <algorithm>
+
+VkTimeline::VkTimeline() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_pSemaphore = VK_NULL_HANDLE;
+  m_uLastSubmitted = 0;
+  m_uCompleted = 0;
+}
+
+VkTimeline::~VkTimeline() {
+  _ASSERT(!m_pSemaphore && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkTimeline::Create(VkDevice pDevice) {
+  VKHRESULT hr;
+  VkSemaphoreTypeCreateInfo typeInfo = {
+    VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO, // sType;
+    nullptr, // pNext;
+    VK_SEMAPHORE_TYPE_TIMELINE, // semaphoreType;
+    0 // initialValue;
+  };
+  VkSemaphoreCreateInfo semInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &typeInfo };
+
+  m_pDevice = pDevice;
+  m_uLastSubmitted = 0;
+  m_uCompleted = 0;
+  V_RETURN(vkCreateSemaphore(m_pDevice, &semInfo, nullptr, &m_pSemaphore));
+
+  return hr;
+}
+
+void VkTimeline::Destroy() {
+  if (!m_pDevice)
+    return;
+
+  for (auto &retirement : m_aRetirements)
+    retirement.fnRetire();
+  m_aRetirements.clear();
+
+  vkDestroySemaphore(m_pDevice, m_pSemaphore, nullptr);
+  m_pSemaphore = VK_NULL_HANDLE;
+  m_pDevice = VK_NULL_HANDLE;
+}
+
+VkSemaphore VkTimeline::GetSemaphore() const {
+  return m_pSemaphore;
+}
+
+uint64_t VkTimeline::Next() {
+  return ++m_uLastSubmitted;
+}
+
+uint64_t VkTimeline::GetLastSubmitted() const {
+  return m_uLastSubmitted;
+}
+
+uint64_t VkTimeline::GetCompleted() {
+  uint64_t uValue = m_uCompleted;
+
+  if (m_uCompleted < m_uLastSubmitted &&
+      vkGetSemaphoreCounterValue(m_pDevice, m_pSemaphore, &uValue) == VK_SUCCESS)
+    m_uCompleted = uValue;
+
+  return m_uCompleted;
+}
+
+bool VkTimeline::IsCompleted(uint64_t uValue) {
+  return uValue <= m_uCompleted || uValue <= GetCompleted();
+}
+
+VKHRESULT VkTimeline::Wait(uint64_t uValue, uint64_t uTimeout) {
+  VKHRESULT hr = VK_SUCCESS;
+  VkSemaphoreWaitInfo waitInfo = {
+    VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO, // sType;
+    nullptr, // pNext;
+    0, // flags;
+    1, // semaphoreCount;
+    &m_pSemaphore, // pSemaphores;
+    &uValue // pValues;
+  };
+
+  if (uValue <= m_uCompleted)
+    return hr;
+
+  V_RETURN(!(uValue <= m_uLastSubmitted && !!"Waiting for a value never submitted!"));
+  hr = vkWaitSemaphores(m_pDevice, &waitInfo, uTimeout);
+  if (hr == VK_SUCCESS)
+    m_uCompleted = std::max(m_uCompleted, uValue);
+
+  return hr;
+}
+
+void VkTimeline::Retire(uint64_t uValue, std::function<void()> &&fnRetire) {
+  if (IsCompleted(uValue)) {
+    fnRetire();
+    return;
+  }
+
+  /// Mostly appended, keep the order for values retired late.
+  auto it = m_aRetirements.end();
+  while (it != m_aRetirements.begin() && (it - 1)->uValue > uValue)
+    --it;
+  m_aRetirements.insert(it, { uValue, std::move(fnRetire) });
+}
+
+void VkTimeline::Collect() {
+  if (m_aRetirements.empty())
+    return;
+
+  GetCompleted();
+  while (!m_aRetirements.empty() && m_aRetirements.front().uValue <= m_uCompleted) {
+    m_aRetirements.front().fnRetire();
+    m_aRetirements.pop_front();
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "VkUtilities.h"
+#include <deque>
+#include <functional>
+
+///
+/// Timeline semaphore of a single queue. Every submission on the queue signals the next value,
+/// so the values complete in submission order and "frame N is done" is a single comparison.
+/// Resources tied to a value are retired once the GPU reaches it, no fences involved.
+///
+class VkTimeline
+{
+public:
+  VkTimeline();
+  ~VkTimeline();
+
+  VKHRESULT Create(VkDevice pDevice);
+  /// Runs the outstanding retirements, the device must be idle.
+  void Destroy();
+
+  VkSemaphore GetSemaphore() const;
+
+  /// Value signaled by the next submission on the queue.
+  uint64_t Next();
+  /// Value of the last submission.
+  uint64_t GetLastSubmitted() const;
+
+  /// Completed value as seen by the GPU, refreshed on every call.
+  uint64_t GetCompleted();
+  bool IsCompleted(uint64_t uValue);
+
+  /// Block until the GPU reaches `uValue`.
+  VKHRESULT Wait(uint64_t uValue, uint64_t uTimeout = UINT64_MAX);
+
+  /// Call `fnRetire` once the GPU reaches `uValue`.
+  void Retire(uint64_t uValue, std::function<void()> &&fnRetire);
+  /// Run the retirements which are completed.
+  void Collect();
+
+private:
+  struct Retirement {
+    uint64_t uValue;
+    std::function<void()> fnRetire;
+  };
+
+  VkDevice m_pDevice;
+  VkSemaphore m_pSemaphore;
+  uint64_t m_uLastSubmitted;
+  uint64_t m_uCompleted;
+
+  /// Sorted by value.
+  std::deque<Retirement> m_aRetirements;
+};
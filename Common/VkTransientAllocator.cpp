@@ -0,0 +1,189 @@
+#include "VkTransientAllocator.h"
+#include <algorithm>
+
+static VkDeviceSize AlignUp(VkDeviceSize uValue, VkDeviceSize uAlignment) {
+  return uAlignment ? (uValue + uAlignment - 1) / uAlignment * uAlignment : uValue;
+}
+
+VkTransientAllocator::VkTransientAllocator() {
+  m_bPlanned = false;
+  m_bLazilyAllocated = false;
+}
+
+uint32_t VkTransientAllocator::AddImage(const VkImageCreateInfo &createInfo, uint32_t uFirstPass,
+  uint32_t uLastPass) {
+  _ASSERT(!m_bPlanned && "Add every resource before planning!");
+
+  m_aResources.push_back(Resource{createInfo, {}, uFirstPass, std::max(uFirstPass, uLastPass),
+                                  VK_NULL_HANDLE, VK_NULL_HANDLE, {}, UINT32_MAX, 0});
+  return (uint32_t)m_aResources.size() - 1;
+}
+
+uint32_t VkTransientAllocator::AddBuffer(const VkBufferCreateInfo &createInfo,
+  uint32_t uFirstPass, uint32_t uLastPass) {
+  _ASSERT(!m_bPlanned && "Add every resource before planning!");
+
+  m_aResources.push_back(Resource{{}, createInfo, uFirstPass, std::max(uFirstPass, uLastPass),
+                                  VK_NULL_HANDLE, VK_NULL_HANDLE, {}, UINT32_MAX, 0});
+  return (uint32_t)m_aResources.size() - 1;
+}
+
+VKHRESULT VkTransientAllocator::Plan(VkDevice pDevice) {
+  VKHRESULT hr = VK_SUCCESS;
+  std::vector<uint32_t> aOrder;
+  std::vector<const Resource *> aOverlapping;
+  VkDeviceSize uOffset;
+  bool bBuffer;
+  uint32_t i;
+
+  if (m_bPlanned)
+    return hr;
+
+  for (auto &resource : m_aResources) {
+    if (resource.CreateInfo.sType == VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO) {
+      V_RETURN(vkCreateImage(pDevice, &resource.CreateInfo, nullptr, &resource.pImage));
+      vkGetImageMemoryRequirements(pDevice, resource.pImage, &resource.Requirements);
+    } else {
+      V_RETURN(vkCreateBuffer(pDevice, &resource.BufferInfo, nullptr, &resource.pBuffer));
+      vkGetBufferMemoryRequirements(pDevice, resource.pBuffer, &resource.Requirements);
+    }
+  }
+
+  /// Largest first, the small ones fill the gaps. Every image is optimally tiled, so the buffer
+  /// image granularity only applies between images and buffers, which never share a block.
+  for (i = 0; i < m_aResources.size(); ++i)
+    aOrder.push_back(i);
+  std::stable_sort(aOrder.begin(), aOrder.end(), [this](uint32_t a, uint32_t b) {
+    return m_aResources[a].Requirements.size > m_aResources[b].Requirements.size;
+  });
+
+  for (uint32_t uResource : aOrder) {
+    Resource &resource = m_aResources[uResource];
+
+    bBuffer = resource.pBuffer != VK_NULL_HANDLE;
+    for (i = 0; i < m_aBlocks.size(); ++i) {
+      if (m_aBlocks[i].bBuffers == bBuffer &&
+          (m_aBlocks[i].uMemoryTypeBits & resource.Requirements.memoryTypeBits))
+        break;
+    }
+    if (i == m_aBlocks.size())
+      m_aBlocks.push_back(
+          Block{bBuffer, resource.Requirements.memoryTypeBits, 1, 0, VK_NULL_HANDLE});
+    Block &block = m_aBlocks[i];
+
+    /// First fit below the resources of the block alive in any of the same passes.
+    aOverlapping.clear();
+    for (auto &placed : m_aResources) {
+      if (placed.uBlock == i && placed.uFirstPass <= resource.uLastPass &&
+          resource.uFirstPass <= placed.uLastPass)
+        aOverlapping.push_back(&placed);
+    }
+    std::sort(aOverlapping.begin(), aOverlapping.end(),
+              [](const Resource *a, const Resource *b) { return a->uOffset < b->uOffset; });
+
+    uOffset = 0;
+    for (auto pPlaced : aOverlapping) {
+      if (uOffset + resource.Requirements.size <= pPlaced->uOffset)
+        break;
+      uOffset = std::max(uOffset, AlignUp(pPlaced->uOffset + pPlaced->Requirements.size,
+                                          resource.Requirements.alignment));
+    }
+
+    resource.uBlock = i;
+    resource.uOffset = uOffset;
+    block.uMemoryTypeBits &= resource.Requirements.memoryTypeBits;
+    block.uAlignment = std::max(block.uAlignment, resource.Requirements.alignment);
+    block.uSize = std::max(block.uSize, uOffset + resource.Requirements.size);
+  }
+
+  m_bPlanned = true;
+
+  return hr;
+}
+
+VKHRESULT VkTransientAllocator::Allocate(VkDevice pDevice, bool bLazilyAllocated) {
+  VKHRESULT hr = VK_SUCCESS;
+  VkMemoryRequirements requirements;
+  bool bBlockLazilyAllocated;
+
+  V_RETURN(Plan(pDevice));
+
+  m_bLazilyAllocated = !m_aBlocks.empty();
+  for (auto &block : m_aBlocks) {
+    if (block.pMem)
+      continue;
+    requirements.size = block.uSize;
+    requirements.alignment = block.uAlignment;
+    requirements.memoryTypeBits = block.uMemoryTypeBits;
+    /// Buffers are never lazily allocated.
+    V_RETURN(AllocateVmaMemory(&requirements, bLazilyAllocated && !block.bBuffers, &block.pMem,
+                               &bBlockLazilyAllocated));
+    m_bLazilyAllocated &= bBlockLazilyAllocated;
+  }
+
+  for (auto &resource : m_aResources) {
+    if (resource.pImage) {
+      V_RETURN(BindVmaImageMemory(m_aBlocks[resource.uBlock].pMem, resource.uOffset,
+                                  resource.pImage));
+    } else {
+      V_RETURN(BindVmaBufferMemory(m_aBlocks[resource.uBlock].pMem, resource.uOffset,
+                                   resource.pBuffer));
+    }
+  }
+
+  return hr;
+}
+
+void VkTransientAllocator::Destroy(VkDevice pDevice) {
+  for (auto &resource : m_aResources) {
+    vkDestroyImage(pDevice, resource.pImage, nullptr);
+    vkDestroyBuffer(pDevice, resource.pBuffer, nullptr);
+  }
+  for (auto &block : m_aBlocks)
+    FreeVmaMemory(block.pMem);
+
+  m_aResources.clear();
+  m_aBlocks.clear();
+  m_bPlanned = false;
+  m_bLazilyAllocated = false;
+}
+
+VkImage VkTransientAllocator::GetImage(uint32_t uIndex) const {
+  return uIndex < m_aResources.size() ? m_aResources[uIndex].pImage : VK_NULL_HANDLE;
+}
+
+VkBuffer VkTransientAllocator::GetBuffer(uint32_t uIndex) const {
+  return uIndex < m_aResources.size() ? m_aResources[uIndex].pBuffer : VK_NULL_HANDLE;
+}
+
+uint32_t VkTransientAllocator::GetResourceCount() const {
+  return (uint32_t)m_aResources.size();
+}
+
+VkDeviceSize VkTransientAllocator::GetRequestedBytes() const {
+  VkDeviceSize uBytes = 0;
+
+  for (auto &resource : m_aResources)
+    uBytes += resource.Requirements.size;
+  return uBytes;
+}
+
+VkDeviceSize VkTransientAllocator::GetBlockBytes() const {
+  VkDeviceSize uBytes = 0;
+
+  for (auto &block : m_aBlocks)
+    uBytes += block.uSize;
+  return uBytes;
+}
+
+VkDeviceSize VkTransientAllocator::GetCommittedBytes(VkDevice pDevice) const {
+  VkDeviceSize uBytes = 0;
+
+  for (auto &block : m_aBlocks)
+    uBytes += GetVmaCommittedBytes(pDevice, block.pMem);
+  return uBytes;
+}
+
+bool VkTransientAllocator::IsLazilyAllocated() const {
+  return m_bLazilyAllocated;
+}
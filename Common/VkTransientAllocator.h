@@ -0,0 +1,73 @@
+#pragma once
+#include "VkUtilities.h"
+#include <vector>
+
+///
+/// Transient attachments and buffers of a frame, packed into shared memory blocks. Each resource is
+/// used from its first to its last pass of the frame, resources whose pass ranges don't overlap
+/// alias the same bytes. Images and buffers never share a block, so the buffer image granularity
+/// doesn't apply. Blocks come from lazily allocated memory when the device offers it, so
+/// attachments never stored by a render pass may not be backed by memory at all on tilers.
+///
+/// Plain handles, a copy may be retired and destroyed in place of the original.
+///
+class VkTransientAllocator
+{
+public:
+  VkTransientAllocator();
+
+  /// Returns the index of the image, the allocator creates it in `Plan`. The usage should include
+  /// VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT for the lazily allocated memory.
+  uint32_t AddImage(const VkImageCreateInfo &createInfo, uint32_t uFirstPass, uint32_t uLastPass);
+  /// Shares the indices of the images.
+  uint32_t AddBuffer(const VkBufferCreateInfo &createInfo, uint32_t uFirstPass,
+                     uint32_t uLastPass);
+
+  /// Create the resources and pack them, no memory is allocated yet.
+  VKHRESULT Plan(VkDevice pDevice);
+  /// Plan if not yet, allocate the blocks and bind the resources.
+  VKHRESULT Allocate(VkDevice pDevice, bool bLazilyAllocated);
+  /// Destroys the resources and frees the blocks, the resources added are forgotten as well.
+  void Destroy(VkDevice pDevice);
+
+  /// VK_NULL_HANDLE when the index is a buffer, and the other way around.
+  VkImage GetImage(uint32_t uIndex) const;
+  VkBuffer GetBuffer(uint32_t uIndex) const;
+  uint32_t GetResourceCount() const;
+
+  /// Sum of the resources' sizes, what dedicated allocations would take.
+  VkDeviceSize GetRequestedBytes() const;
+  /// Sum of the blocks' sizes, after aliasing.
+  VkDeviceSize GetBlockBytes() const;
+  /// Bytes of the allocated blocks backed by memory, lazily allocated ones only as far as the
+  /// device committed them.
+  VkDeviceSize GetCommittedBytes(VkDevice pDevice) const;
+  /// Every block is lazily allocated.
+  bool IsLazilyAllocated() const;
+
+private:
+  struct Resource {
+    VkImageCreateInfo CreateInfo;
+    VkBufferCreateInfo BufferInfo; /// Only for buffers, whose `CreateInfo` is zeroed.
+    uint32_t uFirstPass;
+    uint32_t uLastPass;
+    VkImage pImage;
+    VkBuffer pBuffer;
+    VkMemoryRequirements Requirements;
+    uint32_t uBlock;
+    VkDeviceSize uOffset;
+  };
+
+  struct Block {
+    bool bBuffers;
+    uint32_t uMemoryTypeBits;
+    VkDeviceSize uAlignment;
+    VkDeviceSize uSize;
+    VMAHandle pMem;
+  };
+
+  std::vector<Resource> m_aResources;
+  std::vector<Block> m_aBlocks;
+  bool m_bPlanned;
+  bool m_bLazilyAllocated;
+};
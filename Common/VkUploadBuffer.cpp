@@ -23,7 +23,7 @@ VKHRESULT VkUploadBuffer::CreateBuffer(
 
   V_RETURN(CreateUploadBuffer(pDevice, cbElementStride * uElementCount,
     bIsConstant ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-    &m_pUploadBuffer, &m_pUploadBufferMem, (void **)&m_pMappedData));
+    &m_pUploadBuffer, &m_pUploadBufferMem, (void **)&m_pMappedData, VkMemoryCategory::Uniforms));
 
   m_cbPerElement = cbElement;
   m_cbElementStride = cbElementStride;
@@ -0,0 +1,627 @@
+#include "VkUploadContext.h"
+#include <algorithm>
+#include <string.h>
+
+/// Covers the texel block size of every format copied into images.
+static const VkDeviceSize s_uStagingAlignment = 16;
+
+VkUploadContext::VkUploadContext() {
+  m_pDevice = VK_NULL_HANDLE;
+  m_uTransferQueueFamily = 0;
+  m_uGraphicsQueueFamily = 0;
+  m_pTransferQueue = VK_NULL_HANDLE;
+  m_pGraphicsQueue = VK_NULL_HANDLE;
+  m_pGraphicsTimeline = nullptr;
+
+  m_pTransferCmdPool = VK_NULL_HANDLE;
+  m_pAcquireCmdPool = VK_NULL_HANDLE;
+
+  m_iRecordingBatch = -1;
+  m_pfnCmdPipelineBarrier2 = nullptr;
+}
+
+VkUploadContext::~VkUploadContext() {
+  _ASSERT(!m_pTransferCmdPool && "Call Destroy before the device is gone!");
+}
+
+VKHRESULT VkUploadContext::Create(
+  VkDevice pDevice,
+  uint32_t uTransferQueueFamily,
+  VkQueue pTransferQueue,
+  uint32_t uGraphicsQueueFamily,
+  VkQueue pGraphicsQueue,
+  VkTimeline *pGraphicsTimeline,
+  VkDeviceSize cbStagingBlockSize,
+  VkDeviceSize cbStagingBudget,
+  PFN_vkCmdPipelineBarrier2KHR pfnCmdPipelineBarrier2
+) {
+  VKHRESULT hr;
+  VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+
+  m_pDevice = pDevice;
+  m_uTransferQueueFamily = uTransferQueueFamily;
+  m_pTransferQueue = pTransferQueue;
+  m_uGraphicsQueueFamily = uGraphicsQueueFamily;
+  m_pGraphicsQueue = pGraphicsQueue;
+  m_pGraphicsTimeline = pGraphicsTimeline;
+  m_pfnCmdPipelineBarrier2 = pfnCmdPipelineBarrier2;
+
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = m_uTransferQueueFamily;
+  V_RETURN(vkCreateCommandPool(m_pDevice, &poolInfo, nullptr, &m_pTransferCmdPool));
+
+  if (IsDedicated()) {
+    poolInfo.queueFamilyIndex = m_uGraphicsQueueFamily;
+    V_RETURN(vkCreateCommandPool(m_pDevice, &poolInfo, nullptr, &m_pAcquireCmdPool));
+    V_RETURN(m_TransferTimeline.Create(m_pDevice));
+  }
+
+  V_RETURN(m_StagingPool.Create(m_pDevice, cbStagingBlockSize, cbStagingBudget));
+
+  return hr;
+}
+
+void VkUploadContext::Destroy() {
+  if (!m_pDevice)
+    return;
+
+  WaitIdle();
+  Reclaim();
+  /// Never submitted, nothing reads its staging memory.
+  if (m_iRecordingBatch >= 0)
+    ReleaseStagingBuffers(&m_aBatches[m_iRecordingBatch]);
+
+  m_aBatches.clear();
+  m_iRecordingBatch = -1;
+  m_aPendingTransitions.clear();
+  m_aPendingBufferCopies.clear();
+  m_aPendingImageCopies.clear();
+  m_aPendingReleases.clear();
+  m_aAcquireBarriers.clear();
+
+  /// Command buffers are freed along with their pools.
+  vkDestroyCommandPool(m_pDevice, m_pTransferCmdPool, nullptr);
+  m_pTransferCmdPool = VK_NULL_HANDLE;
+  vkDestroyCommandPool(m_pDevice, m_pAcquireCmdPool, nullptr);
+  m_pAcquireCmdPool = VK_NULL_HANDLE;
+  m_TransferTimeline.Destroy();
+  m_StagingPool.Destroy();
+
+  m_pDevice = VK_NULL_HANDLE;
+}
+
+bool VkUploadContext::IsDedicated() const {
+  return m_uTransferQueueFamily != m_uGraphicsQueueFamily;
+}
+
+VkStagingPool &VkUploadContext::GetStagingPool() {
+  return m_StagingPool;
+}
+
+VKHRESULT VkUploadContext::CreateBatch(UploadBatch *pBatch) {
+  VKHRESULT hr;
+  VkCommandBufferAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+
+  pBatch->pTransferCmdBuffer = VK_NULL_HANDLE;
+  pBatch->pAcquireCmdBuffer = VK_NULL_HANDLE;
+  pBatch->uCompletionValue = 0;
+  pBatch->bPending = false;
+
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = 1;
+  allocInfo.commandPool = m_pTransferCmdPool;
+  V_RETURN(vkAllocateCommandBuffers(m_pDevice, &allocInfo, &pBatch->pTransferCmdBuffer));
+
+  if (IsDedicated()) {
+    allocInfo.commandPool = m_pAcquireCmdPool;
+    V_RETURN(vkAllocateCommandBuffers(m_pDevice, &allocInfo, &pBatch->pAcquireCmdBuffer));
+  }
+
+  return hr;
+}
+
+VkCommandBuffer VkUploadContext::Begin() {
+  VKHRESULT hr;
+  UploadBatch *pBatch = nullptr;
+  int i;
+
+  if (m_iRecordingBatch >= 0)
+    return m_aBatches[m_iRecordingBatch].pTransferCmdBuffer;
+
+  Reclaim();
+
+  /// Reuse an idle batch before growing the list.
+  for (i = 0; i < (int)m_aBatches.size(); ++i) {
+    if (!m_aBatches[i].bPending) {
+      pBatch = &m_aBatches[i];
+      break;
+    }
+  }
+  if (!pBatch) {
+    m_aBatches.emplace_back();
+    pBatch = &m_aBatches.back();
+    i = (int)m_aBatches.size() - 1;
+    V(CreateBatch(pBatch));
+    if (VK_FAILED(hr)) {
+      /// Drop the partial batch so no later Begin or Reclaim sees it.
+      if (pBatch->pTransferCmdBuffer)
+        vkFreeCommandBuffers(m_pDevice, m_pTransferCmdPool, 1, &pBatch->pTransferCmdBuffer);
+      if (pBatch->pAcquireCmdBuffer)
+        vkFreeCommandBuffers(m_pDevice, m_pAcquireCmdPool, 1, &pBatch->pAcquireCmdBuffer);
+      m_aBatches.pop_back();
+      return VK_NULL_HANDLE;
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, // sType;
+    nullptr, // pNext;
+    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // flags;
+    nullptr // pInheritanceInfo;
+  };
+  V(vkBeginCommandBuffer(pBatch->pTransferCmdBuffer, &beginInfo));
+
+  m_iRecordingBatch = i;
+  m_aAcquireBarriers.clear();
+
+  return pBatch->pTransferCmdBuffer;
+}
+
+VKHRESULT VkUploadContext::AllocateStaging(VkDeviceSize cbSize, VkStagingAllocation *pAllocation) {
+  VKHRESULT hr;
+  UploadBatch *pOldest;
+
+  Reclaim();
+
+  for (;;) {
+    hr = m_StagingPool.Allocate(cbSize, s_uStagingAlignment, pAllocation);
+    if (hr != VK_ERROR_OUT_OF_POOL_MEMORY)
+      break;
+
+    /// Over budget, wait for the oldest batch holding staging memory. The copies recorded so far
+    /// hold some as well, so they are submitted to be waited too.
+    if (m_iRecordingBatch >= 0 && !m_aBatches[m_iRecordingBatch].aStagingAllocations.empty())
+      V_RETURN(Submit());
+
+    pOldest = nullptr;
+    for (auto &batch : m_aBatches) {
+      if (batch.bPending && !batch.aStagingAllocations.empty() &&
+          (!pOldest || batch.uCompletionValue < pOldest->uCompletionValue))
+        pOldest = &batch;
+    }
+    if (!pOldest)
+      break;
+
+    V_RETURN(m_pGraphicsTimeline->Wait(pOldest->uCompletionValue));
+    Reclaim();
+  }
+  if (VK_FAILED(hr))
+    return hr;
+
+  if (!Begin()) {
+    m_StagingPool.Release(*pAllocation);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  m_aBatches[m_iRecordingBatch].aStagingAllocations.push_back(*pAllocation);
+
+  return hr;
+}
+
+VKHRESULT VkUploadContext::UploadBuffer(
+  _In_ const void *pInitData,
+  size_t uByteSize,
+  VkBufferUsageFlags bufferUsage,
+  VkAccessFlags dstAccessMask,
+  VkPipelineStageFlags dstStageMask,
+  VkBuffer *ppDefaultBuffer,
+  VMAHandle *ppDefaultMem,
+  VkMemoryCategory category
+) {
+  VKHRESULT hr;
+  VkStagingAllocation staging;
+
+  V_RETURN(AllocateStaging(uByteSize, &staging));
+  memcpy(staging.pData, pInitData, uByteSize);
+
+  V_RETURN(CreateDeviceBuffer(m_pDevice, uByteSize, bufferUsage, ppDefaultBuffer, ppDefaultMem,
+                              category));
+
+  VkBufferCopy copyRegion = {
+    staging.uOffset, // srcOffset;
+    0, // dstOffset;
+    uByteSize // size;
+  };
+  QueueBufferUpload(staging.pBuffer, *ppDefaultBuffer, 1, &copyRegion, dstAccessMask,
+    dstStageMask);
+
+  return hr;
+}
+
+void VkUploadContext::QueueBufferUpload(
+  VkBuffer pSrcBuffer,
+  VkBuffer pDstBuffer,
+  uint32_t uRegionCount,
+  const VkBufferCopy *pRegions,
+  VkAccessFlags dstAccessMask,
+  VkPipelineStageFlags dstStageMask
+) {
+  uint32_t i;
+
+  /// Other ranges of the buffer may be in use by the graphics queue meanwhile.
+  for (i = 0; i < uRegionCount; ++i) {
+    m_aPendingBufferCopies.push_back({ pSrcBuffer, pDstBuffer, pRegions[i] });
+    ReleaseBuffer(pDstBuffer, dstAccessMask, dstStageMask, pRegions[i].dstOffset,
+      pRegions[i].size);
+  }
+}
+
+void VkUploadContext::QueueImageUpload(
+  VkBuffer pSrcBuffer,
+  VkImage pDstImage,
+  const VkImageSubresourceRange &subresourceRange,
+  uint32_t uRegionCount,
+  const VkBufferImageCopy *pRegions,
+  VkImageLayout newLayout,
+  VkAccessFlags dstAccessMask,
+  VkPipelineStageFlags dstStageMask
+) {
+  UploadBarrier transition = {};
+  uint32_t i;
+
+  transition.SrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  transition.DstStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  transition.Image = {
+    VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType;
+    nullptr, // pNext;
+    0, // srcAccessMask;
+    VK_ACCESS_TRANSFER_WRITE_BIT, // dstAccessMask;
+    VK_IMAGE_LAYOUT_UNDEFINED, // oldLayout;
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, // newLayout;
+    VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex;
+    VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex;
+    pDstImage, // image;
+    subresourceRange // subresourceRange;
+  };
+  Begin();
+  m_aPendingTransitions.push_back(transition);
+
+  for (i = 0; i < uRegionCount; ++i)
+    m_aPendingImageCopies.push_back({ pSrcBuffer, pDstImage, pRegions[i] });
+  ReleaseImage(pDstImage, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, newLayout,
+    dstAccessMask, dstStageMask);
+}
+
+void VkUploadContext::ReleaseBuffer(
+  VkBuffer pBuffer,
+  VkAccessFlags dstAccessMask,
+  VkPipelineStageFlags dstStageMask,
+  VkDeviceSize uOffset,
+  VkDeviceSize uSize
+) {
+  UploadBarrier barrier = {};
+
+  barrier.DstStages = dstStageMask;
+  barrier.Buffer = {
+    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, // sType;
+    nullptr, // pNext;
+    VK_ACCESS_TRANSFER_WRITE_BIT, // srcAccessMask;
+    dstAccessMask, // dstAccessMask;
+    VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex;
+    VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex;
+    pBuffer, // buffer;
+    uOffset, // offset;
+    uSize // size;
+  };
+  QueueRelease(barrier);
+}
+
+void VkUploadContext::ReleaseImage(
+  VkImage pImage,
+  const VkImageSubresourceRange &subresourceRange,
+  VkImageLayout oldLayout,
+  VkImageLayout newLayout,
+  VkAccessFlags dstAccessMask,
+  VkPipelineStageFlags dstStageMask
+) {
+  UploadBarrier barrier = {};
+
+  barrier.DstStages = dstStageMask;
+  barrier.Image = {
+    VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, // sType;
+    nullptr, // pNext;
+    VK_ACCESS_TRANSFER_WRITE_BIT, // srcAccessMask;
+    dstAccessMask, // dstAccessMask;
+    oldLayout, // oldLayout;
+    newLayout, // newLayout;
+    VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex;
+    VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex;
+    pImage, // image;
+    subresourceRange // subresourceRange;
+  };
+  QueueRelease(barrier);
+}
+
+void VkUploadContext::QueueRelease(UploadBarrier barrier) {
+  UploadBarrier release;
+
+  Begin();
+  barrier.SrcStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  if (!IsDedicated()) {
+    /// Same queue, an ordinary barrier is enough.
+    m_aPendingReleases.push_back(barrier);
+    return;
+  }
+
+  /// Release half of the ownership transfer, destination access is ignored here. An image's
+  /// halves carry the same layout transition, it's executed once.
+  barrier.Buffer.srcQueueFamilyIndex = barrier.Image.srcQueueFamilyIndex = m_uTransferQueueFamily;
+  barrier.Buffer.dstQueueFamilyIndex = barrier.Image.dstQueueFamilyIndex = m_uGraphicsQueueFamily;
+  release = barrier;
+  release.DstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  release.Buffer.dstAccessMask = release.Image.dstAccessMask = 0;
+  m_aPendingReleases.push_back(release);
+
+  /// Acquire half, source access is ignored.
+  barrier.SrcStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  barrier.Buffer.srcAccessMask = barrier.Image.srcAccessMask = 0;
+  m_aAcquireBarriers.push_back(barrier);
+}
+
+void VkUploadContext::CmdBarriers(
+  VkCommandBuffer pCmdBuffer,
+  const std::vector<UploadBarrier> &aBarriers
+) const {
+  std::vector<VkBufferMemoryBarrier> aBufferBarriers;
+  std::vector<VkImageMemoryBarrier> aImageBarriers;
+  VkPipelineStageFlags srcStageMask = 0;
+  VkPipelineStageFlags dstStageMask = 0;
+
+  if (aBarriers.empty())
+    return;
+
+  if (m_pfnCmdPipelineBarrier2) {
+    /// Every barrier keeps its own stages, a late consumer doesn't hold back the early ones.
+    std::vector<VkBufferMemoryBarrier2KHR> aBufferBarriers2;
+    std::vector<VkImageMemoryBarrier2KHR> aImageBarriers2;
+    VkDependencyInfoKHR dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+
+    for (auto &barrier : aBarriers) {
+      if (barrier.Image.image) {
+        const VkImageMemoryBarrier &image = barrier.Image;
+        aImageBarriers2.push_back({ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR, nullptr,
+          barrier.SrcStages, image.srcAccessMask, barrier.DstStages, image.dstAccessMask,
+          image.oldLayout, image.newLayout, image.srcQueueFamilyIndex,
+          image.dstQueueFamilyIndex, image.image, image.subresourceRange });
+      } else {
+        const VkBufferMemoryBarrier &buffer = barrier.Buffer;
+        aBufferBarriers2.push_back({ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR, nullptr,
+          barrier.SrcStages, buffer.srcAccessMask, barrier.DstStages, buffer.dstAccessMask,
+          buffer.srcQueueFamilyIndex, buffer.dstQueueFamilyIndex, buffer.buffer, buffer.offset,
+          buffer.size });
+      }
+    }
+    dependencyInfo.bufferMemoryBarrierCount = (uint32_t)aBufferBarriers2.size();
+    dependencyInfo.pBufferMemoryBarriers = aBufferBarriers2.data();
+    dependencyInfo.imageMemoryBarrierCount = (uint32_t)aImageBarriers2.size();
+    dependencyInfo.pImageMemoryBarriers = aImageBarriers2.data();
+    m_pfnCmdPipelineBarrier2(pCmdBuffer, &dependencyInfo);
+    return;
+  }
+
+  for (auto &barrier : aBarriers) {
+    srcStageMask |= barrier.SrcStages;
+    dstStageMask |= barrier.DstStages;
+    if (barrier.Image.image)
+      aImageBarriers.push_back(barrier.Image);
+    else
+      aBufferBarriers.push_back(barrier.Buffer);
+  }
+  vkCmdPipelineBarrier(pCmdBuffer, srcStageMask, dstStageMask, 0, 0, nullptr,
+    (uint32_t)aBufferBarriers.size(), aBufferBarriers.data(),
+    (uint32_t)aImageBarriers.size(), aImageBarriers.data());
+}
+
+void VkUploadContext::CmdTransferWriteBarrier(VkCommandBuffer pCmdBuffer) const {
+  VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(pCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void VkUploadContext::Flush() {
+  std::vector<VkBufferCopy> aBufferRegions;
+  std::vector<VkBufferImageCopy> aImageRegions;
+  std::vector<VkBuffer> aWrittenBuffers;
+  std::vector<VkImage> aWrittenImages;
+  VkCommandBuffer pCmdBuffer;
+  size_t i, j;
+
+  if (m_aPendingTransitions.empty() && m_aPendingBufferCopies.empty() &&
+      m_aPendingImageCopies.empty() && m_aPendingReleases.empty())
+    return;
+
+  pCmdBuffer = Begin();
+  if (!pCmdBuffer)
+    return;
+  CmdBarriers(pCmdBuffer, m_aPendingTransitions);
+
+  /// Copies are recorded in submission order, and only adjacent copies between the same staging
+  /// block and destination are merged. A destination written again later in the flush gets a
+  /// transfer barrier first, so overlapping writes still land in the order they were queued.
+  for (i = 0; i < m_aPendingBufferCopies.size(); i = j) {
+    const PendingBufferCopy &first = m_aPendingBufferCopies[i];
+    aBufferRegions.clear();
+    for (j = i; j < m_aPendingBufferCopies.size() &&
+                m_aPendingBufferCopies[j].pSrcBuffer == first.pSrcBuffer &&
+                m_aPendingBufferCopies[j].pDstBuffer == first.pDstBuffer; ++j)
+      aBufferRegions.push_back(m_aPendingBufferCopies[j].Region);
+    if (std::find(aWrittenBuffers.begin(), aWrittenBuffers.end(), first.pDstBuffer) !=
+        aWrittenBuffers.end())
+      CmdTransferWriteBarrier(pCmdBuffer);
+    else
+      aWrittenBuffers.push_back(first.pDstBuffer);
+    vkCmdCopyBuffer(pCmdBuffer, first.pSrcBuffer, first.pDstBuffer,
+      (uint32_t)aBufferRegions.size(), aBufferRegions.data());
+  }
+
+  for (i = 0; i < m_aPendingImageCopies.size(); i = j) {
+    const PendingImageCopy &first = m_aPendingImageCopies[i];
+    aImageRegions.clear();
+    for (j = i; j < m_aPendingImageCopies.size() &&
+                m_aPendingImageCopies[j].pSrcBuffer == first.pSrcBuffer &&
+                m_aPendingImageCopies[j].pDstImage == first.pDstImage; ++j)
+      aImageRegions.push_back(m_aPendingImageCopies[j].Region);
+    if (std::find(aWrittenImages.begin(), aWrittenImages.end(), first.pDstImage) !=
+        aWrittenImages.end())
+      CmdTransferWriteBarrier(pCmdBuffer);
+    else
+      aWrittenImages.push_back(first.pDstImage);
+    vkCmdCopyBufferToImage(pCmdBuffer, first.pSrcBuffer, first.pDstImage,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)aImageRegions.size(),
+      aImageRegions.data());
+  }
+
+  CmdBarriers(pCmdBuffer, m_aPendingReleases);
+
+  m_aPendingTransitions.clear();
+  m_aPendingBufferCopies.clear();
+  m_aPendingImageCopies.clear();
+  m_aPendingReleases.clear();
+}
+
+void VkUploadContext::DeferRelease(VkBuffer pUploadBuffer, VMAHandle pUploadMem) {
+  UploadBatch *pBatch;
+
+  Begin();
+  pBatch = &m_aBatches[m_iRecordingBatch];
+  pBatch->aStagingBuffers.push_back(pUploadBuffer);
+  pBatch->aStagingMems.push_back(pUploadMem);
+}
+
+VKHRESULT VkUploadContext::Submit(_Out_opt_ uint64_t *puCompletionValue) {
+  VKHRESULT hr = VK_SUCCESS;
+  UploadBatch *pBatch;
+  uint64_t uTransferValue;
+
+  if (puCompletionValue)
+    *puCompletionValue = m_pGraphicsTimeline->GetLastSubmitted();
+
+  if (m_iRecordingBatch < 0)
+    return hr;
+
+  Flush();
+  pBatch = &m_aBatches[m_iRecordingBatch];
+  m_iRecordingBatch = -1;
+
+  V_RETURN(vkEndCommandBuffer(pBatch->pTransferCmdBuffer));
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+  VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfo };
+  VkSemaphore pGraphicsSem = m_pGraphicsTimeline->GetSemaphore();
+  VkSemaphore pTransferSem = m_TransferTimeline.GetSemaphore();
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &pBatch->pTransferCmdBuffer;
+
+  if (!IsDedicated()) {
+    pBatch->uCompletionValue = m_pGraphicsTimeline->Next();
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &pBatch->uCompletionValue;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &pGraphicsSem;
+    V_RETURN(vkQueueSubmit(m_pGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+    pBatch->bPending = true;
+    if (puCompletionValue)
+      *puCompletionValue = pBatch->uCompletionValue;
+    return hr;
+  }
+
+  uTransferValue = m_TransferTimeline.Next();
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &uTransferValue;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &pTransferSem;
+  V_RETURN(vkQueueSubmit(m_pTransferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+  /// Acquire on the graphics queue behind the transfer timeline. The barriers also order every
+  /// graphics submission that follows, so the CPU never waits for the copies.
+  VkCommandBufferBeginInfo beginInfo = {
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, // sType;
+    nullptr, // pNext;
+    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // flags;
+    nullptr // pInheritanceInfo;
+  };
+  V_RETURN(vkBeginCommandBuffer(pBatch->pAcquireCmdBuffer, &beginInfo));
+  CmdBarriers(pBatch->pAcquireCmdBuffer, m_aAcquireBarriers);
+  V_RETURN(vkEndCommandBuffer(pBatch->pAcquireCmdBuffer));
+
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  pBatch->uCompletionValue = m_pGraphicsTimeline->Next();
+  timelineInfo.waitSemaphoreValueCount = 1;
+  timelineInfo.pWaitSemaphoreValues = &uTransferValue;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &pBatch->uCompletionValue;
+  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.pWaitSemaphores = &pTransferSem;
+  submitInfo.pWaitDstStageMask = &waitStage;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &pGraphicsSem;
+  submitInfo.pCommandBuffers = &pBatch->pAcquireCmdBuffer;
+  V_RETURN(vkQueueSubmit(m_pGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+  pBatch->bPending = true;
+  m_aAcquireBarriers.clear();
+
+  if (puCompletionValue)
+    *puCompletionValue = pBatch->uCompletionValue;
+
+  return hr;
+}
+
+void VkUploadContext::ReleaseStagingBuffers(UploadBatch *pBatch) {
+  size_t i;
+
+  for (i = 0; i < pBatch->aStagingBuffers.size(); ++i)
+    DestroyVmaBuffer(pBatch->aStagingBuffers[i], pBatch->aStagingMems[i]);
+  pBatch->aStagingBuffers.clear();
+  pBatch->aStagingMems.clear();
+
+  for (auto &allocation : pBatch->aStagingAllocations)
+    m_StagingPool.Release(allocation);
+  pBatch->aStagingAllocations.clear();
+}
+
+void VkUploadContext::Reclaim() {
+  for (auto &batch : m_aBatches) {
+    if (batch.bPending && m_pGraphicsTimeline->IsCompleted(batch.uCompletionValue)) {
+      ReleaseStagingBuffers(&batch);
+      batch.bPending = false;
+    }
+  }
+}
+
+bool VkUploadContext::IsCompleted() {
+  Reclaim();
+
+  for (auto &batch : m_aBatches) {
+    if (batch.bPending)
+      return false;
+  }
+  return m_iRecordingBatch < 0;
+}
+
+VKHRESULT VkUploadContext::WaitIdle() {
+  VKHRESULT hr = VK_SUCCESS;
+  uint64_t uLastValue = 0;
+
+  for (auto &batch : m_aBatches) {
+    if (batch.bPending)
+      uLastValue = std::max(uLastValue, batch.uCompletionValue);
+  }
+  if (uLastValue)
+    V_RETURN(m_pGraphicsTimeline->Wait(uLastValue));
+  Reclaim();
+
+  return hr;
+}
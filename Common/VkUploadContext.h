@@ -0,0 +1,186 @@
+#pragma once
+#include "VkUtilities.h"
+#include "VkTimeline.h"
+#include "VkStagingPool.h"
+#include <vector>
+
+///
+/// Records resource uploads on a dedicated transfer queue when the device has one, and hands the
+/// resources over to the graphics queue family with release/acquire barriers. Falls back to the
+/// graphics queue otherwise. Submitting never blocks the CPU, staging memory comes from a pool and
+/// returns to it once the graphics timeline reaches the value of its batch. Staging allocations
+/// past the pool's budget wait for the oldest batch instead.
+///
+/// Queued uploads and releases are recorded together by `Flush`, so a batch of any size costs a
+/// barrier before the copies, a copy per destination and a barrier after them.
+///
+class VkUploadContext
+{
+public:
+  VkUploadContext();
+  ~VkUploadContext();
+
+  VKHRESULT Create(
+    VkDevice pDevice,
+    uint32_t uTransferQueueFamily,
+    VkQueue pTransferQueue,
+    uint32_t uGraphicsQueueFamily,
+    VkQueue pGraphicsQueue,
+    VkTimeline *pGraphicsTimeline,
+    VkDeviceSize cbStagingBlockSize,
+    VkDeviceSize cbStagingBudget,
+    _In_opt_ PFN_vkCmdPipelineBarrier2KHR pfnCmdPipelineBarrier2
+  );
+
+  void Destroy();
+
+  /// Command buffer recording the copies of the current batch, valid until `Submit`.
+  VkCommandBuffer Begin();
+
+  /// Staging memory released along with the current batch. Call it before recording the copies
+  /// reading it, it may submit the current batch to stay within the budget.
+  VKHRESULT AllocateStaging(VkDeviceSize cbSize, _Out_ VkStagingAllocation *pAllocation);
+
+  /// Create a device local buffer and record the copy of its initial data.
+  VKHRESULT UploadBuffer(
+    _In_ const void *pInitData,
+    size_t uByteSize,
+    VkBufferUsageFlags bufferUsage,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask,
+    VkBuffer *ppDefaultBuffer,
+    VMAHandle *ppDefaultMem,
+    VkMemoryCategory category = VkMemoryCategory::Other
+  );
+
+  /// Queue copies of staged data into a buffer and the release of the regions written, the
+  /// graphics queue acquires them before `dstStageMask`.
+  void QueueBufferUpload(
+    VkBuffer pSrcBuffer,
+    VkBuffer pDstBuffer,
+    uint32_t uRegionCount,
+    const VkBufferCopy *pRegions,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask
+  );
+
+  /// Likewise for an image in VK_IMAGE_LAYOUT_UNDEFINED, transferred into `newLayout`.
+  void QueueImageUpload(
+    VkBuffer pSrcBuffer,
+    VkImage pDstImage,
+    const VkImageSubresourceRange &subresourceRange,
+    uint32_t uRegionCount,
+    const VkBufferImageCopy *pRegions,
+    VkImageLayout newLayout,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask
+  );
+
+  /// Finish the uploads of a buffer range, the graphics queue acquires it before `dstStageMask`.
+  /// The release is queued, the copies recorded into `Begin` so far come first.
+  void ReleaseBuffer(
+    VkBuffer pBuffer,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask,
+    VkDeviceSize uOffset = 0,
+    VkDeviceSize uSize = VK_WHOLE_SIZE
+  );
+
+  /// Finish the uploads of an image and transfer its layout from `oldLayout` into `newLayout`.
+  void ReleaseImage(
+    VkImage pImage,
+    const VkImageSubresourceRange &subresourceRange,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask
+  );
+
+  /// Record the queued uploads into the current batch, `Submit` flushes as well.
+  void Flush();
+
+  /// Take over a staging buffer, it's freed once the current batch completes.
+  void DeferRelease(VkBuffer pUploadBuffer, VMAHandle pUploadMem);
+
+  /// Submit the current batch, graphics work submitted afterwards sees the uploaded data.
+  /// Returns the graphics timeline value signaled once the batch completes.
+  VKHRESULT Submit(_Out_opt_ uint64_t *puCompletionValue = nullptr);
+
+  /// Release staging buffers of the completed batches.
+  void Reclaim();
+
+  bool IsCompleted();
+
+  VKHRESULT WaitIdle();
+
+  bool IsDedicated() const;
+
+  VkStagingPool &GetStagingPool();
+
+private:
+  struct UploadBatch {
+    VkCommandBuffer pTransferCmdBuffer;
+    VkCommandBuffer pAcquireCmdBuffer;
+    uint64_t uCompletionValue; /// On the graphics timeline.
+    bool bPending;
+
+    std::vector<VkBuffer> aStagingBuffers;
+    std::vector<VMAHandle> aStagingMems;
+    std::vector<VkStagingAllocation> aStagingAllocations;
+  };
+
+  /// A barrier with its own stages, all of them merged into one without synchronization2.
+  struct UploadBarrier {
+    VkPipelineStageFlags SrcStages;
+    VkPipelineStageFlags DstStages;
+    VkBufferMemoryBarrier Buffer; /// Unless `Image.image` is set.
+    VkImageMemoryBarrier Image;
+  };
+
+  struct PendingBufferCopy {
+    VkBuffer pSrcBuffer;
+    VkBuffer pDstBuffer;
+    VkBufferCopy Region;
+  };
+
+  struct PendingImageCopy {
+    VkBuffer pSrcBuffer;
+    VkImage pDstImage;
+    VkBufferImageCopy Region;
+  };
+
+  VKHRESULT CreateBatch(UploadBatch *pBatch);
+  /// `barrier` is the whole transfer, split into its halves for a dedicated queue.
+  void QueueRelease(UploadBarrier barrier);
+  void CmdBarriers(VkCommandBuffer pCmdBuffer, const std::vector<UploadBarrier> &aBarriers) const;
+  /// Orders a copy after earlier copies into the same destination.
+  void CmdTransferWriteBarrier(VkCommandBuffer pCmdBuffer) const;
+  void ReleaseStagingBuffers(UploadBatch *pBatch);
+
+  VkDevice m_pDevice;
+  uint32_t m_uTransferQueueFamily;
+  uint32_t m_uGraphicsQueueFamily;
+  VkQueue m_pTransferQueue;
+  VkQueue m_pGraphicsQueue;
+  VkTimeline *m_pGraphicsTimeline;
+  VkTimeline m_TransferTimeline; /// Only with a dedicated transfer queue.
+
+  VkCommandPool m_pTransferCmdPool;
+  VkCommandPool m_pAcquireCmdPool;
+
+  VkStagingPool m_StagingPool;
+
+  std::vector<UploadBatch> m_aBatches;
+  int m_iRecordingBatch;
+
+  PFN_vkCmdPipelineBarrier2KHR m_pfnCmdPipelineBarrier2; /// Null without synchronization2.
+
+  /// Recorded by `Flush`, transitions into TRANSFER_DST_OPTIMAL, copies, then releases.
+  std::vector<UploadBarrier> m_aPendingTransitions;
+  std::vector<PendingBufferCopy> m_aPendingBufferCopies;
+  std::vector<PendingImageCopy> m_aPendingImageCopies;
+  std::vector<UploadBarrier> m_aPendingReleases;
+
+  /// Acquire barriers recorded on the graphics queue for the current batch.
+  std::vector<UploadBarrier> m_aAcquireBarriers;
+};
@@ -1,6 +1,7 @@
 #include "VkUtilities.h"
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
 #include <cstdarg>
@@ -17,6 +18,11 @@ struct VulkanResoureBindingConfig {
   uint32_t MinUniformBufferOffsetAlignment;
 } g_aResourceBindingConfig;
 
+/// Bytes of the live allocations per category, in their `pUserData` as the category plus one.
+static std::atomic<uint64_t> g_acbCategoryBytes[(uint32_t)VkMemoryCategory::Count];
+static std::atomic<uint64_t> g_cbAllocatedBytes;
+static std::atomic<uint64_t> g_cbMemoryBudget;
+
 #ifdef _WIN32
 void vkUtilsTrace(const char* fmt, ...) {
   char buff[1024];
@@ -89,51 +95,57 @@ VkShaderModule CreateShaderModule(
   return hr == VK_SUCCESS ? pShaderModule : VK_NULL_HANDLE;
 }
 
-VkShaderModule CreateShaderModuleFromSPIRVFile(
-  VkDevice pDevice,
-  const wchar_t *pFileName
+VKHRESULT LoadSPIRVFile(
+  const wchar_t *pFileName,
+  std::vector<uint32_t> *pCode
 ) {
-  VKHRESULT hr;
   FILE *fd;
-  unsigned char *pBuffer;
   size_t nlen, idx, nleft, count;
-  VkShaderModule shaderModule = VK_NULL_HANDLE;
-  WCHAR szFilePath[MAX_PATH];
+  wchar_t szFilePath[MAX_PATH];
 
+  pCode->clear();
   if(FindDemoMediaFileAbsPath(pFileName, MAX_PATH, szFilePath))
-    return VK_NULL_HANDLE;
+    return VK_ERROR_INITIALIZATION_FAILED;
 
   if (_wfopen_s(&fd, szFilePath, L"rb")) {
-    V(-1 && (VKHRESULT)(uintptr_t)(void*)"Can not find the shader File");
-    return VK_NULL_HANDLE;
+    VK_TRACE("Can not find the shader File\n");
+    return VK_ERROR_INITIALIZATION_FAILED;
   }
 
   fseek(fd, 0, SEEK_END);
   nlen = ftell(fd);
-  pBuffer = new unsigned char[nlen];
-  if (!pBuffer) {
-    V((VKHRESULT)(uintptr_t)(void*)"Can not allocate memory");
-    fclose(fd);
-    return VK_NULL_HANDLE;
-  }
+  /// SPIR-V is a stream of words.
+  pCode->resize((nlen + sizeof(uint32_t) - 1) / sizeof(uint32_t));
 
   fseek(fd, 0, SEEK_SET);
   idx = 0;
   nleft = nlen;
   do {
-    count = fread_s(pBuffer + idx, nleft, 1, nleft, fd);
+    count = fread_s((unsigned char *)pCode->data() + idx, nleft, 1, nleft, fd);
     idx += count;
     nleft -= count;
-  } while (!count);
-  if(!nleft)
-    shaderModule = CreateShaderModule(pDevice, (uint32_t *)pBuffer, nlen);
-  else
-    V((VKHRESULT)(uintptr_t)(void*)"Can not read file context");
-
+  } while (count && nleft);
   fclose(fd);
-  delete[] pBuffer;
 
-  return shaderModule;
+  if (nleft || !nlen) {
+    VK_TRACE("Can not read file context\n");
+    pCode->clear();
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  return VK_SUCCESS;
+}
+
+VkShaderModule CreateShaderModuleFromSPIRVFile(
+  VkDevice pDevice,
+  const wchar_t *pFileName
+) {
+  std::vector<uint32_t> code;
+
+  if (LoadSPIRVFile(pFileName, &code) != VK_SUCCESS)
+    return VK_NULL_HANDLE;
+
+  return CreateShaderModule(pDevice, code.data(), code.size() * sizeof(uint32_t));
 }
 
 // $(VK_SDK_PATH)\Bin\glslangValidator -V %(Filename)%(Extension) -o $(IntDir)%(Filename)%(Extension).spv
@@ -157,7 +169,8 @@ uint32_t GetVulkanApiVersion() {
 VKHRESULT InitializeVmaAllocator(
   VkInstance pInstance,
   VkPhysicalDevice pPhysicalDevice,
-  VkDevice pDevice
+  VkDevice pDevice,
+  bool bMemoryBudget
 ) {
 
   VKHRESULT hr;
@@ -167,14 +180,14 @@ VKHRESULT InitializeVmaAllocator(
   createInfo.device = pDevice;
   createInfo.instance = pInstance;
   createInfo.vulkanApiVersion = GetVulkanApiVersion();
-  createInfo.flags = 0;
+  createInfo.flags = bMemoryBudget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0;
   V_RETURN(vmaCreateAllocator(&createInfo, &g_pVmaAllocator));
 
   VkPhysicalDeviceProperties properties;
 
   vkGetPhysicalDeviceProperties(pPhysicalDevice, &properties);
 
-  g_aResourceBindingConfig.MinUniformBufferOffsetAlignment = (UINT)properties.limits.minUniformBufferOffsetAlignment;
+  g_aResourceBindingConfig.MinUniformBufferOffsetAlignment = (uint32_t)properties.limits.minUniformBufferOffsetAlignment;
 
   return hr;
 }
@@ -186,10 +199,113 @@ void DestroyVmaAllocator() {
   }
 }
 
+///
+/// Reserve the bytes of an allocation before it is made, fails when they would exceed the budget.
+/// The reservation is swapped in whole, so concurrent allocations never see each other's
+/// overshoot.
+///
+static VKHRESULT ReserveVmaBudget(
+  uint64_t cbSize,
+  VkMemoryCategory category
+) {
+  uint64_t cbBudget = g_cbMemoryBudget;
+  uint64_t cbAllocated = g_cbAllocatedBytes;
+
+  do {
+    if (cbBudget && cbAllocated + cbSize > cbBudget) {
+      VK_TRACE("Allocating %llu bytes of %s memory exceeds the budget of %llu bytes, %llu bytes "
+               "are allocated.\n", (unsigned long long)cbSize, GetMemoryCategoryName(category),
+               (unsigned long long)cbBudget, (unsigned long long)cbAllocated);
+      return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+  } while (!g_cbAllocatedBytes.compare_exchange_weak(cbAllocated, cbAllocated + cbSize));
+
+  return VK_SUCCESS;
+}
+
+static void ReleaseVmaBudget(
+  uint64_t cbSize
+) {
+  g_cbAllocatedBytes -= cbSize;
+}
+
+///
+/// Tag a new allocation with its category and settle its reservation to the allocated size.
+///
+static void TrackVmaAllocation(
+  VmaAllocation pAllocation,
+  uint64_t cbReserved,
+  VkMemoryCategory category
+) {
+  VmaAllocationInfo info;
+
+  vmaGetAllocationInfo(g_pVmaAllocator, pAllocation, &info);
+  g_cbAllocatedBytes += info.size - cbReserved;
+  vmaSetAllocationUserData(g_pVmaAllocator, pAllocation, (void *)((uintptr_t)category + 1));
+  g_acbCategoryBytes[(uint32_t)category] += info.size;
+}
+
+///
+/// vmaCreateBuffer with the memory reserved against the budget before it is allocated.
+///
+static VKHRESULT CreateVmaBuffer(
+  VkDevice pDevice,
+  const VkBufferCreateInfo *pBufferInfo,
+  const VmaAllocationCreateInfo *pAllocInfo,
+  VkBuffer *ppBuffer,
+  VMAHandle *ppMem,
+  _Out_opt_ VmaAllocationInfo *pAllocationInfo,
+  VkMemoryCategory category
+) {
+  VKHRESULT hr;
+  VkMemoryRequirements requirements;
+
+  *ppMem = nullptr;
+  V_RETURN(vkCreateBuffer(pDevice, pBufferInfo, nullptr, ppBuffer));
+  vkGetBufferMemoryRequirements(pDevice, *ppBuffer, &requirements);
+  hr = ReserveVmaBudget(requirements.size, category);
+  if (VK_FAILED(hr)) {
+    vkDestroyBuffer(pDevice, *ppBuffer, nullptr);
+    *ppBuffer = VK_NULL_HANDLE;
+    return hr;
+  }
+
+  V(vmaAllocateMemoryForBuffer(g_pVmaAllocator, *ppBuffer, pAllocInfo,
+    (VmaAllocation *)ppMem, pAllocationInfo));
+  if (VK_SUCCEEDED(hr))
+    V(vmaBindBufferMemory(g_pVmaAllocator, (VmaAllocation)*ppMem, *ppBuffer));
+  if (VK_FAILED(hr)) {
+    ReleaseVmaBudget(requirements.size);
+    vmaDestroyBuffer(g_pVmaAllocator, *ppBuffer, (VmaAllocation)*ppMem);
+    *ppBuffer = VK_NULL_HANDLE;
+    *ppMem = nullptr;
+    return hr;
+  }
+  TrackVmaAllocation((VmaAllocation)*ppMem, requirements.size, category);
+
+  return hr;
+}
+
+static void UntrackVmaAllocation(
+  VmaAllocation pAllocation
+) {
+  VmaAllocationInfo info;
+
+  if (!pAllocation)
+    return;
+
+  vmaGetAllocationInfo(g_pVmaAllocator, pAllocation, &info);
+  if (info.pUserData) {
+    g_acbCategoryBytes[(uintptr_t)info.pUserData - 1] -= info.size;
+    g_cbAllocatedBytes -= info.size;
+  }
+}
+
 void DestroyVmaBuffer(
   VkBuffer pBuffer,
   VMAHandle pMem
 ) {
+  UntrackVmaAllocation((VmaAllocation)pMem);
   vmaDestroyBuffer(g_pVmaAllocator, pBuffer, (VmaAllocation)pMem);
 }
 
@@ -197,6 +313,7 @@ void DestroyVmaImage(
   VkImage pBuffer,
   VMAHandle pMem
 ) {
+  UntrackVmaAllocation((VmaAllocation)pMem);
   vmaDestroyImage(g_pVmaAllocator, pBuffer, (VmaAllocation)pMem);
 }
 
@@ -204,6 +321,96 @@ VMAHandle GetVmaAllocator() {
   return (VMAHandle)g_pVmaAllocator;
 }
 
+void GetVmaMemoryUsage(
+  _Out_opt_ uint64_t *pcbUsed,
+  _Out_opt_ uint64_t *pcbReserved
+) {
+  VmaStats stats = {};
+
+  if (g_pVmaAllocator)
+    vmaCalculateStats(g_pVmaAllocator, &stats);
+
+  if (pcbUsed)
+    *pcbUsed = stats.total.usedBytes;
+  if (pcbReserved)
+    *pcbReserved = stats.total.usedBytes + stats.total.unusedBytes;
+}
+
+const char *GetMemoryCategoryName(VkMemoryCategory category) {
+  static const char *s_aszNames[] = {
+    "attachment", "texture", "mesh", "uniform", "staging", "other"
+  };
+
+  if (category >= VkMemoryCategory::Count)
+    return "unknown";
+  return s_aszNames[(uint32_t)category];
+}
+
+uint32_t GetVmaHeapBudgets(
+  _Out_opt_ VkMemoryHeapBudget *pHeaps,
+  uint32_t uMaxHeaps
+) {
+  const VkPhysicalDeviceMemoryProperties *pProperties;
+  VmaBudget aBudgets[VK_MAX_MEMORY_HEAPS];
+  uint32_t i;
+
+  if (!g_pVmaAllocator)
+    return 0;
+
+  vmaGetMemoryProperties(g_pVmaAllocator, &pProperties);
+  vmaGetBudget(g_pVmaAllocator, aBudgets);
+
+  for (i = 0; pHeaps && i < std::min(uMaxHeaps, pProperties->memoryHeapCount); ++i) {
+    pHeaps[i].cbUsage = aBudgets[i].usage;
+    pHeaps[i].cbBudget = aBudgets[i].budget;
+    pHeaps[i].cbAllocated = aBudgets[i].allocationBytes;
+    pHeaps[i].bDeviceLocal =
+      !!(pProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT);
+  }
+
+  return pProperties->memoryHeapCount;
+}
+
+void GetVmaCategoryUsage(
+  _Out_ uint64_t pcbCategories[(uint32_t)VkMemoryCategory::Count]
+) {
+  for (uint32_t i = 0; i < (uint32_t)VkMemoryCategory::Count; ++i)
+    pcbCategories[i] = g_acbCategoryBytes[i];
+}
+
+void SetVmaMemoryBudget(uint64_t cbBudget) {
+  g_cbMemoryBudget = cbBudget;
+}
+
+uint64_t GetVmaMemoryBudget() {
+  return g_cbMemoryBudget;
+}
+
+void LogVmaMemoryUsage() {
+  VkMemoryHeapBudget aHeaps[VK_MAX_MEMORY_HEAPS];
+  uint64_t acbCategories[(uint32_t)VkMemoryCategory::Count];
+  uint32_t uHeapCount, i;
+
+  uHeapCount = std::min(GetVmaHeapBudgets(aHeaps, VK_MAX_MEMORY_HEAPS), VK_MAX_MEMORY_HEAPS);
+  for (i = 0; i < uHeapCount; ++i) {
+    VK_TRACE("Heap %u (%s): %.1f of %.1f MiB used, %.1f MiB allocated by this process.\n", i,
+             aHeaps[i].bDeviceLocal ? "device local" : "host", aHeaps[i].cbUsage / 1048576.0,
+             aHeaps[i].cbBudget / 1048576.0, aHeaps[i].cbAllocated / 1048576.0);
+  }
+
+  GetVmaCategoryUsage(acbCategories);
+  VK_TRACE("Allocated:");
+  for (i = 0; i < (uint32_t)VkMemoryCategory::Count; ++i) {
+    VK_TRACE(" %s %.1f MiB", GetMemoryCategoryName((VkMemoryCategory)i),
+             acbCategories[i] / 1048576.0);
+  }
+  if (g_cbMemoryBudget)
+    VK_TRACE(", %.1f of %.1f MiB budget.\n", g_cbAllocatedBytes / 1048576.0,
+             g_cbMemoryBudget / 1048576.0);
+  else
+    VK_TRACE(".\n");
+}
+
 VKHRESULT CreateDefaultBuffer(
   VkDevice pDevice,
   VkCommandBuffer pCmdBuffer,
@@ -213,33 +420,24 @@ VKHRESULT CreateDefaultBuffer(
   VkBuffer *ppUploadBuffer,
   VMAHandle *ppUploadMem,
   VkBuffer *ppDefaultBuffer,
-  VMAHandle *ppDefaultMem
+  VMAHandle *ppDefaultMem,
+  VkMemoryCategory category
 ) {
   VKHRESULT hr;
-  VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-  bufferInfo.size = uByteSize;
-  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-  VmaAllocationCreateInfo allocInfo = {};
-  allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
-  VmaAllocationInfo mappedInfo = {};
-  V(vmaCreateBuffer(g_pVmaAllocator, &bufferInfo, &allocInfo, ppUploadBuffer, (VmaAllocation*)ppUploadMem, &mappedInfo));
+  V(CreateUploadBuffer(pDevice, uByteSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, ppUploadBuffer,
+                       ppUploadMem, nullptr));
   if (VK_FAILED(hr))
     return hr;
+  VmaAllocationInfo mappedInfo = {};
+  vmaGetAllocationInfo(g_pVmaAllocator, (VmaAllocation)*ppUploadMem, &mappedInfo);
   memcpy(mappedInfo.pMappedData, pInitData, uByteSize);
 
-  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | bufferUsage;
-  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-  allocInfo.flags = 0;
-
-  V_RETURN(vmaCreateBuffer(g_pVmaAllocator, &bufferInfo, &allocInfo, ppDefaultBuffer, (VmaAllocation*)ppDefaultMem, nullptr));
+  V(CreateDeviceBuffer(pDevice, uByteSize, bufferUsage, ppDefaultBuffer, ppDefaultMem, category));
   if (VK_FAILED(hr)) {
-    vmaDestroyBuffer(g_pVmaAllocator, *ppUploadBuffer, (VmaAllocation)*ppUploadMem);
+    DestroyVmaBuffer(*ppUploadBuffer, *ppUploadMem);
     *ppUploadBuffer = NULL;
-    ppUploadMem = NULL;
+    *ppUploadMem = NULL;
     return hr;
   }
 
@@ -264,7 +462,8 @@ VKHRESULT CreateUploadBuffer(
   VkBufferUsageFlags bufferUsage,
   VkBuffer *ppUploadBuffer,
   VMAHandle *ppUploadMem,
-  _Out_opt_ void ** ppMappedData
+  _Out_opt_ void ** ppMappedData,
+  VkMemoryCategory category
 ) {
 
   VKHRESULT hr;
@@ -276,10 +475,11 @@ VKHRESULT CreateUploadBuffer(
 
   VmaAllocationCreateInfo allocInfo = {};
   allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
 
   VmaAllocationInfo mappedInfo = {};
-  V(vmaCreateBuffer(g_pVmaAllocator, &bufferInfo, &allocInfo, ppUploadBuffer, (VmaAllocation*)ppUploadMem, &mappedInfo));
+  hr = CreateVmaBuffer(pDevice, &bufferInfo, &allocInfo, ppUploadBuffer, ppUploadMem, &mappedInfo,
+                       category);
   if (VK_FAILED(hr))
     return hr;
 
@@ -289,21 +489,146 @@ VKHRESULT CreateUploadBuffer(
   return hr;
 }
 
+VKHRESULT CreateDeviceBuffer(
+  VkDevice pDevice,
+  size_t uByteSize,
+  VkBufferUsageFlags bufferUsage,
+  VkBuffer *ppDefaultBuffer,
+  VMAHandle *ppDefaultMem,
+  VkMemoryCategory category
+) {
+  VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+  bufferInfo.size = uByteSize;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | bufferUsage;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+
+  return CreateVmaBuffer(pDevice, &bufferInfo, &allocInfo, ppDefaultBuffer, ppDefaultMem, nullptr,
+                         category);
+}
+
 VKHRESULT CreateDefaultTexture(
   VkDevice pDevice,
   VkImageCreateInfo *pCreateInfo,
   VkImage *ppTexture,
-  VMAHandle *ppTextureMem
+  VMAHandle *ppTextureMem,
+  VkMemoryCategory category
 ) {
   VKHRESULT hr;
+  VkMemoryRequirements requirements;
 
   VmaAllocationCreateInfo allocInfo = {};
   allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-  allocInfo.flags = 0;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+
+  *ppTextureMem = nullptr;
+  V_RETURN(vkCreateImage(pDevice, pCreateInfo, nullptr, ppTexture));
+  vkGetImageMemoryRequirements(pDevice, *ppTexture, &requirements);
+  hr = ReserveVmaBudget(requirements.size, category);
+  if (VK_FAILED(hr)) {
+    vkDestroyImage(pDevice, *ppTexture, nullptr);
+    *ppTexture = VK_NULL_HANDLE;
+    return hr;
+  }
+
+  V(vmaAllocateMemoryForImage(g_pVmaAllocator, *ppTexture, &allocInfo,
+    (VmaAllocation *)ppTextureMem, nullptr));
+  if (VK_SUCCEEDED(hr))
+    V(vmaBindImageMemory(g_pVmaAllocator, (VmaAllocation)*ppTextureMem, *ppTexture));
+  if (VK_FAILED(hr)) {
+    ReleaseVmaBudget(requirements.size);
+    vmaDestroyImage(g_pVmaAllocator, *ppTexture, (VmaAllocation)*ppTextureMem);
+    *ppTexture = VK_NULL_HANDLE;
+    *ppTextureMem = nullptr;
+    return hr;
+  }
+  TrackVmaAllocation((VmaAllocation)*ppTextureMem, requirements.size, category);
 
-  V_RETURN(vmaCreateImage(g_pVmaAllocator, pCreateInfo, &allocInfo,
-    ppTexture, (VmaAllocation *)ppTextureMem, nullptr));
+  return hr;
+}
+
+VKHRESULT AllocateVmaMemory(
+  const VkMemoryRequirements *pRequirements,
+  bool bLazilyAllocated,
+  VMAHandle *ppMem,
+  _Out_opt_ bool *pbLazilyAllocated,
+  VkMemoryCategory category
+) {
+  VKHRESULT hr;
+  VmaAllocationCreateInfo allocInfo = {};
+
+  allocInfo.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+
+  hr = ReserveVmaBudget(pRequirements->size, category);
+  if (VK_FAILED(hr))
+    return hr;
+
+  hr = VK_ERROR_FEATURE_NOT_PRESENT;
+  if (bLazilyAllocated) {
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+    hr = vmaAllocateMemory(g_pVmaAllocator, pRequirements, &allocInfo, (VmaAllocation *)ppMem,
+      nullptr);
+  }
+  if (pbLazilyAllocated)
+    *pbLazilyAllocated = hr == VK_SUCCESS;
+  if (hr != VK_SUCCESS) {
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    V(vmaAllocateMemory(g_pVmaAllocator, pRequirements, &allocInfo, (VmaAllocation *)ppMem,
+      nullptr));
+    if (VK_FAILED(hr)) {
+      ReleaseVmaBudget(pRequirements->size);
+      return hr;
+    }
+  }
+  TrackVmaAllocation((VmaAllocation)*ppMem, pRequirements->size, category);
 
   return hr;
 }
 
+VkDeviceSize GetVmaCommittedBytes(
+  VkDevice pDevice,
+  VMAHandle pMem
+) {
+  VmaAllocationInfo info;
+  VkMemoryPropertyFlags flags = 0;
+  VkDeviceSize cbCommitted = 0;
+
+  if (!pMem)
+    return 0;
+
+  vmaGetAllocationInfo(g_pVmaAllocator, (VmaAllocation)pMem, &info);
+  vmaGetMemoryTypeProperties(g_pVmaAllocator, info.memoryType, &flags);
+  if (!(flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+    return info.size;
+
+  vkGetDeviceMemoryCommitment(pDevice, info.deviceMemory, &cbCommitted);
+  return std::min(cbCommitted, info.size);
+}
+
+VKHRESULT BindVmaImageMemory(
+  VMAHandle pMem,
+  VkDeviceSize uOffset,
+  VkImage pImage
+) {
+  return vmaBindImageMemory2(g_pVmaAllocator, (VmaAllocation)pMem, uOffset, pImage, nullptr);
+}
+
+VKHRESULT BindVmaBufferMemory(
+  VMAHandle pMem,
+  VkDeviceSize uOffset,
+  VkBuffer pBuffer
+) {
+  return vmaBindBufferMemory2(g_pVmaAllocator, (VmaAllocation)pMem, uOffset, pBuffer, nullptr);
+}
+
+void FreeVmaMemory(
+  VMAHandle pMem
+) {
+  if (pMem) {
+    UntrackVmaAllocation((VmaAllocation)pMem);
+    vmaFreeMemory(g_pVmaAllocator, (VmaAllocation)pMem);
+  }
+}
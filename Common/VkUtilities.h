@@ -2,6 +2,7 @@
 #define __VK_UTILITIES_H__
 
 #include <vulkan/vulkan.h>
+#include <vector>
 
 #include "Common.h"
 
@@ -75,19 +76,51 @@ VkShaderModule CreateShaderModule(
   size_t bytesLength
 );
 
+/// Reads the file only, safe on any thread.
+extern
+VKHRESULT LoadSPIRVFile(
+  const wchar_t *pFileName,
+  std::vector<uint32_t> *pCode
+);
+
 extern
 VkShaderModule CreateShaderModuleFromSPIRVFile(
   VkDevice pDevice,
   const wchar_t *pFileName
 );
 
+/// What an allocation is for, its bytes are summed per category.
+enum class VkMemoryCategory : uint32_t {
+  Attachments,
+  Textures,
+  Meshes,
+  Uniforms,
+  Staging,
+  Other,
+  Count
+};
+
+/// Usage of a memory heap against its budget, the whole process included when
+/// VK_EXT_memory_budget is enabled and an estimate from the allocations otherwise.
+struct VkMemoryHeapBudget {
+  uint64_t cbUsage;
+  uint64_t cbBudget;
+  /// Bytes of the allocations of this process, within its blocks.
+  uint64_t cbAllocated;
+  bool bDeviceLocal;
+};
+
 extern uint32_t GetVulkanApiVersion();
 
+///
+/// `bMemoryBudget` when VK_EXT_memory_budget is enabled on the device.
+///
 extern
 VKHRESULT InitializeVmaAllocator(
   VkInstance pInstance,
   VkPhysicalDevice pPhysicalDevice,
-  VkDevice pDevice
+  VkDevice pDevice,
+  bool bMemoryBudget = false
 );
 
 extern
@@ -96,6 +129,47 @@ void DestroyVmaAllocator();
 extern
 VMAHandle GetVmaAllocator();
 
+///
+/// Device memory currently used by allocations and reserved by VMA blocks.
+///
+extern
+void GetVmaMemoryUsage(
+  _Out_opt_ uint64_t *pcbUsed,
+  _Out_opt_ uint64_t *pcbReserved
+);
+
+extern const char *GetMemoryCategoryName(VkMemoryCategory category);
+
+///
+/// Fills at most `uMaxHeaps` heaps, returns the count of heaps of the device.
+///
+extern
+uint32_t GetVmaHeapBudgets(
+  _Out_opt_ VkMemoryHeapBudget *pHeaps,
+  uint32_t uMaxHeaps
+);
+
+///
+/// Bytes currently allocated per category, indexed by `VkMemoryCategory`.
+///
+extern
+void GetVmaCategoryUsage(
+  _Out_ uint64_t pcbCategories[(uint32_t)VkMemoryCategory::Count]
+);
+
+///
+/// Cap on the bytes of every category together, zero lifts it. Allocations past it fail with
+/// VK_ERROR_OUT_OF_DEVICE_MEMORY and a trace of what was asked for. Allocations never exceed the
+/// budget of their heap either way.
+///
+extern void SetVmaMemoryBudget(uint64_t cbBudget);
+extern uint64_t GetVmaMemoryBudget();
+
+///
+/// Trace the heaps against their budgets and the bytes of each category.
+///
+extern void LogVmaMemoryUsage();
+
 extern void DestroyVmaBuffer(
   VkBuffer pBuffer,
   VMAHandle pMem
@@ -116,7 +190,8 @@ VKHRESULT CreateDefaultBuffer(
   VkBuffer *ppUploadBuffer,
   VMAHandle *ppUploadMem,
   VkBuffer *ppDefaultBuffer,
-  VMAHandle *ppDefaultMem
+  VMAHandle *ppDefaultMem,
+  VkMemoryCategory category = VkMemoryCategory::Other
 );
 
 extern uint32_t CalcUniformBufferByteSize(uint32_t uByteSize);
@@ -132,7 +207,21 @@ VKHRESULT CreateUploadBuffer(
   VkBufferUsageFlags bufferUsage,
   VkBuffer *ppUploadBuffer,
   VMAHandle *ppUploadMem,
-  _Out_opt_ void **ppMappedData
+  _Out_opt_ void **ppMappedData,
+  VkMemoryCategory category = VkMemoryCategory::Staging
+);
+
+///
+/// Device local buffer, filled by transfers.
+///
+extern
+VKHRESULT CreateDeviceBuffer(
+  VkDevice pDevice,
+  size_t uByteSize,
+  VkBufferUsageFlags bufferUsage,
+  VkBuffer *ppDefaultBuffer,
+  VMAHandle *ppDefaultMem,
+  VkMemoryCategory category = VkMemoryCategory::Other
 );
 
 extern
@@ -140,8 +229,50 @@ VKHRESULT CreateDefaultTexture(
   VkDevice pDevice,
   VkImageCreateInfo *pCreateInfo,
   VkImage *ppTexture,
-  VMAHandle *ppTextureMem
+  VMAHandle *ppTextureMem,
+  VkMemoryCategory category = VkMemoryCategory::Textures
 );
 
+///
+/// A memory block of its own, for resources bound at offsets within it. Lazily allocated memory,
+/// when asked for and offered by the device, is only committed as far as the tiles require, and
+/// only suits transient attachments. Falls back to device local memory otherwise.
+///
+extern
+VKHRESULT AllocateVmaMemory(
+  const VkMemoryRequirements *pRequirements,
+  bool bLazilyAllocated,
+  VMAHandle *ppMem,
+  _Out_opt_ bool *pbLazilyAllocated,
+  VkMemoryCategory category = VkMemoryCategory::Attachments
+);
+
+///
+/// Bytes of the allocation backed by memory, fewer than its size only for lazily allocated memory
+/// the device did not need to commit. Approximate when the allocation shares its memory block.
+///
+extern
+VkDeviceSize GetVmaCommittedBytes(
+  VkDevice pDevice,
+  VMAHandle pMem
+);
+
+extern
+VKHRESULT BindVmaImageMemory(
+  VMAHandle pMem,
+  VkDeviceSize uOffset,
+  VkImage pImage
+);
+
+extern
+VKHRESULT BindVmaBufferMemory(
+  VMAHandle pMem,
+  VkDeviceSize uOffset,
+  VkBuffer pBuffer
+);
+
+extern void FreeVmaMemory(
+  VMAHandle pMem
+);
 
 #endif/* __VK_UTILITIES_H__ */
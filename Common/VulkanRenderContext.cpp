@@ -7,7 +7,9 @@
 #include <vulkan/vk_sdk_platform.h>
 #include <vulkan/vulkan_win32.h>
 #endif
+#include <cctype>
 #include <sstream>
+#include <thread>
 
 #undef min
 #undef max
@@ -19,26 +21,96 @@ DebugMessageCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
 
 static const char *s_aValidationLayerNames[] = {"VK_LAYER_KHRONOS_validation"};
 
+/// Only when presenting to a window.
+static const char *const s_aSurfaceInstanceExtensions[] = {
+    VK_KHR_SURFACE_EXTENSION_NAME,
+#ifdef _WIN32
+    VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+#endif
+};
 static const char *const s_aDeviceExtensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+/// Optional, bound the queued presents by the display instead of the GPU.
+static const char *const s_aPresentWaitExtensions[] = {VK_KHR_PRESENT_ID_EXTENSION_NAME,
+                                                       VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
+/// Optional, cull mode and depth state are set per draw rather than baked into the pipelines.
+static const char *const s_aExtendedDynamicStateExtensions[] = {
+    VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME};
+/// Optional, upload barriers keep per resource stages.
+static const char *const s_aSynchronization2Extensions[] = {
+    VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME};
+/// Optional, heap budgets and usage of the whole process come from the driver.
+static const char *const s_aMemoryBudgetExtensions[] = {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME};
+/// Optional, timestamps of the async compute family share the device time domain of the
+/// graphics ones.
+static const char *const s_aCalibratedTimestampsExtensions[] = {
+    VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME};
+/// Nanoseconds, a present may never complete while the window is hidden.
+static const uint64_t s_uPresentWaitTimeout = 100000000;
+/// Presents to newer swap chains whose frames complete before an old one is destroyed, when
+/// its own presents can't be waited for.
+static const uint32_t s_uOldSwapChainReleasePresents = 2;
 
 VulkanRenderContext::VulkanRenderContext()
     : m_iClientWidth(800), m_iClientHeight(600), m_pVkInstance(VK_NULL_HANDLE),
       m_pDebugMessenger(VK_NULL_HANDLE), m_pPhysicalDevice(VK_NULL_HANDLE),
       m_pDevice(VK_NULL_HANDLE), m_iGraphicQueueFamilyIndex(-1), m_iPresentQueueFamilyIndex(-1),
-      m_pGraphicQueue(VK_NULL_HANDLE), m_pPresentQueue(VK_NULL_HANDLE),
+      m_iTransferQueueFamilyIndex(-1), m_pGraphicQueue(VK_NULL_HANDLE),
+      m_pPresentQueue(VK_NULL_HANDLE), m_pTransferQueue(VK_NULL_HANDLE),
       m_pCommandPool(VK_NULL_HANDLE), m_iCurrRendererItem(0), m_iCurrSwapChainItem(0),
-      m_pWndSurface(VK_NULL_HANDLE), m_iSwapChainImageCount(0),
+      m_pWndSurface(VK_NULL_HANDLE), m_pSwapChain(VK_NULL_HANDLE), m_iSwapChainImageCount(0),
       m_pSwapChainFBsCompatibleRenderPass(VK_NULL_HANDLE), m_pMsaaColorBuffer(VK_NULL_HANDLE),
-      m_pMsaaColorBufferMem(VK_NULL_HANDLE), m_pMsaaColorView(VK_NULL_HANDLE),
-      m_pDepthStencilImage(VK_NULL_HANDLE), m_pDepthStencilBufferMem(VK_NULL_HANDLE),
+      m_pMsaaColorView(VK_NULL_HANDLE), m_pDepthStencilImage(VK_NULL_HANDLE),
       m_pDepthStencilImageView(VK_NULL_HANDLE) {
   m_aDeviceConfig.VsyncEnabled = (FALSE);
   m_aDeviceConfig.MsaaSampleCount = 1;
   m_aDeviceConfig.MsaaQaulityLevel = 0;
   m_aDeviceConfig.MsaaEnabled = FALSE;
-
-  memset(m_aRendererItemCtx, 0, sizeof(m_aRendererItemCtx));
-  memset(m_aSwapChainItemCtx, 0, sizeof(m_aSwapChainItemCtx));
+  m_aDeviceConfig.FramesInFlight = 2;
+  m_aDeviceConfig.HeadlessEnabled = FALSE;
+  m_aDeviceConfig.AsyncComputeEnabled = FALSE;
+  m_aDeviceConfig.PipelineStatisticsEnabled = FALSE;
+  m_aDeviceConfig.InheritedQueriesEnabled = FALSE;
+  m_aDeviceConfig.RecordThreadCount = 1;
+  m_aDeviceConfig.DrawCount = 1;
+  m_aDeviceConfig.StartupThreadCount = 0;
+  m_aDeviceConfig.StaticCommandsEnabled = FALSE;
+  m_uStaticGeneration = 1;
+  m_PipelineCacheFileName = "PipelineCache.bin";
+  m_DeviceCaps = {};
+
+  m_iComputeQueueFamilyIndex = -1;
+  m_pComputeQueue = VK_NULL_HANDLE;
+  m_pComputeCommandPool = VK_NULL_HANDLE;
+  m_pFrameTimestampQueryPool = VK_NULL_HANDLE;
+  m_fTimestampPeriod = 1.0f;
+  m_AsyncComputeTimings = {};
+  m_aSwapChainExtent = {};
+  m_bSwapChainDirty = false;
+  m_bRenderPassDirty = false;
+  m_aDeviceConfig.PresentLatency = PresentLatencyPolicy::Throughput;
+  m_aDeviceConfig.PresentWaitEnabled = FALSE;
+  m_aDeviceConfig.ExtendedDynamicStateEnabled = FALSE;
+  m_pfnCmdSetCullModeEXT = nullptr;
+  m_pfnCmdSetFrontFaceEXT = nullptr;
+  m_pfnCmdSetDepthTestEnableEXT = nullptr;
+  m_pfnCmdSetDepthWriteEnableEXT = nullptr;
+  m_pfnCmdSetDepthCompareOpEXT = nullptr;
+  m_aDeviceConfig.Synchronization2Enabled = FALSE;
+  m_pfnCmdPipelineBarrier2KHR = nullptr;
+  m_aDeviceConfig.MemoryBudgetEnabled = FALSE;
+  m_aDeviceConfig.CalibratedTimestampsEnabled = FALSE;
+  m_pfnGetCalibratedTimestampsEXT = nullptr;
+  m_bQueueTimestampsComparable = false;
+  m_aDeviceConfig.MemoryLogInterval = 0;
+  m_uMemoryLogFrame = 0;
+  m_pfnWaitForPresentKHR = nullptr;
+  m_uLastPresentId = 0;
+  m_uSwapChainLastPresentId = 0;
+  m_InputSampledTime = -1.0;
+  m_FrameStartTime = 0.0;
+  m_FrameStalls = {};
+  m_LastPresentTime = -1.0;
+  m_PresentLatency = {};
 }
 
 VulkanRenderContext::~VulkanRenderContext() {}
@@ -57,6 +129,20 @@ VKHRESULT VulkanRenderContext::Destroy() {
   return 0;
 }
 
+VKHRESULT VulkanRenderContext::WaitIdle() {
+  VKHRESULT hr;
+
+  V_RETURN(vkDeviceWaitIdle(m_pDevice));
+
+  /// The frames in flight are complete, their statistics need not wait for the slots' reuse.
+  for (auto &rendererContext : m_aRendererItemCtx)
+    ResolveFrame(&rendererContext);
+  while (!m_aQueuedPresents.empty() && RetireQueuedPresent(m_aQueuedPresents.front(), true))
+    m_aQueuedPresents.pop_front();
+
+  return hr;
+}
+
 VKHRESULT VulkanRenderContext::InitVulkan() {
 
   VKHRESULT hr;
@@ -69,12 +155,42 @@ VKHRESULT VulkanRenderContext::InitVulkan() {
 
   V_RETURN(CreateLogicalDevice());
 
-  V_RETURN(InitializeVmaAllocator(m_pVkInstance, m_pPhysicalDevice, m_pDevice));
+  V_RETURN(InitializeVmaAllocator(m_pVkInstance, m_pPhysicalDevice, m_pDevice,
+                                  m_aDeviceConfig.MemoryBudgetEnabled));
+
+  V_RETURN(m_PipelineCache.Create(m_pDevice, m_pPhysicalDevice, m_PipelineCacheFileName.c_str()));
+  /// Half the cores, the other half keeps recording frames.
+  V_RETURN(m_PipelineCompiler.Create(
+      m_pDevice, &m_PipelineCache,
+      std::max(1u, std::min(std::thread::hardware_concurrency() / 2,
+                            (uint32_t)VK_MAX_COMPILE_THREADS))));
+
+  V_RETURN(m_GraphicsTimeline.Create(m_pDevice));
+  if (m_pComputeQueue)
+    V_RETURN(m_ComputeTimeline.Create(m_pDevice));
 
   V_RETURN(CreateGraphicsQueueCommandPool());
 
+  V_RETURN(m_UploadContext.Create(m_pDevice, m_iTransferQueueFamilyIndex, m_pTransferQueue,
+                                  m_iGraphicQueueFamilyIndex, m_pGraphicQueue,
+                                  &m_GraphicsTimeline, VK_STAGING_BLOCK_BYTES,
+                                  VK_STAGING_BUDGET_BYTES, m_pfnCmdPipelineBarrier2KHR));
+
   V_RETURN(CreateGraphicsQueueCommandBuffers());
 
+  V_RETURN(CreateAsyncComputeObjects());
+
+  V_RETURN(m_ParallelRecorder.Create(m_pDevice, m_iGraphicQueueFamilyIndex, GetFrameCount(),
+                                     m_aDeviceConfig.RecordThreadCount));
+
+  V_RETURN(m_GpuProfiler.Create(m_pDevice, m_pPhysicalDevice, m_iGraphicQueueFamilyIndex,
+                                GetFrameCount(), m_aDeviceConfig.PipelineStatisticsEnabled));
+  m_FrameStats.Create();
+  V_RETURN(m_RenderGraph.Create(m_pDevice, GetFrameCount(), m_DeviceCaps.LazilyAllocatedMemory));
+  V_RETURN(m_FrameUniforms.Create(m_pDevice, GetFrameCount(), VK_FRAME_UNIFORM_BYTES,
+                                  VK_FRAME_UNIFORM_MAX_RANGE));
+  V_RETURN(m_GeometryPool.Create(m_pDevice, VK_GEOMETRY_VERTEX_BYTES, VK_GEOMETRY_INDEX_BYTES));
+
   m_iSwapChainImageCount = CalcSwapChainBackBufferCount();
 
   V_RETURN(CreateSwapChain());
@@ -103,22 +219,27 @@ VKHRESULT VulkanRenderContext::CreateVkInstance(const char *pAppName) {
   std::vector<VkExtensionProperties> extensions;
   std::vector<const char *> extensionNames;
 
+  /// Every enabled extension is loaded and initialized by the loader and the layers, enabling all
+  /// of the available ones costs startup time for nothing.
+  if (!IsHeadless())
+    extensionNames.assign(s_aSurfaceInstanceExtensions,
+                          s_aSurfaceInstanceExtensions + _countof(s_aSurfaceInstanceExtensions));
+#ifdef _DEBUG
+  extensionNames.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#endif
+
   V_RETURN(vkEnumerateInstanceExtensionProperties(NULL, &extCount, NULL));
   extensions.resize(extCount);
   V_RETURN(vkEnumerateInstanceExtensionProperties(NULL, &extCount, extensions.data()));
-  for (auto &ext : extensions) {
-    extensionNames.push_back(ext.extensionName);
+  for (auto pszName : extensionNames) {
+    if (std::none_of(extensions.begin(), extensions.end(), [pszName](const auto &ext) {
+          return strcmp(ext.extensionName, pszName) == 0;
+        }))
+      VK_TRACE("WARNING: Instance extension %s is not available.\n", pszName);
   }
 
-#ifdef _DEBUG
-  extensionNames.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-
-  createInfo.enabledExtensionCount = (uint32_t)extensionNames.size();
-  createInfo.ppEnabledExtensionNames = extensionNames.data();
-#else
   createInfo.enabledExtensionCount = (uint32_t)extensionNames.size();
   createInfo.ppEnabledExtensionNames = extensionNames.data();
-#endif
 
 #ifdef _DEBUG
   hr = CheckValidationLayerSupport(s_aValidationLayerNames, _countof(s_aValidationLayerNames));
@@ -183,29 +304,46 @@ VKHRESULT VulkanRenderContext::CheckValidationLayerSupport(const char **ppValida
 
 void VulkanRenderContext::Cleanup() {
 
-  HRESULT hr;
+  VKHRESULT hr;
   PFN_vkDestroySurfaceKHR vkDestroySurfaceKHR = nullptr;
   uint32_t i;
 
-  for (i = 0; i < m_iSwapChainImageCount; ++i) {
-    vkDestroySemaphore(m_pDevice, m_aSwapChainItemCtx[i].pImageAvailableSem, nullptr);
-  }
-
   CleanupSwapChain();
 
-  for (i = 0; i < _countof(m_aRendererItemCtx); ++i) {
+  m_UploadContext.Destroy();
+
+  for (i = 0; i < (uint32_t)m_aRendererItemCtx.size(); ++i) {
+    vkDestroySemaphore(m_pDevice, m_aRendererItemCtx[i].pImageAvailableSem, nullptr);
     vkDestroySemaphore(m_pDevice, m_aRendererItemCtx[i].pRenderFinishedSem, nullptr);
-    vkDestroyFence(m_pDevice, m_aRendererItemCtx[i].pCmdBufferInFightFence, nullptr);
+    vkDestroyCommandPool(m_pDevice, m_aRendererItemCtx[i].pCommandPool, nullptr);
   }
-
+  m_aRendererItemCtx.clear();
+  m_aQueuedPresents.clear();
+
+  /// Runs the pending retirements as well.
+  m_ComputeTimeline.Destroy();
+  m_GraphicsTimeline.Destroy();
+
+  m_RenderGraph.Destroy();
+  m_FrameUniforms.Destroy();
+  m_GeometryPool.Destroy();
+  m_GpuProfiler.Destroy();
+  m_FrameStats.Destroy();
+  m_ParallelRecorder.Destroy();
+  m_PipelineCompiler.Destroy();
+  m_PipelineCache.Destroy();
+  vkDestroyQueryPool(m_pDevice, m_pFrameTimestampQueryPool, nullptr);
+  vkDestroyCommandPool(m_pDevice, m_pComputeCommandPool, nullptr);
   vkDestroyCommandPool(m_pDevice, m_pCommandPool, nullptr);
 
-  vkDestroySurfaceKHR =
-      (PFN_vkDestroySurfaceKHR)vkGetInstanceProcAddr(m_pVkInstance, "vkDestroySurfaceKHR");
-  if (vkDestroySurfaceKHR) {
-    vkDestroySurfaceKHR(m_pVkInstance, m_pWndSurface, nullptr);
-  } else {
-    V(-1);
+  if (m_pWndSurface) {
+    vkDestroySurfaceKHR =
+        (PFN_vkDestroySurfaceKHR)vkGetInstanceProcAddr(m_pVkInstance, "vkDestroySurfaceKHR");
+    if (vkDestroySurfaceKHR) {
+      vkDestroySurfaceKHR(m_pVkInstance, m_pWndSurface, nullptr);
+    } else {
+      V(-1);
+    }
   }
 
 #ifdef _DEBUG
@@ -256,6 +394,11 @@ VKHRESULT VulkanRenderContext::PickPhysicalDevice() {
   VKHRESULT hr;
   uint32_t deviceCount = 0;
   uint32_t uMaxMsaaQuality;
+  uint32_t i;
+  std::string preferred = m_PreferredDevice, name;
+  bool bPreferIndex, bMatch, bBestMatch = false;
+  int iBest = -1;
+  PhysicalDeviceCaps caps, bestCaps = {};
 
   V_RETURN(vkEnumeratePhysicalDevices(m_pVkInstance, &deviceCount, nullptr));
   if (deviceCount == 0) {
@@ -265,33 +408,70 @@ VKHRESULT VulkanRenderContext::PickPhysicalDevice() {
   std::vector<VkPhysicalDevice> devices(deviceCount);
   vkEnumeratePhysicalDevices(m_pVkInstance, &deviceCount, devices.data());
 
-  for (auto &device : devices) {
-    if (IsDeviceSuitable(device)) {
-      m_pPhysicalDevice = device;
-
-      CheckMultisampleSupport(device, &uMaxMsaaQuality);
-      m_aDeviceConfig.MsaaSampleCount = uMaxMsaaQuality;
-      m_aDeviceConfig.MsaaQaulityLevel =
-          std::min(uMaxMsaaQuality, m_aDeviceConfig.MsaaQaulityLevel);
-
-      break;
+  std::transform(preferred.begin(), preferred.end(), preferred.begin(),
+                 [](char c) { return (char)std::tolower((unsigned char)c); });
+  bPreferIndex = !preferred.empty() && std::all_of(preferred.begin(), preferred.end(), [](char c) {
+    return std::isdigit((unsigned char)c) != 0;
+  });
+
+  for (i = 0; i < deviceCount; ++i) {
+    caps = {};
+    caps.DeviceIndex = i;
+    if (!IsDeviceSuitable(devices[i])) {
+      VkPhysicalDeviceProperties properties;
+      vkGetPhysicalDeviceProperties(devices[i], &properties);
+      VK_TRACE("Device %u: %s, unsuitable.\n", i, properties.deviceName);
+      continue;
+    }
+    caps.Score = ScoreDevice(devices[i], &caps);
+
+    name = caps.DeviceName;
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](char c) { return (char)std::tolower((unsigned char)c); });
+    bMatch = !preferred.empty() && (bPreferIndex ? (uint32_t)atoi(preferred.c_str()) == i
+                                                 : name.find(preferred) != std::string::npos);
+    VK_TRACE("Device %u: %s, score %lld%s.\n", i, caps.DeviceName, (long long)caps.Score,
+             bMatch ? ", preferred" : "");
+
+    /// A preferred device beats any score, the first of several preferred ones wins.
+    if (iBest < 0 || (bMatch && !bBestMatch) ||
+        (!bMatch && !bBestMatch && caps.Score > bestCaps.Score)) {
+      iBest = (int)i;
+      bBestMatch = bMatch;
+      bestCaps = caps;
     }
   }
-  if (m_pPhysicalDevice == VK_NULL_HANDLE) {
+  if (iBest < 0) {
     V_RETURN(-1);
   }
+  if (!preferred.empty() && !bBestMatch)
+    VK_TRACE("No suitable device matches \"%s\", picked by the score.\n",
+             m_PreferredDevice.c_str());
+
+  m_pPhysicalDevice = devices[iBest];
+  m_DeviceCaps = bestCaps;
+  m_DeviceCaps.Forced = bBestMatch;
+  /// Restores the queue families, the later candidates have overwritten them.
+  IsDeviceSuitable(m_pPhysicalDevice);
+
+  CheckMultisampleSupport(m_pPhysicalDevice, &uMaxMsaaQuality);
+  m_aDeviceConfig.MsaaSampleCount = uMaxMsaaQuality;
+  m_aDeviceConfig.MsaaQaulityLevel = std::min(uMaxMsaaQuality, m_aDeviceConfig.MsaaQaulityLevel);
 
   return hr;
 }
 
 bool VulkanRenderContext::IsDeviceSuitable(VkPhysicalDevice device) {
-  HRESULT hr;
+  VKHRESULT hr;
   // VkPhysicalDeviceRayTracingPropertiesNV rtxProperties = {
   //     VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PROPERTIES_NV};
   // VkPhysicalDeviceProperties2 deviceProperties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
   //                                                 &rtxProperties};
   VkPhysicalDeviceProperties2 deviceProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, nullptr };
-  VkPhysicalDeviceFeatures deviceFeatures;
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  VkPhysicalDeviceFeatures2 deviceFeatures2 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                               &vulkan12Features};
   std::vector<VkQueueFamilyProperties> queueFamilyProperties;
   uint32_t queueFamilyCount = 0;
   int i;
@@ -302,7 +482,13 @@ bool VulkanRenderContext::IsDeviceSuitable(VkPhysicalDevice device) {
 
   deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
   vkGetPhysicalDeviceProperties2(device, &deviceProperties);
-  vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+  /// Frame pacing is built on timeline semaphores.
+  if (deviceProperties.properties.apiVersion < VK_API_VERSION_1_2)
+    return false;
+  vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+  if (!vulkan12Features.timelineSemaphore)
+    return false;
 
   /// Check queue capabilites.
   vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, NULL);
@@ -314,6 +500,10 @@ bool VulkanRenderContext::IsDeviceSuitable(VkPhysicalDevice device) {
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
 
   for (auto &reqExt : s_aDeviceExtensions) {
+    /// Nothing is presented in headless mode.
+    if (IsHeadless())
+      break;
+
     reqExtExist = false;
     for (auto &extension : extensions) {
       if (_stricmp(extension.extensionName, reqExt) == 0) {
@@ -327,26 +517,129 @@ bool VulkanRenderContext::IsDeviceSuitable(VkPhysicalDevice device) {
     }
   }
 
+  /// A previous candidate may have left its families behind.
+  m_iGraphicQueueFamilyIndex = -1;
+  m_iPresentQueueFamilyIndex = -1;
   i = 0;
   for (auto &queueProperty : queueFamilyProperties) {
-    if (m_iGraphicQueueFamilyIndex < 0) {
-      if (queueProperty.queueCount > 0 && (queueProperty.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
-        m_iGraphicQueueFamilyIndex = i;
-      }
-    }
-    if (m_iPresentQueueFamilyIndex < 0) {
+    bool bGraphics =
+        queueProperty.queueCount > 0 && (queueProperty.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+
+    presentSupport = VK_FALSE;
+    if (!IsHeadless()) {
       /// Check surface capacity.
       V(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_pWndSurface, &presentSupport));
-      if (presentSupport) {
-        m_iPresentQueueFamilyIndex = i;
-      }
     }
+    /// A family doing both spares the swap chain images the ownership transfers.
+    if (bGraphics && presentSupport &&
+        (m_iGraphicQueueFamilyIndex < 0 ||
+         m_iGraphicQueueFamilyIndex != m_iPresentQueueFamilyIndex)) {
+      m_iGraphicQueueFamilyIndex = i;
+      m_iPresentQueueFamilyIndex = i;
+    }
+    if (bGraphics && m_iGraphicQueueFamilyIndex < 0)
+      m_iGraphicQueueFamilyIndex = i;
+    if (presentSupport && m_iPresentQueueFamilyIndex < 0)
+      m_iPresentQueueFamilyIndex = i;
     ++i;
   }
 
-  return deviceProperties.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-         deviceFeatures.geometryShader && (m_iGraphicQueueFamilyIndex >= 0) &&
-         (m_iPresentQueueFamilyIndex >= 0);
+  if (IsHeadless()) {
+    /// Offscreen images are "presented" on the graphics queue.
+    m_iPresentQueueFamilyIndex = m_iGraphicQueueFamilyIndex;
+    return m_iGraphicQueueFamilyIndex >= 0;
+  }
+
+  /// Integrated GPUs and software rasterizers such as lavapipe are ranked by `ScoreDevice`.
+  return (m_iGraphicQueueFamilyIndex >= 0) && (m_iPresentQueueFamilyIndex >= 0);
+}
+
+int64_t VulkanRenderContext::ScoreDevice(VkPhysicalDevice device, PhysicalDeviceCaps *pCaps) {
+  VkPhysicalDeviceProperties properties;
+  VkPhysicalDeviceFeatures features;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties;
+  uint32_t queueFamilyCount = 0;
+  uint32_t i, uDeviceLocalHeapCount = 0;
+  VkSampleCountFlags sampleCounts;
+  int64_t score;
+
+  vkGetPhysicalDeviceProperties(device, &properties);
+  vkGetPhysicalDeviceFeatures(device, &features);
+  vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, NULL);
+  queueFamilyProperties.resize(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyProperties.data());
+
+  memcpy(pCaps->DeviceName, properties.deviceName, sizeof(pCaps->DeviceName));
+  pCaps->DeviceType = properties.deviceType;
+
+  /// Every other term together stays below the step between two types.
+  switch (properties.deviceType) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    score = 4000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    score = 3000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    score = 2000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    score = 1000;
+    break;
+  default:
+    score = 0;
+    break;
+  }
+
+  /// Up to 256 for 16 GiB of device local memory.
+  pCaps->DeviceLocalBytes = 0;
+  for (i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+    if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      pCaps->DeviceLocalBytes =
+          std::max(pCaps->DeviceLocalBytes, memoryProperties.memoryHeaps[i].size);
+      ++uDeviceLocalHeapCount;
+    }
+  }
+  score += 4 * (int64_t)std::min<VkDeviceSize>(pCaps->DeviceLocalBytes >> 28, 64);
+  pCaps->UnifiedMemory = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+                         properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU ||
+                         uDeviceLocalHeapCount == memoryProperties.memoryHeapCount;
+
+  /// Copies and compute work running alongside the graphics queue.
+  pCaps->DedicatedTransferQueue = false;
+  pCaps->DedicatedComputeQueue = false;
+  for (auto &queueProperty : queueFamilyProperties) {
+    if (queueProperty.queueCount == 0 || (queueProperty.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+      continue;
+    if (queueProperty.queueFlags & VK_QUEUE_COMPUTE_BIT)
+      pCaps->DedicatedComputeQueue = true;
+    else if (queueProperty.queueFlags & VK_QUEUE_TRANSFER_BIT)
+      pCaps->DedicatedTransferQueue = true;
+  }
+  score += pCaps->DedicatedTransferQueue ? 64 : 0;
+  score += pCaps->DedicatedComputeQueue ? 64 : 0;
+
+  /// Tilers keep transient attachments on chip, lazily allocated memory is never committed.
+  pCaps->LazilyAllocatedMemory = false;
+  for (i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+    if (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+      pCaps->LazilyAllocatedMemory = true;
+  }
+
+  /// The optional features the context makes use of, and up to 96 for 64x MSAA.
+  score += features.pipelineStatisticsQuery ? 16 : 0;
+  score += features.inheritedQueries ? 16 : 0;
+  score += features.samplerAnisotropy ? 16 : 0;
+  sampleCounts = properties.limits.framebufferColorSampleCounts &
+                 properties.limits.framebufferDepthSampleCounts;
+  for (i = 1; i < 7; ++i) {
+    if (sampleCounts & (1u << i))
+      score += 16;
+  }
+
+  return score;
 }
 
 bool VulkanRenderContext::CheckMultisampleSupport(VkPhysicalDevice,
@@ -365,35 +658,201 @@ bool VulkanRenderContext::CheckMultisampleSupport(VkPhysicalDevice,
 }
 
 VKHRESULT VulkanRenderContext::CreateLogicalDevice() {
-  VkDeviceQueueCreateInfo queueCreateInfo[2] = {};
-  uint32_t queueFamilyCount = _countof(queueCreateInfo);
+  std::vector<VkDeviceQueueCreateInfo> queueCreateInfo;
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties;
+  uint32_t queueFamilyCount = 0;
+  int aQueueFamilies[4];
+  uint32_t i, j;
   VKHRESULT hr;
   float priority = 1.0f;
   VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR, &presentIdFeatures};
+  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT};
+  VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR};
+  VkPhysicalDeviceFeatures2 deviceFeatures2 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+  std::vector<VkExtensionProperties> extensions;
+  std::vector<const char *> aExtensionNames;
+  uint32_t extensionCount = 0;
+  bool bPresentWaitSupported, bExtendedDynamicStateSupported, bSynchronization2Supported;
+  bool bMemoryBudgetSupported, bCalibratedTimestampsSupported;
   VkDeviceCreateInfo createInfo = {};
 
-  if (m_iGraphicQueueFamilyIndex == m_iPresentQueueFamilyIndex)
-    queueFamilyCount = 1;
+  /// Prefer a transfer only queue family, it's usually backed by the DMA engines and copies
+  /// run alongside the graphics work. Not with unified memory, there is no bus to copy over and
+  /// the queue would only add the ownership transfers.
+  vkGetPhysicalDeviceQueueFamilyProperties(m_pPhysicalDevice, &queueFamilyCount, NULL);
+  queueFamilyProperties.resize(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(m_pPhysicalDevice, &queueFamilyCount,
+                                           queueFamilyProperties.data());
+
+  m_iTransferQueueFamilyIndex = m_iGraphicQueueFamilyIndex;
+  for (i = 0; i < queueFamilyCount && !m_DeviceCaps.UnifiedMemory; ++i) {
+    if (queueFamilyProperties[i].queueCount > 0 &&
+        (queueFamilyProperties[i].queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+        !(queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      m_iTransferQueueFamilyIndex = (int)i;
+      break;
+    }
+  }
+
+  /// Likewise a compute family without graphics, it's served by the async compute engines.
+  m_iComputeQueueFamilyIndex = m_iGraphicQueueFamilyIndex;
+  for (i = 0; i < queueFamilyCount && m_aDeviceConfig.AsyncComputeEnabled; ++i) {
+    if (queueFamilyProperties[i].queueCount > 0 &&
+        (queueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+        !(queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+      m_iComputeQueueFamilyIndex = (int)i;
+      break;
+    }
+  }
+
+  /// One queue per unique family.
+  aQueueFamilies[0] = m_iGraphicQueueFamilyIndex;
+  aQueueFamilies[1] = m_iPresentQueueFamilyIndex;
+  aQueueFamilies[2] = m_iTransferQueueFamilyIndex;
+  aQueueFamilies[3] = m_iComputeQueueFamilyIndex;
+  for (i = 0; i < _countof(aQueueFamilies); ++i) {
+    for (j = 0; j < i; ++j) {
+      if (aQueueFamilies[j] == aQueueFamilies[i])
+        break;
+    }
+    if (j < i)
+      continue;
+
+    VkDeviceQueueCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    info.queueFamilyIndex = aQueueFamilies[i];
+    info.queueCount = 1;
+    info.pQueuePriorities = &priority;
+    queueCreateInfo.push_back(info);
+  }
+
+  vulkan12Features.timelineSemaphore = VK_TRUE;
+
+  /// Optional, lets the GPU profiler count the work of each pass.
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(m_pPhysicalDevice, &supportedFeatures);
+  physicalDeviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+  m_aDeviceConfig.PipelineStatisticsEnabled = !!supportedFeatures.pipelineStatisticsQuery;
+  /// Lets profiler scopes of the primary command buffer enclose the secondary ones.
+  physicalDeviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+  m_aDeviceConfig.InheritedQueriesEnabled = !!supportedFeatures.inheritedQueries;
 
-  /// Graphic Pipeline Queue.
-  queueCreateInfo[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-  queueCreateInfo[0].queueFamilyIndex = m_iGraphicQueueFamilyIndex;
-  queueCreateInfo[0].queueCount = 1;
-  queueCreateInfo[0].pQueuePriorities = &priority;
+  vkEnumerateDeviceExtensionProperties(m_pPhysicalDevice, nullptr, &extensionCount, nullptr);
+  extensions.resize(extensionCount);
+  vkEnumerateDeviceExtensionProperties(m_pPhysicalDevice, nullptr, &extensionCount,
+                                       extensions.data());
+  auto fnIsSupported = [&extensions](const char *const *ppNames, uint32_t uCount) {
+    uint32_t uFound = 0;
+    for (uint32_t k = 0; k < uCount; ++k) {
+      for (auto &extension : extensions) {
+        if (_stricmp(extension.extensionName, ppNames[k]) == 0) {
+          ++uFound;
+          break;
+        }
+      }
+    }
+    return uFound == uCount;
+  };
 
-  if (queueFamilyCount == 2) {
-    queueCreateInfo[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo[1].queueFamilyIndex = m_iPresentQueueFamilyIndex;
-    queueCreateInfo[1].queueCount = 1;
-    queueCreateInfo[1].pQueuePriorities = &priority;
+  if (!IsHeadless())
+    aExtensionNames.assign(s_aDeviceExtensions,
+                           s_aDeviceExtensions + _countof(s_aDeviceExtensions));
+
+  /// Only the features of supported extensions are queried.
+  bPresentWaitSupported =
+      !IsHeadless() && fnIsSupported(s_aPresentWaitExtensions, _countof(s_aPresentWaitExtensions));
+  bExtendedDynamicStateSupported = fnIsSupported(s_aExtendedDynamicStateExtensions,
+                                                 _countof(s_aExtendedDynamicStateExtensions));
+  bSynchronization2Supported =
+      fnIsSupported(s_aSynchronization2Extensions, _countof(s_aSynchronization2Extensions));
+  bMemoryBudgetSupported =
+      fnIsSupported(s_aMemoryBudgetExtensions, _countof(s_aMemoryBudgetExtensions));
+  /// Only needed to compare the timestamps of a dedicated compute family, and only when the
+  /// device time domain is among the calibrateable ones.
+  bCalibratedTimestampsSupported =
+      m_iComputeQueueFamilyIndex != m_iGraphicQueueFamilyIndex &&
+      fnIsSupported(s_aCalibratedTimestampsExtensions, _countof(s_aCalibratedTimestampsExtensions));
+  if (bCalibratedTimestampsSupported) {
+    auto pfnGetTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)
+        vkGetInstanceProcAddr(m_pVkInstance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+    std::vector<VkTimeDomainEXT> aTimeDomains;
+    uint32_t uTimeDomainCount = 0;
+
+    if (pfnGetTimeDomains) {
+      pfnGetTimeDomains(m_pPhysicalDevice, &uTimeDomainCount, nullptr);
+      aTimeDomains.resize(uTimeDomainCount);
+      pfnGetTimeDomains(m_pPhysicalDevice, &uTimeDomainCount, aTimeDomains.data());
+    }
+    bCalibratedTimestampsSupported =
+        std::find(aTimeDomains.begin(), aTimeDomains.end(), VK_TIME_DOMAIN_DEVICE_EXT) !=
+        aTimeDomains.end();
+  }
+  if (bPresentWaitSupported) {
+    presentIdFeatures.pNext = deviceFeatures2.pNext;
+    deviceFeatures2.pNext = &presentWaitFeatures;
+  }
+  if (bExtendedDynamicStateSupported) {
+    extendedDynamicStateFeatures.pNext = deviceFeatures2.pNext;
+    deviceFeatures2.pNext = &extendedDynamicStateFeatures;
+  }
+  if (bSynchronization2Supported) {
+    synchronization2Features.pNext = deviceFeatures2.pNext;
+    deviceFeatures2.pNext = &synchronization2Features;
+  }
+  if (deviceFeatures2.pNext)
+    vkGetPhysicalDeviceFeatures2(m_pPhysicalDevice, &deviceFeatures2);
+
+  /// Chain the enabled ones behind the 1.2 features.
+  if (bPresentWaitSupported && presentIdFeatures.presentId && presentWaitFeatures.presentWait) {
+    aExtensionNames.insert(aExtensionNames.end(), s_aPresentWaitExtensions,
+                           s_aPresentWaitExtensions + _countof(s_aPresentWaitExtensions));
+    presentIdFeatures.pNext = vulkan12Features.pNext;
+    vulkan12Features.pNext = &presentWaitFeatures;
+    m_aDeviceConfig.PresentWaitEnabled = TRUE;
+  }
+  if (bExtendedDynamicStateSupported && extendedDynamicStateFeatures.extendedDynamicState) {
+    aExtensionNames.insert(aExtensionNames.end(), s_aExtendedDynamicStateExtensions,
+                           s_aExtendedDynamicStateExtensions +
+                               _countof(s_aExtendedDynamicStateExtensions));
+    extendedDynamicStateFeatures.pNext = vulkan12Features.pNext;
+    vulkan12Features.pNext = &extendedDynamicStateFeatures;
+    m_aDeviceConfig.ExtendedDynamicStateEnabled = TRUE;
+  }
+  if (bSynchronization2Supported && synchronization2Features.synchronization2) {
+    aExtensionNames.insert(aExtensionNames.end(), s_aSynchronization2Extensions,
+                           s_aSynchronization2Extensions + _countof(s_aSynchronization2Extensions));
+    synchronization2Features.pNext = vulkan12Features.pNext;
+    vulkan12Features.pNext = &synchronization2Features;
+    m_aDeviceConfig.Synchronization2Enabled = TRUE;
+  }
+  /// No features, it only extends the memory properties.
+  if (bMemoryBudgetSupported) {
+    aExtensionNames.insert(aExtensionNames.end(), s_aMemoryBudgetExtensions,
+                           s_aMemoryBudgetExtensions + _countof(s_aMemoryBudgetExtensions));
+    m_aDeviceConfig.MemoryBudgetEnabled = TRUE;
+  }
+  if (bCalibratedTimestampsSupported) {
+    aExtensionNames.insert(aExtensionNames.end(), s_aCalibratedTimestampsExtensions,
+                           s_aCalibratedTimestampsExtensions +
+                               _countof(s_aCalibratedTimestampsExtensions));
+    m_aDeviceConfig.CalibratedTimestampsEnabled = TRUE;
   }
 
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-  createInfo.pQueueCreateInfos = queueCreateInfo;
-  createInfo.queueCreateInfoCount = queueFamilyCount;
+  createInfo.pNext = &vulkan12Features;
+  createInfo.pQueueCreateInfos = queueCreateInfo.data();
+  createInfo.queueCreateInfoCount = (uint32_t)queueCreateInfo.size();
   createInfo.pEnabledFeatures = &physicalDeviceFeatures;
-  createInfo.ppEnabledExtensionNames = s_aDeviceExtensions;
-  createInfo.enabledExtensionCount = _countof(s_aDeviceExtensions);
+  createInfo.ppEnabledExtensionNames = aExtensionNames.data();
+  createInfo.enabledExtensionCount = (uint32_t)aExtensionNames.size();
 
 #ifdef _DEBUG
   createInfo.enabledLayerCount = _countof(s_aValidationLayerNames);
@@ -404,6 +863,53 @@ VKHRESULT VulkanRenderContext::CreateLogicalDevice() {
 
   vkGetDeviceQueue(m_pDevice, m_iGraphicQueueFamilyIndex, 0, &m_pGraphicQueue);
   vkGetDeviceQueue(m_pDevice, m_iPresentQueueFamilyIndex, 0, &m_pPresentQueue);
+  vkGetDeviceQueue(m_pDevice, m_iTransferQueueFamilyIndex, 0, &m_pTransferQueue);
+  if (m_aDeviceConfig.AsyncComputeEnabled)
+    vkGetDeviceQueue(m_pDevice, m_iComputeQueueFamilyIndex, 0, &m_pComputeQueue);
+
+  if (m_aDeviceConfig.PresentWaitEnabled) {
+    m_pfnWaitForPresentKHR =
+        (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(m_pDevice, "vkWaitForPresentKHR");
+    m_aDeviceConfig.PresentWaitEnabled = m_pfnWaitForPresentKHR != nullptr;
+  }
+
+  if (m_aDeviceConfig.ExtendedDynamicStateEnabled) {
+    m_pfnCmdSetCullModeEXT =
+        (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(m_pDevice, "vkCmdSetCullModeEXT");
+    m_pfnCmdSetFrontFaceEXT =
+        (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(m_pDevice, "vkCmdSetFrontFaceEXT");
+    m_pfnCmdSetDepthTestEnableEXT = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(
+        m_pDevice, "vkCmdSetDepthTestEnableEXT");
+    m_pfnCmdSetDepthWriteEnableEXT = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(
+        m_pDevice, "vkCmdSetDepthWriteEnableEXT");
+    m_pfnCmdSetDepthCompareOpEXT = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(
+        m_pDevice, "vkCmdSetDepthCompareOpEXT");
+    m_aDeviceConfig.ExtendedDynamicStateEnabled =
+        m_pfnCmdSetCullModeEXT && m_pfnCmdSetFrontFaceEXT && m_pfnCmdSetDepthTestEnableEXT &&
+        m_pfnCmdSetDepthWriteEnableEXT && m_pfnCmdSetDepthCompareOpEXT;
+  }
+
+  if (m_aDeviceConfig.Synchronization2Enabled) {
+    m_pfnCmdPipelineBarrier2KHR =
+        (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(m_pDevice, "vkCmdPipelineBarrier2KHR");
+    m_aDeviceConfig.Synchronization2Enabled = m_pfnCmdPipelineBarrier2KHR != nullptr;
+  }
+
+  if (m_aDeviceConfig.CalibratedTimestampsEnabled) {
+    m_pfnGetCalibratedTimestampsEXT = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(
+        m_pDevice, "vkGetCalibratedTimestampsEXT");
+    m_aDeviceConfig.CalibratedTimestampsEnabled = m_pfnGetCalibratedTimestampsEXT != nullptr;
+  }
+
+  /// Viewport and scissor are always dynamic, so resizing never recreates a pipeline.
+  m_aPipelineDynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  if (m_aDeviceConfig.ExtendedDynamicStateEnabled) {
+    m_aPipelineDynamicStates.insert(
+        m_aPipelineDynamicStates.end(),
+        {VK_DYNAMIC_STATE_CULL_MODE_EXT, VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+         VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+         VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT});
+  }
 
   return hr;
 }
@@ -427,7 +933,9 @@ VKHRESULT VulkanRenderContext::CreateWindowSurface(void *pOpacHandle) {
     V_RETURN(-1 || (VKHRESULT)(uintptr_t)(void *)("Can not find vkCreateWin32SurfaceKHR"));
   }
 #else
-  static_assert(0, "Unsupported yet");
+  (void)pOpacHandle;
+  VK_TRACE("Window surfaces are only supported on Win32, use the headless mode instead.\n");
+  V_RETURN(VK_ERROR_EXTENSION_NOT_PRESENT);
 #endif
 
   return hr;
@@ -438,6 +946,10 @@ uint32_t VulkanRenderContext::CalcSwapChainBackBufferCount() {
   VkSurfaceCapabilitiesKHR capabilities;
   uint32_t swapChainImageCount;
 
+  /// No presentation engine holds offscreen images, one image per frame slot is enough.
+  if (IsHeadless())
+    return GetFrameCount();
+
   V(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_pPhysicalDevice, m_pWndSurface, &capabilities));
 
   swapChainImageCount = capabilities.minImageCount + 1;
@@ -447,9 +959,6 @@ uint32_t VulkanRenderContext::CalcSwapChainBackBufferCount() {
   if (swapChainImageCount < m_iSwapChainImageCount)
     swapChainImageCount = m_iSwapChainImageCount;
 
-  if (swapChainImageCount > _countof(m_aSwapChainItemCtx))
-    swapChainImageCount = _countof(m_aSwapChainItemCtx);
-
   return swapChainImageCount;
 }
 
@@ -466,7 +975,11 @@ VKHRESULT VulkanRenderContext::CreateSwapChain() {
   VkSwapchainCreateInfoKHR swapChainCreateInfo = {};
   uint32_t swapChainImageCount = m_iSwapChainImageCount;
   uint32_t i;
-  VkImage aSwapChainImages[3];
+  std::vector<VkImage> aSwapChainImages;
+  VkSwapchainKHR pOldSwapChain = m_pSwapChain;
+
+  if (IsHeadless())
+    return CreateOffscreenImages();
 
   vkGetPhysicalDeviceSurfaceFormatsKHR(m_pPhysicalDevice, m_pWndSurface, &formatCount, nullptr);
   formats.resize(formatCount);
@@ -515,6 +1028,17 @@ VKHRESULT VulkanRenderContext::CreateSwapChain() {
     }
   }
 
+  /// Low latency replaces the queued image rather than waiting behind it.
+  if (m_aDeviceConfig.PresentLatency == PresentLatencyPolicy::LowLatency) {
+    for (auto &presentMode : presentModes) {
+      if (presentMode == (m_aDeviceConfig.VsyncEnabled ? VK_PRESENT_MODE_MAILBOX_KHR
+                                                       : VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+        surfacePresentMode = presentMode;
+        break;
+      }
+    }
+  }
+
   /// Choose swap chain extent.
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
     currExtent = capabilities.currentExtent;
@@ -526,7 +1050,7 @@ VKHRESULT VulkanRenderContext::CreateSwapChain() {
                                 std::min(capabilities.maxImageExtent.width, currExtent.width));
 
     currExtent.height = std::max(capabilities.minImageExtent.height,
-                                 std::max(capabilities.maxImageExtent.height, currExtent.height));
+                                 std::min(capabilities.maxImageExtent.height, currExtent.height));
   }
 
   /// Create swap chain.
@@ -556,37 +1080,111 @@ VKHRESULT VulkanRenderContext::CreateSwapChain() {
   swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
   swapChainCreateInfo.presentMode = surfacePresentMode;
   swapChainCreateInfo.clipped = VK_TRUE;
-  swapChainCreateInfo.oldSwapchain = nullptr;
+  swapChainCreateInfo.oldSwapchain = pOldSwapChain;
 
   V_RETURN(vkCreateSwapchainKHR(m_pDevice, &swapChainCreateInfo, nullptr, &m_pSwapChain));
 
+  /// The old swap chain is retired by the creation, but its presents may still be pending. The
+  /// graphics timeline only covers the rendering they wait for, see `CollectOldSwapChains`.
+  if (pOldSwapChain)
+    m_aOldSwapChains.push_back({pOldSwapChain, m_uSwapChainLastPresentId, 0, 0});
+  m_uSwapChainLastPresentId = 0;
+
+  /// Render pass compatibility depends on the format.
+  if (m_pSwapChainFBsCompatibleRenderPass && surfaceFormat.format != m_aSwapChainImageFormat)
+    RetireSwapChainAttachments(true);
+
   /// Store some immmediate context for later usage.
   m_aSwapChainImageFormat = surfaceFormat.format;
   m_aSwapChainExtent = currExtent;
+  m_iClientWidth = currExtent.width;
+  m_iClientHeight = currExtent.height;
 
-  /// Query images form the swap chain.
+  /// Query images form the swap chain, the driver may hand out more images than requested.
   swapChainImageCount = 0;
   V_RETURN(vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount, nullptr));
-  V(!(m_iSwapChainImageCount == swapChainImageCount) && !!("Swap chain image count error!"));
-  V_RETURN(
-      vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount, aSwapChainImages));
+  aSwapChainImages.resize(swapChainImageCount);
+  V_RETURN(vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount,
+                                   aSwapChainImages.data()));
+  m_iSwapChainImageCount = swapChainImageCount;
+  m_aSwapChainItemCtx.assign(swapChainImageCount, SwapChainItemContext{});
   for (i = 0; i < swapChainImageCount; ++i)
     m_aSwapChainItemCtx[i].pImage = aSwapChainImages[i];
 
-  if (IsMsaaEnabled()) {
-    V_RETURN(CreateMsaaColorBuffer());
+  V_RETURN(CreateSwapChainAttachments());
+
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::CreateOffscreenImages() {
+
+  VKHRESULT hr;
+  uint32_t i;
+  VkImageCreateInfo createInfo = {
+      VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,                                   // sType;
+      nullptr,                                                               // pNext;
+      0,                                                                     // flags;
+      VK_IMAGE_TYPE_2D,                                                      // imageType;
+      VK_FORMAT_B8G8R8A8_UNORM,                                              // format;
+      {m_iClientWidth, m_iClientHeight, 1},                                  // extent;
+      1,                                                                     // mipLevels;
+      1,                                                                     // arrayLayers;
+      VK_SAMPLE_COUNT_1_BIT,                                                 // samples;
+      VK_IMAGE_TILING_OPTIMAL,                                               // tiling;
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // usage;
+      VK_SHARING_MODE_EXCLUSIVE,                                             // sharingMode;
+      0,                        // queueFamilyIndexCount;
+      nullptr,                  // pQueueFamilyIndices;
+      VK_IMAGE_LAYOUT_UNDEFINED // initialLayout;
+  };
+
+  m_aSwapChainImageFormat = createInfo.format;
+  m_aSwapChainExtent.width = m_iClientWidth;
+  m_aSwapChainExtent.height = m_iClientHeight;
+
+  m_aSwapChainItemCtx.assign(m_iSwapChainImageCount, SwapChainItemContext{});
+  for (i = 0; i < m_iSwapChainImageCount; ++i) {
+    V_RETURN(CreateDefaultTexture(m_pDevice, &createInfo, &m_aSwapChainItemCtx[i].pImage,
+                                  &m_aSwapChainItemCtx[i].pImageMem,
+                                  VkMemoryCategory::Attachments));
   }
 
+  V_RETURN(CreateSwapChainAttachments());
+
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::CreateSwapChainAttachments() {
+
+  VKHRESULT hr;
+  VkSampleCountFlagBits samples = IsMsaaEnabled()
+                                      ? (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel
+                                      : VK_SAMPLE_COUNT_1_BIT;
+  uint32_t uMsaaColor, uDepthStencil;
+
   V_RETURN(this->CreateSwapChainImageViews());
-  V_RETURN(this->CreateDepthStencilBuffer());
-  V_RETURN(this->CreateSwapChainFBsCompatibleRenderPass());
-  V_RETURN(this->CreateSwapChainFrameBuffers());
+
+  /// The MSAA color and the depth stencil share the transient memory.
+  V_RETURN(this->FindDepthStencilFormat(&m_aDepthStencilFormat));
+  AddTransientAttachments(&m_TransientAttachments, m_aSwapChainExtent, samples,
+                          m_aDepthStencilFormat, &uMsaaColor, &uDepthStencil);
+  V_RETURN(m_TransientAttachments.Allocate(m_pDevice, m_DeviceCaps.LazilyAllocatedMemory));
+
+  if (IsMsaaEnabled()) {
+    m_pMsaaColorBuffer = m_TransientAttachments.GetImage(uMsaaColor);
+    V_RETURN(CreateMsaaColorView());
+  }
+  m_pDepthStencilImage = m_TransientAttachments.GetImage(uDepthStencil);
+  V_RETURN(this->CreateDepthStencilView());
+  /// Kept across resizes, it only depends on the formats and the sample count.
+  if (!m_pSwapChainFBsCompatibleRenderPass)
+    V_RETURN(this->CreateSwapChainFBsCompatibleRenderPass());
 
   /// Viewport and Scissor Rect Settings.
   m_Viewport.x = .0f;
   m_Viewport.y = .0f;
-  m_Viewport.width = (float)m_iClientWidth;
-  m_Viewport.height = (float)m_iClientHeight;
+  m_Viewport.width = (float)m_aSwapChainExtent.width;
+  m_Viewport.height = (float)m_aSwapChainExtent.height;
   m_Viewport.minDepth = .0f;
   m_Viewport.maxDepth = 1.0f;
 
@@ -597,29 +1195,9 @@ VKHRESULT VulkanRenderContext::CreateSwapChain() {
   return hr;
 }
 
-VKHRESULT VulkanRenderContext::CreateMsaaColorBuffer() {
+VKHRESULT VulkanRenderContext::CreateMsaaColorView() {
 
   VKHRESULT hr;
-  VkImageCreateInfo createInfo = {
-      VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,                                           // sType;
-      nullptr,                                                                       // pNext;
-      0,                                                                             // flags;
-      VK_IMAGE_TYPE_2D,                                                              // imageType;
-      m_aSwapChainImageFormat,                                                       // format;
-      {m_aSwapChainExtent.width, m_aSwapChainExtent.height, 1},                      // extent;
-      1,                                                                             // mipLevels;
-      1,                                                                             // arrayLayers;
-      (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel,                       // samples;
-      VK_IMAGE_TILING_OPTIMAL,                                                       // tiling;
-      VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, // usage;
-      VK_SHARING_MODE_EXCLUSIVE,                                                     // sharingMode;
-      0,                        // queueFamilyIndexCount;
-      nullptr,                  // pQueueFamilyIndices;
-      VK_IMAGE_LAYOUT_UNDEFINED // initialLayout;
-  };
-
-  V_RETURN(
-      CreateDefaultTexture(m_pDevice, &createInfo, &m_pMsaaColorBuffer, &m_pMsaaColorBufferMem));
 
   VkImageViewCreateInfo viewInfo = {
       VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO, // sType;
@@ -627,7 +1205,7 @@ VKHRESULT VulkanRenderContext::CreateMsaaColorBuffer() {
       0,                                        // flags;
       m_pMsaaColorBuffer,                       // image;
       VK_IMAGE_VIEW_TYPE_2D,                    // viewType;
-      createInfo.format,                        // format;
+      m_aSwapChainImageFormat,                  // format;
       {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
        VK_COMPONENT_SWIZZLE_IDENTITY}, // components;
       {
@@ -644,49 +1222,126 @@ VKHRESULT VulkanRenderContext::CreateMsaaColorBuffer() {
 }
 
 VKHRESULT VulkanRenderContext::RecreateSwapChain() {
-  VKHRESULT hr;
-  CleanupSwapChain();
-  V(CreateSwapChain());
+  VKHRESULT hr = VK_SUCCESS;
+
+  /// Minimized, keep the swap chain dirty until the window has an area again.
+  if (m_iClientWidth == 0 || m_iClientHeight == 0)
+    return VK_NOT_READY;
+
+  /// Present ids belong to the old swap chain, only the GPU work can be tracked from now on.
+  for (auto &present : m_aQueuedPresents)
+    present.uPresentId = 0;
+
+  /// The old swap chain itself stays alive until the new one was created from it.
+  RetireSwapChainAttachments(m_bRenderPassDirty);
+  m_bRenderPassDirty = false;
+
+  V_RETURN(CreateSwapChain());
+  m_bSwapChainDirty = false;
+
+  /// The render pass or the pipelines may be new.
+  InvalidateStaticCommands();
+
+  V_RETURN(OnSwapChainRecreated());
+
   return hr;
 }
 
-void VulkanRenderContext::CleanupSwapChain() {
+VKHRESULT VulkanRenderContext::OnSwapChainRecreated() {
+  return VK_SUCCESS;
+}
 
-  uint32_t i;
+void VulkanRenderContext::RetireSwapChainAttachments(bool bRenderPass) {
 
-  for (i = 0; i < m_iSwapChainImageCount; ++i) {
-    vkDestroyFramebuffer(m_pDevice, m_aSwapChainItemCtx[i].pFrameBuffer, nullptr);
-    m_aSwapChainItemCtx[i].pFrameBuffer = nullptr;
-  }
+  VkDevice pDevice = m_pDevice;
+  std::vector<SwapChainItemContext> aSwapChainItems;
+  VkImageView pMsaaColorView = m_pMsaaColorView;
+  VkImageView pDepthStencilImageView = m_pDepthStencilImageView;
+  VkTransientAllocator transientAttachments = m_TransientAttachments;
+  VkRenderPass pRenderPass = bRenderPass ? m_pSwapChainFBsCompatibleRenderPass : VK_NULL_HANDLE;
+  std::vector<VkFramebuffer> aFramebuffers;
 
-  vkDestroyImageView(m_pDevice, m_pMsaaColorView, nullptr);
-  m_pMsaaColorView = nullptr;
-  DestroyVmaImage(m_pMsaaColorBuffer, m_pMsaaColorBufferMem);
+  /// The graph's framebuffers reference the views retired here.
+  m_RenderGraph.ReleaseFramebuffers(&aFramebuffers);
+  aSwapChainItems.swap(m_aSwapChainItemCtx);
+  m_TransientAttachments = VkTransientAllocator();
   m_pMsaaColorBuffer = nullptr;
-  m_pMsaaColorBufferMem = nullptr;
-
-  vkDestroyRenderPass(m_pDevice, m_pSwapChainFBsCompatibleRenderPass, nullptr);
-  m_pSwapChainFBsCompatibleRenderPass = nullptr;
-
-  DestroyVmaImage(m_pDepthStencilImage, m_pDepthStencilBufferMem);
+  m_pMsaaColorView = nullptr;
   m_pDepthStencilImage = nullptr;
-  m_pDepthStencilBufferMem = nullptr;
-  vkDestroyImageView(m_pDevice, m_pDepthStencilImageView, nullptr);
   m_pDepthStencilImageView = nullptr;
-
-  for (i = 0; i < m_iSwapChainImageCount; ++i) {
-    vkDestroyImageView(m_pDevice, m_aSwapChainItemCtx[i].pImageView, nullptr);
-    m_aSwapChainItemCtx[i].pImageView = nullptr;
+  if (bRenderPass) {
+    m_pSwapChainFBsCompatibleRenderPass = nullptr;
+    /// Queued compilations may still be created against it.
+    m_PipelineCompiler.WaitIdle();
   }
 
+  /// Any submitted frame may still reference them.
+  m_GraphicsTimeline.Retire(
+      m_GraphicsTimeline.GetLastSubmitted(),
+      [pDevice, aSwapChainItems = std::move(aSwapChainItems), pMsaaColorView,
+       pDepthStencilImageView, transientAttachments, pRenderPass,
+       aFramebuffers = std::move(aFramebuffers)]() mutable {
+        for (auto pFramebuffer : aFramebuffers)
+          vkDestroyFramebuffer(pDevice, pFramebuffer, nullptr);
+        for (auto &item : aSwapChainItems) {
+          vkDestroyImageView(pDevice, item.pImageView, nullptr);
+          /// Swap chain images are owned by the swap chain.
+          if (item.pImageMem)
+            DestroyVmaImage(item.pImage, item.pImageMem);
+        }
+
+        vkDestroyImageView(pDevice, pMsaaColorView, nullptr);
+        vkDestroyImageView(pDevice, pDepthStencilImageView, nullptr);
+        transientAttachments.Destroy(pDevice);
+        vkDestroyRenderPass(pDevice, pRenderPass, nullptr);
+      });
+}
+
+void VulkanRenderContext::CleanupSwapChain() {
+
+  /// The attachments are retired to the graphics timeline, which is collected when the device is
+  /// destroyed. The device is idle, so the old swap chains are done with their presents as well.
+  RetireSwapChainAttachments(true);
+
+  for (auto &oldSwapChain : m_aOldSwapChains)
+    vkDestroySwapchainKHR(m_pDevice, oldSwapChain.pSwapChain, nullptr);
+  m_aOldSwapChains.clear();
+
   vkDestroySwapchainKHR(m_pDevice, m_pSwapChain, nullptr);
   m_pSwapChain = nullptr;
 }
 
-VKHRESULT VulkanRenderContext::CreateDepthStencilBuffer() {
+void VulkanRenderContext::CollectOldSwapChains() {
+
+  VKHRESULT hr;
+
+  /// Retired in creation order, a newer one is never done before an older one.
+  while (!m_aOldSwapChains.empty()) {
+    OldSwapChain &oldSwapChain = m_aOldSwapChains.front();
+
+    hr = VK_ERROR_EXTENSION_NOT_PRESENT;
+    if (oldSwapChain.uLastPresentId && m_pfnWaitForPresentKHR)
+      hr = m_pfnWaitForPresentKHR(m_pDevice, oldSwapChain.pSwapChain, oldSwapChain.uLastPresentId,
+                                  0);
+    if (hr == VK_TIMEOUT)
+      return;
+
+    /// Without a present id only the GPU side is known. The first present to a newer swap chain
+    /// was queued behind the old presents, but its frame completing doesn't mean the presentation
+    /// engine let go of the old images, so the frame after it has to complete too. A heuristic,
+    /// only VK_KHR_present_wait (or VK_EXT_swapchain_maintenance1) makes it exact.
+    if (hr != VK_SUCCESS && !(oldSwapChain.uTimelineValue &&
+                              m_GraphicsTimeline.IsCompleted(oldSwapChain.uTimelineValue)))
+      return;
+
+    vkDestroySwapchainKHR(m_pDevice, oldSwapChain.pSwapChain, nullptr);
+    m_aOldSwapChains.pop_front();
+  }
+}
+
+VKHRESULT VulkanRenderContext::FindDepthStencilFormat(VkFormat *pFormat) const {
 
   VKHRESULT hr;
-  VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL; /// VK_IMAGE_TILING_LINEAR
   VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
   VkFormat candidates[] = {
       VK_FORMAT_D24_UNORM_S8_UINT,
@@ -695,13 +1350,12 @@ VKHRESULT VulkanRenderContext::CreateDepthStencilBuffer() {
   };
   VkFormatProperties props;
   VkBool32 bFormatFound = VK_FALSE;
-  VkFormat depthStencilFormat;
 
   for (auto &format : candidates) {
     vkGetPhysicalDeviceFormatProperties(m_pPhysicalDevice, format, &props);
 
     if ((props.optimalTilingFeatures & features) == features) {
-      depthStencilFormat = format;
+      *pFormat = format;
       bFormatFound = true;
       break;
     }
@@ -709,27 +1363,47 @@ VKHRESULT VulkanRenderContext::CreateDepthStencilBuffer() {
 
   V_RETURN(!(bFormatFound && !!("Can not find the depth-stencil format that device supported!")));
 
-  VkImageCreateInfo imageInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-                                 nullptr,
-                                 0,
-                                 VK_IMAGE_TYPE_2D,
-                                 depthStencilFormat,
-                                 {m_aSwapChainExtent.width, m_aSwapChainExtent.height, 1},
-                                 1,
-                                 1,
-                                 IsMsaaEnabled()
-                                     ? ((VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel)
-                                     : VK_SAMPLE_COUNT_1_BIT,
-                                 tiling,
-                                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                                 VK_SHARING_MODE_EXCLUSIVE,
-                                 0,
-                                 nullptr,
-                                 VK_IMAGE_LAYOUT_UNDEFINED};
-
-  V_RETURN(CreateDefaultTexture(m_pDevice, &imageInfo, &m_pDepthStencilImage,
-                                &m_pDepthStencilBufferMem));
-  m_aDepthStencilFormat = depthStencilFormat;
+  return hr;
+}
+
+void VulkanRenderContext::AddTransientAttachments(VkTransientAllocator *pAllocator,
+                                                  VkExtent2D extent, VkSampleCountFlagBits samples,
+                                                  VkFormat depthStencilFormat,
+                                                  uint32_t *puMsaaColor,
+                                                  uint32_t *puDepthStencil) const {
+  VkImageCreateInfo imageInfo = {
+      VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,                                           // sType;
+      nullptr,                                                                       // pNext;
+      0,                                                                             // flags;
+      VK_IMAGE_TYPE_2D,                                                              // imageType;
+      m_aSwapChainImageFormat,                                                       // format;
+      {extent.width, extent.height, 1},                                              // extent;
+      1,                                                                             // mipLevels;
+      1,                                                                             // arrayLayers;
+      samples,                                                                       // samples;
+      VK_IMAGE_TILING_OPTIMAL,                                                       // tiling;
+      VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, // usage;
+      VK_SHARING_MODE_EXCLUSIVE,                                                     // sharingMode;
+      0,                        // queueFamilyIndexCount;
+      nullptr,                  // pQueueFamilyIndices;
+      VK_IMAGE_LAYOUT_UNDEFINED // initialLayout;
+  };
+
+  /// Both live through the only pass of the frame, resolved or discarded at its end.
+  *puMsaaColor = UINT32_MAX;
+  if (samples != VK_SAMPLE_COUNT_1_BIT)
+    *puMsaaColor = pAllocator->AddImage(imageInfo, 0, 0);
+
+  imageInfo.format = depthStencilFormat;
+  imageInfo.usage =
+      VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  *puDepthStencil = pAllocator->AddImage(imageInfo, 0, 0);
+}
+
+VKHRESULT VulkanRenderContext::CreateDepthStencilView() {
+
+  VKHRESULT hr;
+  VkFormat depthStencilFormat = m_aDepthStencilFormat;
 
   /// Create Depth-Stencil Image View.
   VkImageViewCreateInfo imageViewInfo = {};
@@ -748,43 +1422,8 @@ VKHRESULT VulkanRenderContext::CreateDepthStencilBuffer() {
     imageViewInfo.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
   V_RETURN(vkCreateImageView(m_pDevice, &imageViewInfo, nullptr, &m_pDepthStencilImageView));
 
-  /// Start record intialize command buffer.
-  auto pCmdBuffer = m_aRendererItemCtx[m_iCurrRendererItem].pCommandBuffer;
-  VkCommandBufferBeginInfo cmdBegInfo = {
-      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-      nullptr,
-      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-      nullptr,
-  };
-
-  V(vkBeginCommandBuffer(pCmdBuffer, &cmdBegInfo));
-
-  /// Record a command to transfer layout state,
-  VkImageMemoryBarrier barrier = {};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.image = m_pDepthStencilImage;
-  barrier.srcAccessMask = 0;
-  barrier.dstAccessMask =
-      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = m_pDepthStencilImage;
-  barrier.subresourceRange = imageViewInfo.subresourceRange;
-
-  vkCmdPipelineBarrier(pCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1,
-                       &barrier);
-
-  vkEndCommandBuffer(pCmdBuffer);
-
-  VkSubmitInfo submitInfo = {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &pCmdBuffer;
-  vkQueueSubmit(m_pGraphicQueue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(m_pGraphicQueue);
+  /// No layout transition up front, the render pass starts from an undefined layout and clears
+  /// the attachment.
 
   return hr;
 }
@@ -843,6 +1482,9 @@ VKHRESULT VulkanRenderContext::CreateSwapChainImageViews() {
 VKHRESULT VulkanRenderContext::CreateSwapChainFBsCompatibleRenderPass() {
 
   VKHRESULT hr;
+  /// Offscreen images stay ready for a read back instead of presentation.
+  VkImageLayout presentLayout =
+      IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
   /// Create frame buffer compatible render pass
   /// 1 render pass, 1 subpass
   VkAttachmentDescription colorAttachment{};
@@ -851,14 +1493,16 @@ VKHRESULT VulkanRenderContext::CreateSwapChainFBsCompatibleRenderPass() {
                                 ? (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel
                                 : VK_SAMPLE_COUNT_1_BIT;
   colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  /// Multisampled color only lives until the resolve, never written back to memory.
+  colorAttachment.storeOp =
+      IsMsaaEnabled() ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   if (IsMsaaEnabled()) {
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
   } else
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = presentLayout;
 
   VkAttachmentDescription colorAttachmentResolve = {};
   colorAttachmentResolve.format = m_aSwapChainImageFormat;
@@ -868,7 +1512,7 @@ VKHRESULT VulkanRenderContext::CreateSwapChainFBsCompatibleRenderPass() {
   colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAttachmentResolve.finalLayout = presentLayout;
 
   VkAttachmentDescription depthStencilAttachment = {};
   depthStencilAttachment.format = m_aDepthStencilFormat;
@@ -876,9 +1520,9 @@ VKHRESULT VulkanRenderContext::CreateSwapChainFBsCompatibleRenderPass() {
                                        ? (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel
                                        : VK_SAMPLE_COUNT_1_BIT;
   depthStencilAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthStencilAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthStencilAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthStencilAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthStencilAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthStencilAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthStencilAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   depthStencilAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
@@ -902,14 +1546,6 @@ VKHRESULT VulkanRenderContext::CreateSwapChainFBsCompatibleRenderPass() {
   if (IsMsaaEnabled())
     subpass.pResolveAttachments = &colorAttachmentRefResolve;
 
-  VkSubpassDependency dependency{};
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.srcAccessMask = 0;
-  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
   VkAttachmentDescription attachments[] = {colorAttachment, depthStencilAttachment,
                                            colorAttachmentResolve};
 
@@ -919,50 +1555,13 @@ VKHRESULT VulkanRenderContext::CreateSwapChainFBsCompatibleRenderPass() {
   renderPassInfo.pAttachments = attachments;
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  /// No dependencies, compatible with the render graph's passes which synchronize by barriers.
 
   V_RETURN(vkCreateRenderPass(m_pDevice, &renderPassInfo, nullptr,
                               &m_pSwapChainFBsCompatibleRenderPass));
   return hr;
 }
 
-VKHRESULT VulkanRenderContext::CreateSwapChainFrameBuffers() {
-
-  VKHRESULT hr = 0;
-  /// Create frame buffers.
-  uint32_t i;
-  VkFramebufferCreateInfo fbInfo = {};
-  VkImageView aAttachmentViews[3] = {};
-
-  fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  fbInfo.renderPass = m_pSwapChainFBsCompatibleRenderPass;
-
-  for (i = 0; i < m_iSwapChainImageCount; ++i) {
-
-    if (IsMsaaEnabled()) {
-      aAttachmentViews[0] = m_pMsaaColorView;
-      aAttachmentViews[1] = m_pDepthStencilImageView;
-      aAttachmentViews[2] = m_aSwapChainItemCtx[i].pImageView;
-      fbInfo.attachmentCount = 3;
-    } else {
-      aAttachmentViews[0] = m_aSwapChainItemCtx[i].pImageView;
-      aAttachmentViews[1] = m_pDepthStencilImageView;
-      fbInfo.attachmentCount = 2;
-    }
-
-    fbInfo.pAttachments = aAttachmentViews;
-    fbInfo.width = m_aSwapChainExtent.width;
-    fbInfo.height = m_aSwapChainExtent.height;
-    fbInfo.layers = 1;
-
-    V_RETURN(
-        vkCreateFramebuffer(m_pDevice, &fbInfo, nullptr, &m_aSwapChainItemCtx[i].pFrameBuffer));
-  }
-
-  return hr;
-}
-
 VKHRESULT VulkanRenderContext::CreateGraphicsQueueCommandPool() {
   VKHRESULT hr;
   VkCommandPoolCreateInfo createInfo = {};
@@ -978,33 +1577,36 @@ VKHRESULT VulkanRenderContext::CreateGraphicsQueueCommandPool() {
 VKHRESULT VulkanRenderContext::CreateGraphicsQueueCommandBuffers() {
 
   VKHRESULT hr;
+  VkCommandPoolCreateInfo poolInfo = {};
   VkCommandBufferAllocateInfo allocInfo = {};
-  VkCommandBuffer aCmdBuffers[3];
   uint32_t i;
   VkSemaphoreCreateInfo semInfo = {};
-  VkFenceCreateInfo fenceInfo = {};
+
+  m_aRendererItemCtx.assign(m_aDeviceConfig.FramesInFlight, RendererItemContext{});
+
+  /// Re-recorded every frame, so one transient pool per slot which is reset as a whole rather
+  /// than buffer by buffer.
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = m_iGraphicQueueFamilyIndex;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.commandPool = m_pCommandPool;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = _countof(m_aRendererItemCtx);
-
-  V_RETURN(vkAllocateCommandBuffers(m_pDevice, &allocInfo, aCmdBuffers));
+  allocInfo.commandBufferCount = 1;
 
   semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
   semInfo.flags = 0;
 
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-  for (i = 0; i < _countof(m_aRendererItemCtx); ++i) {
-    m_aRendererItemCtx[i].pCommandBuffer = aCmdBuffers[i];
+  for (i = 0; i < (uint32_t)m_aRendererItemCtx.size(); ++i) {
+    V_RETURN(vkCreateCommandPool(m_pDevice, &poolInfo, nullptr,
+                                 &m_aRendererItemCtx[i].pCommandPool));
+    allocInfo.commandPool = m_aRendererItemCtx[i].pCommandPool;
+    V_RETURN(
+        vkAllocateCommandBuffers(m_pDevice, &allocInfo, &m_aRendererItemCtx[i].pCommandBuffer));
 
     /// Create sychronizing objects.
     V_RETURN(
         vkCreateSemaphore(m_pDevice, &semInfo, nullptr, &m_aRendererItemCtx[i].pRenderFinishedSem));
-    V_RETURN(vkCreateFence(m_pDevice, &fenceInfo, nullptr,
-                           &m_aRendererItemCtx[i].pCmdBufferInFightFence));
   }
 
   return hr;
@@ -1019,9 +1621,11 @@ VKHRESULT VulkanRenderContext::CreateSwapChainSyncObjects() {
   semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
   semInfo.flags = 0;
 
-  for (i = 0; i < m_iSwapChainImageCount; ++i) {
+  /// Acquiring semaphores belong to the frame ring rather than to the swap chain images, since
+  /// the image index is only known after the acquisition.
+  for (i = 0; i < (uint32_t)m_aRendererItemCtx.size(); ++i) {
     V_RETURN(vkCreateSemaphore(m_pDevice, &semInfo, nullptr,
-                               &m_aSwapChainItemCtx[i].pImageAvailableSem));
+                               &m_aRendererItemCtx[i].pImageAvailableSem));
   }
 
   return hr;
@@ -1031,56 +1635,726 @@ VKHRESULT
 VulkanRenderContext::PrepareNextFrame(_Inout_opt_ SwapChainItemContext **ppSwapchainContext) {
   VKHRESULT hr;
   uint32_t imageIndex = 0;
+  RendererItemContext *pRendererContext = &m_aRendererItemCtx[m_iCurrRendererItem];
+  SwapChainItemContext *pSwapChainContext;
+  double stallStart;
 
-  V(vkAcquireNextImageKHR(m_pDevice, m_pSwapChain, UINT64_MAX,
-                          m_aSwapChainItemCtx[m_iCurrSwapChainItem].pImageAvailableSem,
-                          VK_NULL_HANDLE, &imageIndex));
-  if (m_iCurrSwapChainItem != imageIndex) {
-    std::swap(m_aSwapChainItemCtx[imageIndex].pImageAvailableSem,
-              m_aSwapChainItemCtx[m_iCurrSwapChainItem].pImageAvailableSem);
-    m_iCurrSwapChainItem = imageIndex;
+  if (ppSwapchainContext)
+    *ppSwapchainContext = nullptr;
+
+  /// Coalesced resizes and out of date swap chains, no frame is rendered until it succeeds.
+  if (m_bSwapChainDirty) {
+    hr = RecreateSwapChain();
+    if (hr != VK_SUCCESS) {
+      SkipFrame();
+      return hr;
+    }
   }
 
-  if (ppSwapchainContext)
+  if (IsHeadless()) {
+    V(AcquireOffscreenImage(&imageIndex));
+  } else {
+    stallStart = m_PresentTimer.TotalElapsed();
+    hr = vkAcquireNextImageKHR(m_pDevice, m_pSwapChain, UINT64_MAX,
+                               pRendererContext->pImageAvailableSem, VK_NULL_HANDLE, &imageIndex);
+    m_FrameStalls.AcquireMs += (float)(1000.0 * (m_PresentTimer.TotalElapsed() - stallStart));
+    if (hr == VK_SUBOPTIMAL_KHR) {
+      /// The image was acquired and the semaphore is signaled, so render this frame anyway.
+      m_bSwapChainDirty = true;
+      hr = VK_SUCCESS;
+    } else if (hr == VK_ERROR_OUT_OF_DATE_KHR) {
+      /// Nothing acquired and the semaphore stays unsignaled, the frame is skipped.
+      m_bSwapChainDirty = true;
+      SkipFrame();
+      return hr;
+    }
+    V(hr);
+  }
+  if (hr == VK_SUCCESS) {
+    m_iCurrSwapChainItem = imageIndex;
+    pSwapChainContext = &m_aSwapChainItemCtx[imageIndex];
+
+    /// With a deeper ring than the swap chain, the image may still be owned by another frame. The
+    /// value is updated once this frame is submitted.
+    stallStart = m_PresentTimer.TotalElapsed();
+    V(m_GraphicsTimeline.Wait(pSwapChainContext->uInFlightValue));
+    m_FrameStalls.GpuWaitMs += (float)(1000.0 * (m_PresentTimer.TotalElapsed() - stallStart));
+  }
+
+  if (ppSwapchainContext)
     *ppSwapchainContext = (hr == VK_SUCCESS) ? &m_aSwapChainItemCtx[m_iCurrSwapChainItem] : nullptr;
 
   return hr;
 }
 
+void VulkanRenderContext::SkipFrame() {
+
+  /// A skipped frame has no timeline value to be recorded under. Its stalls are dropped rather
+  /// than charged to the next frame, which starts afresh.
+  m_FrameStalls = {};
+  m_FrameStartTime = m_PresentTimer.TotalElapsed();
+}
+
+VKHRESULT
+VulkanRenderContext::AcquireOffscreenImage(uint32_t *puImageIndex) {
+
+  /// Round robin, the frame waits on the timeline value of the image's previous use.
+  *puImageIndex = (m_iCurrSwapChainItem + 1) % m_iSwapChainImageCount;
+
+  return VK_SUCCESS;
+}
+
 VKHRESULT
 VulkanRenderContext::WaitForPreviousGraphicsCommandBufferFence(
     _In_ RendererItemContext *pRendererContext) {
 
   VKHRESULT hr;
+  uint32_t uFrameIndex = (uint32_t)(pRendererContext - m_aRendererItemCtx.data());
+  double stallStart;
 
   V(!(pRendererContext && !!"Previous command buffer is not synchronized!"));
-  V(vkWaitForFences(m_pDevice, 1, &pRendererContext->pCmdBufferInFightFence, FALSE, UINT64_MAX));
-  vkResetFences(m_pDevice, 1, &pRendererContext->pCmdBufferInFightFence);
+  /// Frame N - FramesInFlight, nothing to reset afterwards.
+  stallStart = m_PresentTimer.TotalElapsed();
+  V(m_GraphicsTimeline.Wait(pRendererContext->uFrameTimelineValue));
+  m_FrameStalls.GpuWaitMs += (float)(1000.0 * (m_PresentTimer.TotalElapsed() - stallStart));
+
+  /// The slot's command buffers are no longer in use, primary and secondary ones alike.
+  V(vkResetCommandPool(m_pDevice, pRendererContext->pCommandPool, 0));
+  V(m_ParallelRecorder.ResetFrame(uFrameIndex));
+  m_FrameUniforms.ResetFrame(uFrameIndex);
+
+  ResolveFrame(pRendererContext);
+
+  /// Keeps the queue short when the application never calls `WaitForFrameStart`.
+  while (!m_aQueuedPresents.empty() && RetireQueuedPresent(m_aQueuedPresents.front(), false))
+    m_aQueuedPresents.pop_front();
+
+  /// Resources retired by the frames finished meanwhile.
+  m_GraphicsTimeline.Collect();
+  CollectOldSwapChains();
+  if (m_pComputeQueue)
+    m_ComputeTimeline.Collect();
+  m_UploadContext.Reclaim();
+
+  if (m_aDeviceConfig.MemoryLogInterval &&
+      ++m_uMemoryLogFrame % m_aDeviceConfig.MemoryLogInterval == 0)
+    LogVmaMemoryUsage();
 
   return hr;
 }
 
-VKHRESULT VulkanRenderContext::Present() {
+VKHRESULT VulkanRenderContext::CreateAsyncComputeObjects() {
+
+  VKHRESULT hr = 0;
+  VkCommandPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  VkCommandBufferAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  VkQueryPoolCreateInfo queryPoolInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties;
+  VkPhysicalDeviceProperties properties;
+  uint32_t queueFamilyCount = 0;
+  bool bTimestampSupported;
+  uint32_t i;
+
+  vkGetPhysicalDeviceProperties(m_pPhysicalDevice, &properties);
+  vkGetPhysicalDeviceQueueFamilyProperties(m_pPhysicalDevice, &queueFamilyCount, NULL);
+  queueFamilyProperties.resize(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(m_pPhysicalDevice, &queueFamilyCount,
+                                           queueFamilyProperties.data());
+
+  /// Timestamps of both queues are compared, so both have to support them.
+  bTimestampSupported = properties.limits.timestampPeriod > 0.0f &&
+                        queueFamilyProperties[m_iGraphicQueueFamilyIndex].timestampValidBits > 0;
+  if (m_pComputeQueue)
+    bTimestampSupported = bTimestampSupported &&
+                          queueFamilyProperties[m_iComputeQueueFamilyIndex].timestampValidBits > 0;
+  m_fTimestampPeriod = properties.limits.timestampPeriod;
+
+  /// Vulkan only orders timestamps within a queue. The ones of a dedicated compute family are
+  /// comparable to the graphics ones when both are read in the device time domain, a sample of
+  /// it proves the driver can serve it. Otherwise the overlap is left unmeasured.
+  m_bQueueTimestampsComparable = bTimestampSupported && m_pComputeQueue;
+  if (m_bQueueTimestampsComparable && HasDedicatedComputeQueue()) {
+    VkCalibratedTimestampInfoEXT timestampInfo = {VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT};
+    uint64_t uDeviceTimestamp, uMaxDeviation;
+
+    timestampInfo.timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    m_bQueueTimestampsComparable =
+        m_aDeviceConfig.CalibratedTimestampsEnabled &&
+        m_pfnGetCalibratedTimestampsEXT(m_pDevice, 1, &timestampInfo, &uDeviceTimestamp,
+                                        &uMaxDeviation) == VK_SUCCESS;
+  }
+
+  if (bTimestampSupported) {
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 4 * (uint32_t)m_aRendererItemCtx.size();
+    V_RETURN(vkCreateQueryPool(m_pDevice, &queryPoolInfo, nullptr, &m_pFrameTimestampQueryPool));
+
+    allocInfo.commandPool = m_pCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = _countof(m_aRendererItemCtx[0].aTimestampCmdBuffers);
+    for (i = 0; i < (uint32_t)m_aRendererItemCtx.size(); ++i) {
+      V_RETURN(vkAllocateCommandBuffers(m_pDevice, &allocInfo,
+                                        m_aRendererItemCtx[i].aTimestampCmdBuffers));
+    }
+    V_RETURN(RecordTimestampCommandBuffers());
+  }
+
+  if (!m_pComputeQueue)
+    return hr;
+
+  poolInfo.queueFamilyIndex = m_iComputeQueueFamilyIndex;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  V_RETURN(vkCreateCommandPool(m_pDevice, &poolInfo, nullptr, &m_pComputeCommandPool));
+
+  allocInfo.commandPool = m_pComputeCommandPool;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = 1;
+  for (i = 0; i < (uint32_t)m_aRendererItemCtx.size(); ++i) {
+    V_RETURN(vkAllocateCommandBuffers(m_pDevice, &allocInfo,
+                                      &m_aRendererItemCtx[i].pComputeCommandBuffer));
+  }
+
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::RecordTimestampCommandBuffers() {
+
+  VKHRESULT hr = 0;
+  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  uint32_t i, uQuery;
+
+  /// Recorded once and resubmitted every time the slot comes around.
+  for (i = 0; i < (uint32_t)m_aRendererItemCtx.size(); ++i) {
+    VkCommandBuffer *aCmdBuffers = m_aRendererItemCtx[i].aTimestampCmdBuffers;
+    uQuery = 4 * i + 2;
+
+    V_RETURN(vkBeginCommandBuffer(aCmdBuffers[0], &beginInfo));
+    vkCmdResetQueryPool(aCmdBuffers[0], m_pFrameTimestampQueryPool, uQuery, 2);
+    vkCmdWriteTimestamp(aCmdBuffers[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        m_pFrameTimestampQueryPool, uQuery);
+    V_RETURN(vkEndCommandBuffer(aCmdBuffers[0]));
+
+    V_RETURN(vkBeginCommandBuffer(aCmdBuffers[1], &beginInfo));
+    vkCmdWriteTimestamp(aCmdBuffers[1], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        m_pFrameTimestampQueryPool, uQuery + 1);
+    V_RETURN(vkEndCommandBuffer(aCmdBuffers[1]));
+  }
+
+  return hr;
+}
+
+VkCommandBuffer VulkanRenderContext::BeginAsyncCompute() {
 
   VKHRESULT hr;
+  RendererItemContext *pRendererContext = &m_aRendererItemCtx[m_iCurrRendererItem];
+  VkCommandBuffer pCmdBuffer = pRendererContext->pComputeCommandBuffer;
+  VkCommandBufferBeginInfo beginInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, // sType;
+      nullptr,                                     // pNext;
+      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // flags;
+      nullptr                                      // pInheritanceInfo;
+  };
+
+  if (!pCmdBuffer)
+    return VK_NULL_HANDLE;
+
+  V(vkResetCommandBuffer(pCmdBuffer, 0));
+  V(vkBeginCommandBuffer(pCmdBuffer, &beginInfo));
+
+  if (m_pFrameTimestampQueryPool) {
+    vkCmdResetQueryPool(pCmdBuffer, m_pFrameTimestampQueryPool, 4 * m_iCurrRendererItem, 2);
+    vkCmdWriteTimestamp(pCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pFrameTimestampQueryPool,
+                        4 * m_iCurrRendererItem);
+  }
+
+  return pCmdBuffer;
+}
+
+VKHRESULT VulkanRenderContext::SubmitAsyncCompute(VkPipelineStageFlags graphicsWaitStage) {
+
+  VKHRESULT hr;
+  RendererItemContext *pRendererContext = &m_aRendererItemCtx[m_iCurrRendererItem];
+  VkCommandBuffer pCmdBuffer = pRendererContext->pComputeCommandBuffer;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+  VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfo};
+  VkSemaphore pComputeSem = m_ComputeTimeline.GetSemaphore();
+
+  V_RETURN(!(pCmdBuffer && !!("Async compute is not enabled!")));
+
+  if (m_pFrameTimestampQueryPool) {
+    vkCmdWriteTimestamp(pCmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        m_pFrameTimestampQueryPool, 4 * m_iCurrRendererItem + 1);
+  }
+  V_RETURN(vkEndCommandBuffer(pCmdBuffer));
+
+  /// The graphics submission of the frame waits for the value, so the frame's graphics value
+  /// covers the compute work as well.
+  pRendererContext->uComputeTimelineValue = m_ComputeTimeline.Next();
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &pRendererContext->uComputeTimelineValue;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &pCmdBuffer;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &pComputeSem;
+  V_RETURN(vkQueueSubmit(m_pComputeQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+  pRendererContext->ComputeWaitStage = graphicsWaitStage;
+
+  return hr;
+}
+
+VKHRESULT
+VulkanRenderContext::SubmitGraphicsCommandBuffer(_In_ RendererItemContext *pRendererContext) {
+
+  VKHRESULT hr;
+
+  /// Uploads queued during the frame, submitted ahead of it so the frame sees them.
+  V_RETURN(m_UploadContext.Submit());
+
+  VkSemaphore waitSemaphores[2];
+  VkPipelineStageFlags waitStages[2];
+  /// Values of the binary semaphores are ignored.
+  uint64_t waitValues[2];
+  VkSemaphore signalSemaphores[2];
+  uint64_t signalValues[2];
+  uint64_t uFrameValue;
+  VkCommandBuffer cmdBuffers[3] = {pRendererContext->aTimestampCmdBuffers[0],
+                                   pRendererContext->pCommandBuffer,
+                                   pRendererContext->aTimestampCmdBuffers[1]};
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+  VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfo};
+
+  /// Offscreen images have no presentation engine to wait for or to signal, the graphics
+  /// timeline alone orders the frames.
+  if (!IsHeadless()) {
+    waitSemaphores[submitInfo.waitSemaphoreCount] = pRendererContext->pImageAvailableSem;
+    waitStages[submitInfo.waitSemaphoreCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    waitValues[submitInfo.waitSemaphoreCount++] = 0;
+    signalSemaphores[submitInfo.signalSemaphoreCount] = pRendererContext->pRenderFinishedSem;
+    signalValues[submitInfo.signalSemaphoreCount++] = 0;
+  }
+  if (pRendererContext->ComputeWaitStage) {
+    waitSemaphores[submitInfo.waitSemaphoreCount] = m_ComputeTimeline.GetSemaphore();
+    waitStages[submitInfo.waitSemaphoreCount] = pRendererContext->ComputeWaitStage;
+    waitValues[submitInfo.waitSemaphoreCount++] = pRendererContext->uComputeTimelineValue;
+  }
+  uFrameValue = m_GraphicsTimeline.Next();
+  signalSemaphores[submitInfo.signalSemaphoreCount] = m_GraphicsTimeline.GetSemaphore();
+  signalValues[submitInfo.signalSemaphoreCount++] = uFrameValue;
+
+  submitInfo.pWaitSemaphores = waitSemaphores;
+  submitInfo.pWaitDstStageMask = waitStages;
+  if (m_pFrameTimestampQueryPool) {
+    submitInfo.commandBufferCount = _countof(cmdBuffers);
+    submitInfo.pCommandBuffers = cmdBuffers;
+  } else {
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &pRendererContext->pCommandBuffer;
+  }
+  submitInfo.pSignalSemaphores = signalSemaphores;
+  timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+  timelineInfo.pWaitSemaphoreValues = waitValues;
+  timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+  timelineInfo.pSignalSemaphoreValues = signalValues;
+
+  V_RETURN(vkQueueSubmit(m_pGraphicQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+  pRendererContext->uFrameTimelineValue = uFrameValue;
+  m_aSwapChainItemCtx[m_iCurrSwapChainItem].uInFlightValue = uFrameValue;
+
+  pRendererContext->bTimestampsWritten = m_pFrameTimestampQueryPool != VK_NULL_HANDLE;
+  pRendererContext->bFrameResolved = false;
+
+  return hr;
+}
+
+void VulkanRenderContext::ResolveFrameTimestamps(_In_ RendererItemContext *pRendererContext) {
+
+  uint32_t uQuery = 4 * (uint32_t)(pRendererContext - m_aRendererItemCtx.data());
+  uint64_t aTimestamps[4] = {};
+  double msPerTick = m_fTimestampPeriod * 1e-6;
+  bool bComputeTimed = pRendererContext->ComputeWaitStage != 0;
+  double computeBegin, computeEnd, graphicsBegin, graphicsEnd;
+
+  /// The frame fence was signaled, so the results are available without waiting. Compute
+  /// queries are only read back when written, unreset queries must not be queried.
+  if (pRendererContext->bTimestampsWritten &&
+      vkGetQueryPoolResults(m_pDevice, m_pFrameTimestampQueryPool, uQuery + 2, 2,
+                            2 * sizeof(uint64_t), &aTimestamps[2], sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) == VK_SUCCESS &&
+      (!bComputeTimed ||
+       vkGetQueryPoolResults(m_pDevice, m_pFrameTimestampQueryPool, uQuery, 2,
+                             2 * sizeof(uint64_t), &aTimestamps[0], sizeof(uint64_t),
+                             VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)) {
+
+    graphicsBegin = aTimestamps[2] * msPerTick;
+    graphicsEnd = aTimestamps[3] * msPerTick;
+    m_AsyncComputeTimings.GraphicsMs += graphicsEnd - graphicsBegin;
+
+    if (bComputeTimed) {
+      computeBegin = aTimestamps[0] * msPerTick;
+      computeEnd = aTimestamps[1] * msPerTick;
+      m_AsyncComputeTimings.ComputeMs += computeEnd - computeBegin;
+      if (m_bQueueTimestampsComparable)
+        m_AsyncComputeTimings.OverlapMs += std::max(
+            0.0, std::min(computeEnd, graphicsEnd) - std::max(computeBegin, graphicsBegin));
+    }
+    m_AsyncComputeTimings.FrameCount += 1;
+  }
+
+  pRendererContext->bTimestampsWritten = false;
+  pRendererContext->ComputeWaitStage = 0;
+}
+
+void VulkanRenderContext::ResolveFrame(_In_ RendererItemContext *pRendererContext) {
+
+  uint32_t uFrameIndex = (uint32_t)(pRendererContext - m_aRendererItemCtx.data());
+  bool bGpuResolved;
+
+  /// By `WaitIdle` or once the slot is reused, whichever comes first.
+  if (pRendererContext->bFrameResolved)
+    return;
+  pRendererContext->bFrameResolved = true;
+
+  ResolveFrameTimestamps(pRendererContext);
+  bGpuResolved = m_GpuProfiler.ResolveFrame(uFrameIndex);
+  m_FrameStats.RecordGpu(pRendererContext->uFrameTimelineValue,
+                         bGpuResolved ? m_GpuProfiler.GetLastFrameMs() : -1.0f);
+}
+
+VKHRESULT VulkanRenderContext::PrepareStaticCommandBuffer(
+    const std::function<void(VkCommandBuffer)> &fnRecord, VkCommandBuffer *ppCmdBuffer) {
+
+  VKHRESULT hr = VK_SUCCESS;
+  RendererItemContext *pRendererContext = &m_aRendererItemCtx[m_iCurrRendererItem];
+  VkCommandBufferAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  /// No framebuffer, the buffer is reused for every swap chain image.
+  VkCommandBufferInheritanceInfo inheritanceInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO, // sType;
+      nullptr,                                           // pNext;
+      m_pSwapChainFBsCompatibleRenderPass,               // renderPass;
+      0,                                                 // subpass;
+      VK_NULL_HANDLE,                                    // framebuffer;
+      VK_FALSE,                                          // occlusionQueryEnable;
+      0,                                                 // queryFlags;
+      m_aDeviceConfig.InheritedQueriesEnabled ? m_GpuProfiler.GetPipelineStatisticsFlags()
+                                              : 0 // pipelineStatistics;
+  };
+  VkCommandBufferBeginInfo beginInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,      // sType;
+      nullptr,                                          // pNext;
+      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, // flags;
+      &inheritanceInfo                                  // pInheritanceInfo;
+  };
+
+  *ppCmdBuffer = VK_NULL_HANDLE;
+
+  /// Only the slot's own frames execute it, so it's idle once the slot was waited.
+  if (pRendererContext->uStaticGeneration != m_uStaticGeneration) {
+    if (!pRendererContext->pStaticCmdBuffer) {
+      allocInfo.commandPool = m_pCommandPool;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocInfo.commandBufferCount = 1;
+      V_RETURN(
+          vkAllocateCommandBuffers(m_pDevice, &allocInfo, &pRendererContext->pStaticCmdBuffer));
+    }
+
+    /// Begin resets it implicitly.
+    V_RETURN(vkBeginCommandBuffer(pRendererContext->pStaticCmdBuffer, &beginInfo));
+    fnRecord(pRendererContext->pStaticCmdBuffer);
+    V_RETURN(vkEndCommandBuffer(pRendererContext->pStaticCmdBuffer));
+    pRendererContext->uStaticGeneration = m_uStaticGeneration;
+  }
+
+  *ppCmdBuffer = pRendererContext->pStaticCmdBuffer;
+
+  return hr;
+}
+
+void VulkanRenderContext::ImportSwapChainAttachments(
+    _In_ const SwapChainItemContext *pSwapchainContext, VkRenderGraph::ResourceId *pBackBuffer,
+    VkRenderGraph::ResourceId *pMsaaColor, VkRenderGraph::ResourceId *pDepthStencil) {
+
+  VkSampleCountFlagBits samples = IsMsaaEnabled()
+                                      ? (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel
+                                      : VK_SAMPLE_COUNT_1_BIT;
+  /// Read by the presentation engine, or the acquire, which the frame's submission waits.
+  RenderGraphImportState backBufferState = {VK_IMAGE_LAYOUT_UNDEFINED,
+                                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+  /// Shared by the frames in flight, the previous frame's writes must be done.
+  RenderGraphImportState msaaColorState = {VK_IMAGE_LAYOUT_UNDEFINED,
+                                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                           VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+  RenderGraphImportState depthStencilState = {
+      VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+
+  *pBackBuffer = m_RenderGraph.ImportImage(
+      "BackBuffer", pSwapchainContext->pImage, pSwapchainContext->pImageView,
+      m_aSwapChainImageFormat, m_aSwapChainExtent, VK_SAMPLE_COUNT_1_BIT, backBufferState,
+      IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+  *pMsaaColor = VkRenderGraph::InvalidResource;
+  if (IsMsaaEnabled())
+    *pMsaaColor = m_RenderGraph.ImportImage("MsaaColor", m_pMsaaColorBuffer, m_pMsaaColorView,
+                                            m_aSwapChainImageFormat, m_aSwapChainExtent, samples,
+                                            msaaColorState, VK_IMAGE_LAYOUT_UNDEFINED);
+
+  *pDepthStencil = m_RenderGraph.ImportImage(
+      "DepthStencil", m_pDepthStencilImage, m_pDepthStencilImageView, m_aDepthStencilFormat,
+      m_aSwapChainExtent, samples, depthStencilState, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+bool VulkanRenderContext::GetAsyncComputeStats(_Out_opt_ AsyncComputeStats *pStats, bool bReset) {
+
+  uint32_t uFrameCount = m_AsyncComputeTimings.FrameCount;
+
+  if (pStats) {
+    *pStats = {};
+    if (uFrameCount) {
+      pStats->ComputeMs = (float)(m_AsyncComputeTimings.ComputeMs / uFrameCount);
+      pStats->GraphicsMs = (float)(m_AsyncComputeTimings.GraphicsMs / uFrameCount);
+      pStats->OverlapMs = (float)(m_AsyncComputeTimings.OverlapMs / uFrameCount);
+      pStats->OverlapRatio =
+          m_AsyncComputeTimings.ComputeMs > 0.0
+              ? (float)(m_AsyncComputeTimings.OverlapMs / m_AsyncComputeTimings.ComputeMs)
+              : 0.0f;
+      pStats->FrameCount = uFrameCount;
+    }
+    pStats->OverlapMeasured = m_bQueueTimestampsComparable;
+  }
+
+  if (bReset)
+    m_AsyncComputeTimings = {};
+
+  return uFrameCount > 0;
+}
+
+VKHRESULT VulkanRenderContext::Present() {
+
+  VKHRESULT hr = VK_SUCCESS;
   VkPresentInfoKHR presentInfo = {};
+  uint64_t uPresentId = 0;
+  double now;
+  VkPresentIdKHR presentIdInfo = {
+      VK_STRUCTURE_TYPE_PRESENT_ID_KHR, // sType;
+      nullptr,                          // pNext;
+      1,                                // swapchainCount;
+      &uPresentId                       // pPresentIds;
+  };
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-  presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = &m_aRendererItemCtx[m_iCurrRendererItem].pRenderFinishedSem;
-  presentInfo.swapchainCount = 1;
-  presentInfo.pSwapchains = &m_pSwapChain;
-  presentInfo.pImageIndices = &m_iCurrSwapChainItem;
-  presentInfo.pResults = nullptr;
+  /// Offscreen frames are done once submitted, nothing is presented.
+  if (!IsHeadless()) {
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &m_aRendererItemCtx[m_iCurrRendererItem].pRenderFinishedSem;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &m_pSwapChain;
+    presentInfo.pImageIndices = &m_iCurrSwapChainItem;
+    presentInfo.pResults = nullptr;
+    if (m_pfnWaitForPresentKHR) {
+      uPresentId = ++m_uLastPresentId;
+      presentInfo.pNext = &presentIdInfo;
+    }
+
+    /// The semaphore wait is executed even when out of date, only the swap chain is stale.
+    now = m_PresentTimer.TotalElapsed();
+    hr = vkQueuePresentKHR(m_pPresentQueue, &presentInfo);
+    m_FrameStalls.PresentMs += (float)(1000.0 * (m_PresentTimer.TotalElapsed() - now));
+    if (hr == VK_ERROR_OUT_OF_DATE_KHR || hr == VK_SUBOPTIMAL_KHR) {
+      if (hr == VK_ERROR_OUT_OF_DATE_KHR)
+        uPresentId = 0;
+      m_bSwapChainDirty = true;
+    }
+
+    /// Queued to the current swap chain, the old ones can go once enough of these completed.
+    if (hr == VK_SUCCESS || hr == VK_SUBOPTIMAL_KHR) {
+      if (uPresentId)
+        m_uSwapChainLastPresentId = uPresentId;
+      for (auto &oldSwapChain : m_aOldSwapChains) {
+        if (!oldSwapChain.uTimelineValue &&
+            ++oldSwapChain.uNewerPresentCount == s_uOldSwapChainReleasePresents)
+          oldSwapChain.uTimelineValue = m_aRendererItemCtx[m_iCurrRendererItem].uFrameTimelineValue;
+      }
+    }
+    if (hr == VK_ERROR_OUT_OF_DATE_KHR || hr == VK_SUBOPTIMAL_KHR)
+      hr = VK_SUCCESS;
+    V(hr);
+  }
 
-  V(vkQueuePresentKHR(m_pPresentQueue, &presentInfo));
+  now = m_PresentTimer.TotalElapsed();
+  m_FrameStats.RecordCpu(m_aRendererItemCtx[m_iCurrRendererItem].uFrameTimelineValue,
+                         (float)(1000.0 * (now - m_FrameStartTime)), m_FrameStalls);
+  m_FrameStalls = {};
+  m_aQueuedPresents.push_back({uPresentId,
+                               m_aRendererItemCtx[m_iCurrRendererItem].uFrameTimelineValue,
+                               m_InputSampledTime, m_FrameStartTime});
+  m_InputSampledTime = -1.0;
+  /// The next frame starts here unless `WaitForFrameStart` is called.
+  m_FrameStartTime = now;
 
-  m_iCurrSwapChainItem = (m_iCurrSwapChainItem + 1) % m_iSwapChainImageCount;
-  m_iCurrRendererItem = (m_iCurrRendererItem + 1) % _countof(m_aRendererItemCtx);
+  m_iCurrRendererItem = (m_iCurrRendererItem + 1) % (uint32_t)m_aRendererItemCtx.size();
 
   return hr;
 }
 
+uint32_t VulkanRenderContext::GetMaxQueuedPresents() const {
+  switch (m_aDeviceConfig.PresentLatency) {
+  case PresentLatencyPolicy::LowLatency:
+    return 1;
+  case PresentLatencyPolicy::Balanced:
+    return std::min(2u, GetFrameCount());
+  default:
+    return GetFrameCount();
+  }
+}
+
+bool VulkanRenderContext::RetireQueuedPresent(const QueuedPresent &present, bool bBlock) {
+
+  VKHRESULT hr = VK_ERROR_EXTENSION_NOT_PRESENT;
+  double now, elapsedMs;
+
+  if (present.uPresentId && m_pfnWaitForPresentKHR)
+    hr = m_pfnWaitForPresentKHR(m_pDevice, m_pSwapChain, present.uPresentId,
+                                bBlock ? s_uPresentWaitTimeout : 0);
+  if (hr == VK_TIMEOUT && !bBlock)
+    return false;
+
+  /// Without a present id, once out of date, or never displayed such as when minimized, the end of
+  /// the GPU work stands in for the present.
+  if (hr != VK_SUCCESS) {
+    if (bBlock)
+      hr = m_GraphicsTimeline.Wait(present.uTimelineValue);
+    else
+      hr = m_GraphicsTimeline.IsCompleted(present.uTimelineValue) ? VK_SUCCESS : VK_TIMEOUT;
+    if (hr != VK_SUCCESS)
+      return false;
+  }
+
+  /// Times are observed by the CPU, so polled completions are late by up to a frame.
+  now = m_PresentTimer.TotalElapsed();
+  if (m_LastPresentTime >= 0.0) {
+    elapsedMs = 1000.0 * (now - m_LastPresentTime);
+    m_PresentLatency.IntervalMs = m_PresentLatency.IntervalMs > 0.0
+                                      ? 0.9 * m_PresentLatency.IntervalMs + 0.1 * elapsedMs
+                                      : elapsedMs;
+  }
+  m_FrameStats.RecordPresent(present.uTimelineValue,
+                             m_LastPresentTime >= 0.0 ? (float)elapsedMs : -1.0f);
+  elapsedMs = 1000.0 * (now - present.FrameStartTime);
+  m_PresentLatency.FrameWorkMs = m_PresentLatency.FrameWorkMs > 0.0
+                                     ? 0.9 * m_PresentLatency.FrameWorkMs + 0.1 * elapsedMs
+                                     : elapsedMs;
+  m_LastPresentTime = now;
+
+  if (present.InputSampledTime >= 0.0) {
+    elapsedMs = 1000.0 * (now - present.InputSampledTime);
+    m_PresentLatency.TotalMs += elapsedMs;
+    m_PresentLatency.MaxMs = std::max(m_PresentLatency.MaxMs, elapsedMs);
+    m_PresentLatency.FrameCount += 1;
+  }
+
+  return true;
+}
+
+void VulkanRenderContext::WaitForFrameStart() {
+
+  uint32_t uMaxQueuedPresents = GetMaxQueuedPresents();
+  double slackMs;
+  double stallStart = m_PresentTimer.TotalElapsed();
+
+  /// Retire what completed meanwhile, and block down to the bound of the policy.
+  while (!m_aQueuedPresents.empty() &&
+         RetireQueuedPresent(m_aQueuedPresents.front(),
+                             m_aQueuedPresents.size() >= uMaxQueuedPresents)) {
+    m_aQueuedPresents.pop_front();
+  }
+  /// Charged to the frame about to start, the deliberate low latency sleep is not a stall.
+  m_FrameStalls.PacingMs += (float)(1000.0 * (m_PresentTimer.TotalElapsed() - stallStart));
+
+  /// Start as late as the predicted work of the frame still meets the next present, so the input
+  /// is sampled as late as possible.
+  if (m_aDeviceConfig.PresentLatency == PresentLatencyPolicy::LowLatency &&
+      m_PresentLatency.IntervalMs > 0.0 && m_LastPresentTime >= 0.0) {
+    slackMs = m_PresentLatency.IntervalMs - m_PresentLatency.FrameWorkMs -
+              1000.0 * (m_PresentTimer.TotalElapsed() - m_LastPresentTime) -
+              std::max(1.0, 0.1 * m_PresentLatency.IntervalMs);
+    if (slackMs > 0.0) {
+      std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(slackMs));
+      m_PresentLatency.DelayMs += slackMs;
+    }
+  }
+
+  m_FrameStartTime = m_PresentTimer.TotalElapsed();
+}
+
+void VulkanRenderContext::MarkInputSampled() {
+  m_InputSampledTime = m_PresentTimer.TotalElapsed();
+}
+
+void VulkanRenderContext::SetPresentLatencyPolicy(PresentLatencyPolicy policy) {
+  if (m_aDeviceConfig.PresentLatency != policy) {
+    m_aDeviceConfig.PresentLatency = policy;
+    /// The present mode depends on the policy.
+    if (m_pDevice)
+      m_bSwapChainDirty = true;
+  }
+}
+
+PresentLatencyPolicy VulkanRenderContext::GetPresentLatencyPolicy() const {
+  return m_aDeviceConfig.PresentLatency;
+}
+
+bool VulkanRenderContext::GetPresentLatencyStats(_Out_opt_ PresentLatencyStats *pStats,
+                                                 bool bReset) {
+
+  uint32_t uFrameCount = m_PresentLatency.FrameCount;
+
+  if (pStats) {
+    *pStats = {};
+    if (uFrameCount) {
+      pStats->InputToPresentMs = (float)(m_PresentLatency.TotalMs / uFrameCount);
+      pStats->MaxInputToPresentMs = (float)m_PresentLatency.MaxMs;
+      pStats->FrameStartDelayMs = (float)(m_PresentLatency.DelayMs / uFrameCount);
+      pStats->FrameCount = uFrameCount;
+    }
+    pStats->PresentWait = m_aDeviceConfig.PresentWaitEnabled;
+  }
+
+  /// The moving averages drive the pacing, they are kept.
+  if (bReset) {
+    m_PresentLatency.TotalMs = 0.0;
+    m_PresentLatency.MaxMs = 0.0;
+    m_PresentLatency.DelayMs = 0.0;
+    m_PresentLatency.FrameCount = 0;
+  }
+
+  return uFrameCount > 0;
+}
+
+void VulkanRenderContext::CmdSetViewportState(VkCommandBuffer pCmdBuffer) {
+  vkCmdSetViewport(pCmdBuffer, 0, 1, &m_Viewport);
+  vkCmdSetScissor(pCmdBuffer, 0, 1, &m_ScissorRect);
+}
+
+void VulkanRenderContext::CmdSetRasterState(VkCommandBuffer pCmdBuffer,
+                                            const RasterDynamicState &state) {
+  /// Baked into the pipelines otherwise.
+  if (!m_aDeviceConfig.ExtendedDynamicStateEnabled)
+    return;
+
+  m_pfnCmdSetCullModeEXT(pCmdBuffer, state.CullMode);
+  m_pfnCmdSetFrontFaceEXT(pCmdBuffer, state.FrontFace);
+  m_pfnCmdSetDepthTestEnableEXT(pCmdBuffer, state.DepthTestEnable);
+  m_pfnCmdSetDepthWriteEnableEXT(pCmdBuffer, state.DepthWriteEnable);
+  m_pfnCmdSetDepthCompareOpEXT(pCmdBuffer, state.DepthCompareOp);
+}
+
+const std::vector<VkDynamicState> &VulkanRenderContext::GetPipelineDynamicStates() const {
+  return m_aPipelineDynamicStates;
+}
+
 float VulkanRenderContext::GetAspectRatio() const {
   return (float)m_iClientWidth / m_iClientHeight;
 }
@@ -1090,8 +2364,9 @@ VKHRESULT VulkanRenderContext::SetMsaaEnabled(bool state) {
   if (m_aDeviceConfig.MsaaEnabled != state) {
     m_aDeviceConfig.MsaaEnabled = state;
 
-    V(vkDeviceWaitIdle(m_pDevice));
-    V(RecreateSwapChain());
+    /// The sample count is baked into the render pass as well.
+    m_bSwapChainDirty = true;
+    m_bRenderPassDirty = true;
   }
   return hr;
 }
@@ -1100,19 +2375,214 @@ bool VulkanRenderContext::IsMsaaEnabled() const {
   return (m_aDeviceConfig.MsaaEnabled && m_aDeviceConfig.MsaaQaulityLevel > 1);
 }
 
+VKHRESULT VulkanRenderContext::SetFramesInFlight(uint32_t uFrameCount) {
+  VKHRESULT hr = 0;
+
+  /// The ring is allocated along with the device.
+  V_RETURN(!(!m_pDevice && !!("Frames in flight can not be changed after initialization!")));
+  m_aDeviceConfig.FramesInFlight =
+      std::max(1u, std::min(uFrameCount, (uint32_t)VK_MAX_FRAMES_IN_FLIGHT));
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::SetHeadlessEnabled(bool bEnabled) {
+  VKHRESULT hr = 0;
+
+  V_RETURN(!(!m_pDevice && !!("Headless mode can not be changed after initialization!")));
+  m_aDeviceConfig.HeadlessEnabled = bEnabled;
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::SetAsyncComputeEnabled(bool bEnabled) {
+  VKHRESULT hr = 0;
+
+  V_RETURN(!(!m_pDevice && !!("Async compute can not be changed after initialization!")));
+  m_aDeviceConfig.AsyncComputeEnabled = bEnabled;
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::SetRecordThreadCount(uint32_t uThreadCount) {
+  VKHRESULT hr = 0;
+
+  /// The per-thread pools are allocated along with the device.
+  V_RETURN(!(!m_pDevice && !!("Record threads can not be changed after initialization!")));
+  m_aDeviceConfig.RecordThreadCount =
+      std::max(1u, std::min(uThreadCount, (uint32_t)VK_MAX_RECORD_THREADS));
+  return hr;
+}
+
+uint32_t VulkanRenderContext::GetRecordThreadCount() const {
+  return m_aDeviceConfig.RecordThreadCount;
+}
+
+VKHRESULT VulkanRenderContext::SetDrawCount(uint32_t uDrawCount) {
+  VKHRESULT hr = 0;
+
+  V_RETURN(!(!m_pDevice && !!("Draw count can not be changed after initialization!")));
+  m_aDeviceConfig.DrawCount = std::max(1u, uDrawCount);
+  return hr;
+}
+
+uint32_t VulkanRenderContext::GetDrawCount() const {
+  return m_aDeviceConfig.DrawCount;
+}
+
+VKHRESULT VulkanRenderContext::SetStartupThreadCount(uint32_t uThreadCount) {
+  VKHRESULT hr = 0;
+
+  V_RETURN(!(!m_pDevice && !!("Startup threads can not be changed after initialization!")));
+  m_aDeviceConfig.StartupThreadCount = uThreadCount;
+  return hr;
+}
+
+uint32_t VulkanRenderContext::GetStartupThreadCount() const {
+  return m_aDeviceConfig.StartupThreadCount
+             ? m_aDeviceConfig.StartupThreadCount
+             : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void VulkanRenderContext::SetStaticCommandsEnabled(bool bEnabled) {
+  m_aDeviceConfig.StaticCommandsEnabled = bEnabled;
+}
+
+bool VulkanRenderContext::IsStaticCommandsEnabled() const {
+  return m_aDeviceConfig.StaticCommandsEnabled;
+}
+
+void VulkanRenderContext::InvalidateStaticCommands() {
+  ++m_uStaticGeneration;
+}
+
+void VulkanRenderContext::SetMemoryBudget(uint64_t cbBudget) {
+  SetVmaMemoryBudget(cbBudget);
+}
+
+uint64_t VulkanRenderContext::GetMemoryBudget() const {
+  return GetVmaMemoryBudget();
+}
+
+bool VulkanRenderContext::IsMemoryBudgetExtensionEnabled() const {
+  return m_aDeviceConfig.MemoryBudgetEnabled;
+}
+
+void VulkanRenderContext::SetMemoryLogInterval(uint32_t uFrameCount) {
+  m_aDeviceConfig.MemoryLogInterval = uFrameCount;
+}
+
+bool VulkanRenderContext::HasDedicatedComputeQueue() const {
+  return m_pComputeQueue && m_iComputeQueueFamilyIndex != m_iGraphicQueueFamilyIndex;
+}
+
+VkGpuProfiler *VulkanRenderContext::GetGpuProfiler() {
+  return &m_GpuProfiler;
+}
+
+VkFrameStats *VulkanRenderContext::GetFrameStats() {
+  return &m_FrameStats;
+}
+
+bool VulkanRenderContext::CalcFrameStats(_Out_ FrameStatsSummary *pSummary, uint32_t uLastFrames,
+                                         uint64_t uFirstFrame) const {
+  return m_FrameStats.Summarize(pSummary, uLastFrames, uFirstFrame);
+}
+
+uint64_t VulkanRenderContext::GetNextFrameValue() const {
+  return m_GraphicsTimeline.GetLastSubmitted() + 1;
+}
+
+VKHRESULT VulkanRenderContext::SetPipelineCacheFile(_In_z_ const char *pszFileName) {
+  VKHRESULT hr = 0;
+
+  V_RETURN(!(!m_pDevice && !!("The pipeline cache is loaded along with the device!")));
+  m_PipelineCacheFileName = pszFileName ? pszFileName : "";
+  return hr;
+}
+
+VKHRESULT VulkanRenderContext::SetPreferredDevice(_In_z_ const char *pszDevice) {
+  VKHRESULT hr = 0;
+
+  V_RETURN(!(!m_pDevice && !!("The device is picked along with the initialization!")));
+  m_PreferredDevice = pszDevice ? pszDevice : "";
+  return hr;
+}
+
+const PhysicalDeviceCaps &VulkanRenderContext::GetDeviceCaps() const {
+  return m_DeviceCaps;
+}
+
+VKHRESULT VulkanRenderContext::EstimateAttachmentMemory(uint32_t uWidth, uint32_t uHeight,
+                                                        uint32_t uSamples,
+                                                        AttachmentMemoryEstimate *pEstimate) const {
+  VKHRESULT hr;
+  VkPhysicalDeviceProperties properties;
+  VkTransientAllocator allocator;
+  VkFormat depthStencilFormat;
+  uint32_t uMsaaColor, uDepthStencil;
+
+  vkGetPhysicalDeviceProperties(m_pPhysicalDevice, &properties);
+  V_RETURN(!(m_pDevice && uWidth && uHeight && !!("The device must be initialized!")));
+  if (!(properties.limits.framebufferColorSampleCounts &
+        properties.limits.framebufferDepthSampleCounts & uSamples))
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  V_RETURN(FindDepthStencilFormat(&depthStencilFormat));
+
+  AddTransientAttachments(&allocator, {uWidth, uHeight}, (VkSampleCountFlagBits)uSamples,
+                          depthStencilFormat, &uMsaaColor, &uDepthStencil);
+  hr = allocator.Plan(m_pDevice);
+  if (hr == VK_SUCCESS) {
+    pEstimate->DedicatedBytes = allocator.GetRequestedBytes();
+    pEstimate->PackedBytes = allocator.GetBlockBytes();
+    pEstimate->CommittedBytes = pEstimate->PackedBytes;
+    pEstimate->LazilyAllocated = m_DeviceCaps.LazilyAllocatedMemory;
+  }
+  allocator.Destroy(m_pDevice);
+
+  return hr;
+}
+
+void VulkanRenderContext::GetAttachmentMemory(_Out_ AttachmentMemoryEstimate *pUsage) const {
+  pUsage->DedicatedBytes = m_TransientAttachments.GetRequestedBytes();
+  pUsage->PackedBytes = m_TransientAttachments.GetBlockBytes();
+  pUsage->CommittedBytes = m_TransientAttachments.GetCommittedBytes(m_pDevice);
+  pUsage->LazilyAllocated = m_TransientAttachments.IsLazilyAllocated();
+}
+
+VkPersistentPipelineCache *VulkanRenderContext::GetPipelineCache() {
+  return &m_PipelineCache;
+}
+
+VkPipelineCompiler *VulkanRenderContext::GetPipelineCompiler() {
+  return &m_PipelineCompiler;
+}
+
+const std::vector<TaskTiming> &VulkanRenderContext::GetStartupTimeline() const {
+  return m_aStartupTimeline;
+}
+
+bool VulkanRenderContext::IsHeadless() const {
+  return m_aDeviceConfig.HeadlessEnabled;
+}
+
+uint32_t VulkanRenderContext::GetFrameCount() const {
+  return m_pDevice ? (uint32_t)m_aRendererItemCtx.size() : m_aDeviceConfig.FramesInFlight;
+}
+
 void VulkanRenderContext::Update(float /*fTime*/, float /*fElapsedTime*/) {}
 
 void VulkanRenderContext::RenderFrame(float /*fTime*/, float /*fElaspedTime*/) {}
 
 VKHRESULT VulkanRenderContext::Resize(int cx, int cy) {
 
-  VKHRESULT hr;
+  VKHRESULT hr = VK_SUCCESS;
 
   m_iClientWidth = cx;
   m_iClientHeight = cy;
 
-  V(vkDeviceWaitIdle(m_pDevice));
-  V(RecreateSwapChain());
+  /// Bursts of size events collapse into a single recreation in `PrepareNextFrame`. Nothing to
+  /// recreate before the device, the first swap chain is created at this size.
+  if (m_pDevice &&
+      ((uint32_t)cx != m_aSwapChainExtent.width || (uint32_t)cy != m_aSwapChainExtent.height))
+    m_bSwapChainDirty = true;
 
   return hr;
 }
@@ -1,24 +1,165 @@
 #pragma once
+#include <deque>
 #include <string>
+#include <vector>
 #include "VkUtilities.h"
+#include "VkUploadContext.h"
+#include "VkTimeline.h"
+#include "VkGpuProfiler.h"
+#include "VkFrameRingBuffer.h"
+#include "VkFrameStats.h"
+#include "VkGeometryPool.h"
+#include "VkParallelRecorder.h"
+#include "VkPersistentPipelineCache.h"
+#include "VkPipelineCompiler.h"
+#include "VkRenderGraph.h"
+#include "VkTaskGraph.h"
+#include "VkTransientAllocator.h"
 #include "GameTimer.hpp"
 
+/// Upper bound of the frames the CPU may record ahead of the GPU.
+#ifndef VK_MAX_FRAMES_IN_FLIGHT
+#define VK_MAX_FRAMES_IN_FLIGHT 4
+#endif
+
+/// Upper bound of the threads recording secondary command buffers.
+#ifndef VK_MAX_RECORD_THREADS
+#define VK_MAX_RECORD_THREADS 16
+#endif
+
+/// Uniform bytes a frame may allocate from `m_FrameUniforms`.
+#ifndef VK_FRAME_UNIFORM_BYTES
+#define VK_FRAME_UNIFORM_BYTES (4u << 20)
+#endif
+
+/// Largest range of the dynamic uniform descriptors reading `m_FrameUniforms`, the minimum
+/// maxUniformBufferRange of the spec.
+#ifndef VK_FRAME_UNIFORM_MAX_RANGE
+#define VK_FRAME_UNIFORM_MAX_RANGE 16384u
+#endif
+
+/// Staging blocks of `m_UploadContext`, and the most staging memory uploads may hold at once.
+#ifndef VK_STAGING_BLOCK_BYTES
+#define VK_STAGING_BLOCK_BYTES (16ull << 20)
+#endif
+
+#ifndef VK_STAGING_BUDGET_BYTES
+#define VK_STAGING_BUDGET_BYTES (64ull << 20)
+#endif
+
+/// Vertex and index bytes of the meshes in `m_GeometryPool`.
+#ifndef VK_GEOMETRY_VERTEX_BYTES
+#define VK_GEOMETRY_VERTEX_BYTES (64ull << 20)
+#endif
+
+#ifndef VK_GEOMETRY_INDEX_BYTES
+#define VK_GEOMETRY_INDEX_BYTES (32ull << 20)
+#endif
+
+/// Upper bound of the threads compiling pipelines in the background.
+#ifndef VK_MAX_COMPILE_THREADS
+#define VK_MAX_COMPILE_THREADS 4
+#endif
+
 struct SwapChainItemContext {
   VkImage pImage;
   VkImageView pImageView;
-  VkFramebuffer pFrameBuffer;
 
-  VkSemaphore pImageAvailableSem;
+  /// Graphics timeline value of the frame which rendered into this image last time.
+  uint64_t uInFlightValue;
+
+  /// Backing memory of the offscreen image in headless mode.
+  VMAHandle pImageMem;
 };
 
 struct RendererItemContext {
+  /// Owns the primary command buffer, reset as a whole once the frame completed.
+  VkCommandPool pCommandPool;
   VkCommandBuffer pCommandBuffer;
+
+  /// Static content of the main subpass, reused as long as `uStaticGeneration` is current.
+  VkCommandBuffer pStaticCmdBuffer;
+  uint64_t uStaticGeneration;
+  VkSemaphore pImageAvailableSem;
   VkSemaphore pRenderFinishedSem;
-  VkFence pCmdBufferInFightFence;
+  /// Graphics timeline value signaled once the frame completes, zero before the first use.
+  uint64_t uFrameTimelineValue;
+
+  /// Async compute work of the frame, the graphics submission waits for it at `ComputeWaitStage`,
+  /// which is zero when nothing was submitted.
+  VkCommandBuffer pComputeCommandBuffer;
+  uint64_t uComputeTimelineValue;
+  VkPipelineStageFlags ComputeWaitStage;
+
+  /// Pre-recorded timestamps around the graphics work.
+  VkCommandBuffer aTimestampCmdBuffers[2];
+  bool bTimestampsWritten;
+  bool bFrameResolved; /// The GPU times of the frame were read back.
 
   void *pUserContext;
 };
 
+/// GPU timings of the async compute and the graphics work, averaged over the frames since the
+/// previous query.
+struct AsyncComputeStats {
+  float ComputeMs;
+  float GraphicsMs;
+  float OverlapMs;    /// Time both queues were busy.
+  float OverlapRatio; /// Part of the compute work hidden behind the graphics work.
+  uint32_t FrameCount;
+  /// The timestamps of both queues are comparable, otherwise the overlap is left at zero.
+  bool OverlapMeasured;
+};
+
+/// Bound of the presents queued ahead of the display, frame rate traded against latency.
+enum class PresentLatencyPolicy {
+  Throughput, /// Only bounded by the frame ring.
+  Balanced,   /// Two frames queued at most.
+  LowLatency, /// A single frame queued, and the CPU frame starts just in time.
+};
+
+/// Input sampling to presentation, averaged over the frames since the previous query.
+struct PresentLatencyStats {
+  float InputToPresentMs;
+  float MaxInputToPresentMs;
+  float FrameStartDelayMs; /// Sleep inserted before the frame start by the low latency policy.
+  uint32_t FrameCount;
+  bool PresentWait; /// Measured by VK_KHR_present_wait, otherwise up to the end of the GPU work.
+};
+
+/// Capabilities of the chosen physical device, for the paths adapting to it.
+struct PhysicalDeviceCaps {
+  char DeviceName[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+  uint32_t DeviceIndex; /// In the enumeration order.
+  VkPhysicalDeviceType DeviceType;
+  int64_t Score;
+  bool Forced; /// Picked by name or index rather than by the score.
+  VkDeviceSize DeviceLocalBytes; /// Largest device local heap.
+  bool UnifiedMemory; /// Device local memory is system memory, integrated GPUs and CPUs.
+  bool DedicatedTransferQueue; /// A transfer only queue family exists.
+  bool DedicatedComputeQueue;  /// A compute queue family without graphics exists.
+  bool LazilyAllocatedMemory;  /// Transient attachments may stay in tile memory.
+};
+
+/// Memory of the MSAA color and depth stencil attachments at some size.
+struct AttachmentMemoryEstimate {
+  VkDeviceSize DedicatedBytes; /// An allocation per attachment.
+  VkDeviceSize PackedBytes;    /// Aliased into the transient blocks.
+  /// Backed by memory, fewer than the packed bytes when lazily allocated. Only measured for the
+  /// current attachments, an estimate assumes every packed byte is committed.
+  VkDeviceSize CommittedBytes;
+  bool LazilyAllocated;        /// The blocks are lazily allocated, mostly never committed.
+};
+
+/// Fixed function state of a draw, dynamic with VK_EXT_extended_dynamic_state.
+struct RasterDynamicState {
+  VkCullModeFlags CullMode;
+  VkFrontFace FrontFace;
+  VkBool32 DepthTestEnable;
+  VkBool32 DepthWriteEnable;
+  VkCompareOp DepthCompareOp;
+};
+
 class VulkanRenderContext {
 public:
   VulkanRenderContext();
@@ -30,7 +171,11 @@ public:
   virtual VKHRESULT Initialize();
 
   VKHRESULT Destroy();
+  /// Block until every submitted frame completed on the GPU, and record their statistics.
+  VKHRESULT WaitIdle();
 
+  /// Only records the new size, the swap chain is recreated before the next acquisition. Before
+  /// `Initialize` it sizes the first swap chain, or offscreen images, instead.
   virtual VKHRESULT Resize(int cx, int cy);
   virtual VKHRESULT FrameMoved(int xdelta, int ydelta, void *userData) = 0;
   virtual VKHRESULT FrameZoomed(int xdelta, int ydelta, void *userData) = 0;
@@ -41,9 +186,104 @@ public:
   VKHRESULT SetMsaaEnabled(bool bEnabled);
   bool IsMsaaEnabled() const;
 
+  /// Set the depth of the frame ring, must be called before `Initialize`.
+  VKHRESULT SetFramesInFlight(uint32_t uFrameCount);
+  uint32_t GetFrameCount() const;
+
+  /// Render into offscreen images without any surface or swap chain, must be called before
+  /// `Initialize`.
+  VKHRESULT SetHeadlessEnabled(bool bEnabled);
+  bool IsHeadless() const;
+
+  /// Force a device by its enumeration index or a case insensitive part of its name, must be
+  /// called before `Initialize`. Falls back to the best scored device when none suitable matches.
+  VKHRESULT SetPreferredDevice(_In_z_ const char *pszDevice);
+  const PhysicalDeviceCaps &GetDeviceCaps() const;
+  /// Attachments of a swap chain of the size and sample count on the current device, created
+  /// without memory to query their requirements.
+  VKHRESULT EstimateAttachmentMemory(uint32_t uWidth, uint32_t uHeight, uint32_t uSamples,
+                                     _Out_ AttachmentMemoryEstimate *pEstimate) const;
+  /// The same figures for the attachments of the current swap chain, as committed so far.
+  void GetAttachmentMemory(_Out_ AttachmentMemoryEstimate *pUsage) const;
+
+  /// Create a compute queue besides the graphics one, must be called before `Initialize`.
+  VKHRESULT SetAsyncComputeEnabled(bool bEnabled);
+  /// True when compute work runs on a different queue family than graphics.
+  bool HasDedicatedComputeQueue() const;
+
+  bool GetAsyncComputeStats(_Out_opt_ AsyncComputeStats *pStats, bool bReset = true);
+
+  /// Threads recording the draws into secondary command buffers, the calling one included. Must
+  /// be called before `Initialize`, one records inline.
+  VKHRESULT SetRecordThreadCount(uint32_t uThreadCount);
+  uint32_t GetRecordThreadCount() const;
+
+  /// Times the scene draws its objects, to load the CPU side of the recording. Must be called
+  /// before `Initialize`, the per-draw resources are sized by it.
+  VKHRESULT SetDrawCount(uint32_t uDrawCount);
+  uint32_t GetDrawCount() const;
+
+  /// Threads running the startup tasks, the calling one included, zero for one per core. Must be
+  /// called before `Initialize`, one runs the startup serially.
+  VKHRESULT SetStartupThreadCount(uint32_t uThreadCount);
+  uint32_t GetStartupThreadCount() const;
+
+  /// Record the main subpass once per frame slot and reuse it until invalidated, for scenes whose
+  /// draw list never changes. Per-frame data must come from the slot's uniforms.
+  void SetStaticCommandsEnabled(bool bEnabled);
+  bool IsStaticCommandsEnabled() const;
+  /// Re-record the static commands of every slot before its next use, call it whenever anything
+  /// they reference changes. Swap chain recreation does it implicitly.
+  void InvalidateStaticCommands();
+
+  /// Cap on the device memory allocated by the context, zero lifts it. Allocations past it fail
+  /// with VK_ERROR_OUT_OF_DEVICE_MEMORY. See `GetVmaHeapBudgets` and `GetVmaCategoryUsage`.
+  void SetMemoryBudget(uint64_t cbBudget);
+  uint64_t GetMemoryBudget() const;
+  /// The heap budgets come from the driver rather than an estimate.
+  bool IsMemoryBudgetExtensionEnabled() const;
+  /// Trace the heaps and categories every `uFrameCount` frames, zero never does.
+  void SetMemoryLogInterval(uint32_t uFrameCount);
+
+  /// Per-pass GPU timings of the graphics queue.
+  VkGpuProfiler *GetGpuProfiler();
+  /// CPU, GPU and present times per frame, with their percentiles and hitches, and where the
+  /// CPU was blocked.
+  VkFrameStats *GetFrameStats();
+  /// Over the last `uLastFrames`, every recorded frame when zero, from `uFirstFrame` on. False
+  /// before the first frame completed.
+  bool CalcFrameStats(_Out_ FrameStatsSummary *pSummary, uint32_t uLastFrames = 0,
+                      uint64_t uFirstFrame = 0) const;
+  /// Lower bound of the graphics timeline value of the next frame, which identifies it in the
+  /// frame statistics.
+  uint64_t GetNextFrameValue() const;
+
+  /// File the pipeline cache is loaded from and saved to, must be called before `Initialize`.
+  /// Empty keeps it in memory only.
+  VKHRESULT SetPipelineCacheFile(_In_z_ const char *pszFileName);
+  /// Shared by every pipeline creation.
+  VkPersistentPipelineCache *GetPipelineCache();
+  /// Background pipeline compilation through the pipeline cache.
+  VkPipelineCompiler *GetPipelineCompiler();
+  /// Timed startup tasks of the sample, empty when it initializes sequentially.
+  const std::vector<TaskTiming> &GetStartupTimeline() const;
+
+  /// Changes the present mode as well, the swap chain is recreated before the next frame.
+  void SetPresentLatencyPolicy(PresentLatencyPolicy policy);
+  PresentLatencyPolicy GetPresentLatencyPolicy() const;
+  /// Block until the queued presents are within the policy, and for the low latency policy until
+  /// the frame is needed. Call it right before sampling the input.
+  void WaitForFrameStart();
+  /// The input of the next presented frame was sampled now.
+  void MarkInputSampled();
+  bool GetPresentLatencyStats(_Out_opt_ PresentLatencyStats *pStats, bool bReset = true);
+
 protected:
-  /// Pick a properiate device
+  /// Hard requirements of a device, finds its graphics and present queue families.
   virtual bool IsDeviceSuitable(VkPhysicalDevice device);
+  /// Rank of a suitable device by type, memory heaps, queue families and features. The type
+  /// dominates, the rest breaks ties between devices of the same type.
+  virtual int64_t ScoreDevice(VkPhysicalDevice device, PhysicalDeviceCaps *pCaps);
 
   /// Clean up render context.
   virtual void Cleanup();
@@ -58,26 +298,87 @@ protected:
   VKHRESULT CreateGraphicsQueueCommandPool();
 
   VKHRESULT CreateSwapChain();
+  VKHRESULT CreateOffscreenImages();
+  VKHRESULT CreateSwapChainAttachments();
   VKHRESULT CreateSwapChainImageViews();
   VKHRESULT CreateSwapChainFBsCompatibleRenderPass();
-  VKHRESULT CreateSwapChainFrameBuffers();
   VKHRESULT CreateGraphicsQueueCommandBuffers();
   VKHRESULT CreateSwapChainSyncObjects();
+  /// Hand the swap chain over to a new one, the old objects are retired by the graphics timeline
+  /// and the old swap chain once its presents completed.
   VKHRESULT RecreateSwapChain();
+  /// Retire the objects sized by the swap chain, the render pass is kept unless `bRenderPass`.
+  void RetireSwapChainAttachments(bool bRenderPass);
+  /// Destroy everything at once, the device must be idle.
   void CleanupSwapChain();
-  VKHRESULT CreateDepthStencilBuffer();
+  /// Destroy the swap chains replaced by `CreateSwapChain` whose presents completed.
+  void CollectOldSwapChains();
+  /// Called once the swap chain and its attachments were recreated, size dependent objects
+  /// should be recreated here.
+  virtual VKHRESULT OnSwapChainRecreated();
+  VKHRESULT FindDepthStencilFormat(_Out_ VkFormat *pFormat) const;
+  /// MSAA color, UINT32_MAX when single sampled, and depth stencil of a swap chain.
+  void AddTransientAttachments(VkTransientAllocator *pAllocator, VkExtent2D extent,
+                               VkSampleCountFlagBits samples, VkFormat depthStencilFormat,
+                               _Out_ uint32_t *puMsaaColor, _Out_ uint32_t *puDepthStencil) const;
+  VKHRESULT CreateDepthStencilView();
 
   bool CheckMultisampleSupport(VkPhysicalDevice, uint32_t *puMaxMsaaQualityLevel);
 
-  VKHRESULT CreateMsaaColorBuffer();
+  VKHRESULT CreateMsaaColorView();
 
   VKHRESULT PrepareNextFrame(_Inout_opt_ SwapChainItemContext **ppSwapchainContext);
+  /// Forget the blocking of a frame `PrepareNextFrame` gave up on.
+  void SkipFrame();
+  /// Next offscreen image, headless stand-in for `vkAcquireNextImageKHR`.
+  VKHRESULT AcquireOffscreenImage(uint32_t *puImageIndex);
   VKHRESULT WaitForPreviousGraphicsCommandBufferFence(_In_ RendererItemContext *pRendererContext);
   VKHRESULT Present();
 
-  float GetAspectRatio() const;
+  VKHRESULT CreateAsyncComputeObjects();
+  VKHRESULT RecordTimestampCommandBuffers();
+
+  /// Begin the compute command buffer of the current frame, after its fence was waited. Returns
+  /// null when async compute is disabled.
+  VkCommandBuffer BeginAsyncCompute();
+  /// Submit the compute work, the graphics work of the frame waits for it at `graphicsWaitStage`.
+  /// Resources shared with the graphics queue family must be concurrent or transferred.
+  VKHRESULT SubmitAsyncCompute(VkPipelineStageFlags graphicsWaitStage);
+  /// Submit the frame's graphics command buffer behind the acquired image and the compute work.
+  VKHRESULT SubmitGraphicsCommandBuffer(_In_ RendererItemContext *pRendererContext);
+  void ResolveFrameTimestamps(_In_ RendererItemContext *pRendererContext);
+  /// Read back the GPU times of the slot's completed frame, once.
+  void ResolveFrame(_In_ RendererItemContext *pRendererContext);
+  /// Secondary command buffer with the current slot's static commands, `fnRecord` only runs when
+  /// they were invalidated. Execute it in a subpass begun with secondary command buffers.
+  VKHRESULT PrepareStaticCommandBuffer(const std::function<void(VkCommandBuffer)> &fnRecord,
+                                       VkCommandBuffer *ppCmdBuffer);
+  /// Import the frame's back buffer, presented or read back after the frame, and the MSAA color,
+  /// InvalidResource when single sampled, and depth stencil, whose contents are discarded.
+  void ImportSwapChainAttachments(_In_ const SwapChainItemContext *pSwapchainContext,
+                                  _Out_ VkRenderGraph::ResourceId *pBackBuffer,
+                                  _Out_ VkRenderGraph::ResourceId *pMsaaColor,
+                                  _Out_ VkRenderGraph::ResourceId *pDepthStencil);
+
+  /// A present queued for the display, retired by `WaitForFrameStart`.
+  struct QueuedPresent {
+    uint64_t uPresentId;     /// Zero when it can only be tracked by the graphics timeline.
+    uint64_t uTimelineValue; /// Graphics timeline value of the frame.
+    double InputSampledTime; /// Negative when the input was not marked.
+    double FrameStartTime;
+  };
+  uint32_t GetMaxQueuedPresents() const;
+  /// Returns true once the present completed, recording its latency.
+  bool RetireQueuedPresent(const QueuedPresent &present, bool bBlock);
+
+  /// Dynamic states every graphics pipeline is created with.
+  const std::vector<VkDynamicState> &GetPipelineDynamicStates() const;
+  /// Viewport and scissor of the swap chain, set in every command buffer drawing into it.
+  void CmdSetViewportState(VkCommandBuffer pCmdBuffer);
+  /// No-op without extended dynamic state, the pipelines must then bake the same `state`.
+  void CmdSetRasterState(VkCommandBuffer pCmdBuffer, const RasterDynamicState &state);
 
-  void CalcFrameStats();
+  float GetAspectRatio() const;
 
   uint32_t FindMemoryTypeIndex(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
@@ -87,16 +388,43 @@ protected:
     uint32_t MsaaQaulityLevel; /// MSAA Quality level.
     bool VsyncEnabled;     /// Enable Vsynchronization
     bool RaytracingEnabled; /// Enable Ray Tracing
+    uint32_t FramesInFlight; /// Frames recorded ahead of the GPU, 1 to VK_MAX_FRAMES_IN_FLIGHT.
+    bool HeadlessEnabled;    /// Render offscreen, no surface nor swap chain.
+    bool AsyncComputeEnabled; /// Create the async compute queue.
+    bool PipelineStatisticsEnabled; /// pipelineStatisticsQuery is supported and enabled.
+    bool InheritedQueriesEnabled; /// Queries may stay active across secondary command buffers.
+    uint32_t RecordThreadCount; /// Threads recording secondary command buffers.
+    uint32_t DrawCount; /// Times the scene draws its objects, at least one.
+    uint32_t StartupThreadCount; /// Threads running the startup tasks, zero for one per core.
+    bool StaticCommandsEnabled; /// Reuse the recorded main subpass across frames.
+    PresentLatencyPolicy PresentLatency;
+    bool PresentWaitEnabled; /// VK_KHR_present_id and VK_KHR_present_wait are enabled.
+    bool ExtendedDynamicStateEnabled; /// VK_EXT_extended_dynamic_state is enabled.
+    bool Synchronization2Enabled; /// VK_KHR_synchronization2 is enabled.
+    bool MemoryBudgetEnabled; /// VK_EXT_memory_budget is enabled.
+    bool CalibratedTimestampsEnabled; /// VK_EXT_calibrated_timestamps is enabled.
+    uint32_t MemoryLogInterval; /// Frames between memory usage traces, zero for none.
   };
 
   uint32_t m_iClientWidth;
   uint32_t m_iClientHeight;
 
   DeviceFeatureConfig m_aDeviceConfig;
+  /// Name part or index, empty picks by the score.
+  std::string m_PreferredDevice;
+  PhysicalDeviceCaps m_DeviceCaps;
+  std::vector<TaskTiming> m_aStartupTimeline;
 
   /// Vulkan staffs.
   VkViewport m_Viewport;
   VkRect2D m_ScissorRect;
+  std::vector<VkDynamicState> m_aPipelineDynamicStates;
+  PFN_vkCmdSetCullModeEXT m_pfnCmdSetCullModeEXT;
+  PFN_vkCmdSetFrontFaceEXT m_pfnCmdSetFrontFaceEXT;
+  PFN_vkCmdSetDepthTestEnableEXT m_pfnCmdSetDepthTestEnableEXT;
+  PFN_vkCmdSetDepthWriteEnableEXT m_pfnCmdSetDepthWriteEnableEXT;
+  PFN_vkCmdSetDepthCompareOpEXT m_pfnCmdSetDepthCompareOpEXT;
+  PFN_vkCmdPipelineBarrier2KHR m_pfnCmdPipelineBarrier2KHR;
 
   VkInstance m_pVkInstance;
   VkDebugUtilsMessengerEXT m_pDebugMessenger;
@@ -104,25 +432,103 @@ protected:
   VkDevice m_pDevice;
   int m_iGraphicQueueFamilyIndex;
   int m_iPresentQueueFamilyIndex;
+  int m_iTransferQueueFamilyIndex; /// Equals to the graphics one without a dedicated family.
   VkQueue m_pGraphicQueue;
   VkQueue m_pPresentQueue; /// Used for presentation.
+  VkQueue m_pTransferQueue; /// Used for resource uploads.
+  int m_iComputeQueueFamilyIndex;
+  VkQueue m_pComputeQueue; /// Used for async compute.
 
-  VkCommandPool m_pCommandPool;
+  /// Uploads of the static resources.
+  VkUploadContext m_UploadContext;
 
-  /// Renderer command bufferss.
-  RendererItemContext m_aRendererItemCtx[2];
+  /// Pre-recorded command buffers, the per-frame ones are allocated from the ring slots' pools.
+  VkCommandPool m_pCommandPool;
+  VkCommandPool m_pComputeCommandPool;
+
+  /// One timeline per queue, every submission signals the next value.
+  VkTimeline m_GraphicsTimeline;
+  VkTimeline m_ComputeTimeline;
+
+  /// Loaded after the device was created, saved on cleanup.
+  VkPersistentPipelineCache m_PipelineCache;
+  std::string m_PipelineCacheFileName;
+  /// Owns the pipelines submitted to it.
+  VkPipelineCompiler m_PipelineCompiler;
+
+  /// Scopes are recorded by `RenderFrame`, one query pool per frame slot.
+  VkGpuProfiler m_GpuProfiler;
+  VkFrameStats m_FrameStats;
+  /// Accumulated by the blocking calls of the frame being recorded.
+  FrameStalls m_FrameStalls;
+
+  /// Per-thread, per-frame command pools of the secondary command buffers.
+  VkParallelRecorder m_ParallelRecorder;
+  /// Rebuilt by `RenderFrame`, its transient resources and framebuffers are per frame slot.
+  VkRenderGraph m_RenderGraph;
+  /// Per-frame constants bound by dynamic offsets, the slot's region is rewound once it was waited.
+  VkFrameRingBuffer m_FrameUniforms;
+  /// Meshes share its vertex and index buffers, uploaded through `m_UploadContext`.
+  VkGeometryPool m_GeometryPool;
+  /// Bumped by `InvalidateStaticCommands`.
+  uint64_t m_uStaticGeneration;
+
+  /// Four timestamps per frame, compute begin/end and graphics begin/end.
+  VkQueryPool m_pFrameTimestampQueryPool;
+  float m_fTimestampPeriod; /// Nanoseconds per tick.
+  /// Compute and graphics timestamps share a time domain, the overlap is measured.
+  bool m_bQueueTimestampsComparable;
+  PFN_vkGetCalibratedTimestampsEXT m_pfnGetCalibratedTimestampsEXT;
+  struct {
+    double ComputeMs;
+    double GraphicsMs;
+    double OverlapMs;
+    uint32_t FrameCount;
+  } m_AsyncComputeTimings;
+
+  /// Present pacing, times are seconds of `m_PresentTimer`.
+  PFN_vkWaitForPresentKHR m_pfnWaitForPresentKHR;
+  GameTimer m_PresentTimer;
+  std::deque<QueuedPresent> m_aQueuedPresents;
+  uint64_t m_uLastPresentId;
+  /// Last present id queued to `m_pSwapChain`, zero when none.
+  uint64_t m_uSwapChainLastPresentId;
+  /// A swap chain replaced by a newer one, alive until its pending presents completed.
+  struct OldSwapChain {
+    VkSwapchainKHR pSwapChain;
+    uint64_t uLastPresentId; /// Zero without present ids or when nothing was presented to it.
+    uint32_t uNewerPresentCount; /// Presents to newer swap chains, counted up to the release.
+    uint64_t uTimelineValue; /// Frame of the releasing present to a newer swap chain, zero before.
+  };
+  std::deque<OldSwapChain> m_aOldSwapChains;
+  uint64_t m_uMemoryLogFrame;
+  double m_InputSampledTime;
+  double m_FrameStartTime;
+  double m_LastPresentTime;
+  struct {
+    double IntervalMs; /// Moving averages between two presents and of a frame's work.
+    double FrameWorkMs;
+    double TotalMs;
+    double MaxMs;
+    double DelayMs;
+    uint32_t FrameCount;
+  } m_PresentLatency;
+
+  /// Renderer command bufferss, one ring slot per frame in flight.
+  std::vector<RendererItemContext> m_aRendererItemCtx;
   uint32_t m_iCurrRendererItem;
 
   uint32_t m_iCurrSwapChainItem;
 
+  /// MSAA color and depth stencil, owned by the transient attachments.
+  VkTransientAllocator m_TransientAttachments;
+
   /// MSAA resolve texture.
   VkImage m_pMsaaColorBuffer;
-  VMAHandle m_pMsaaColorBufferMem;
   VkImageView m_pMsaaColorView;
 
   /// Depth and stencil buffer.
   VkImage m_pDepthStencilImage;
-  VMAHandle m_pDepthStencilBufferMem;
   VkImageView m_pDepthStencilImageView;
 
   /// Surface.
@@ -130,9 +536,13 @@ protected:
   /// Swap chain.
   VkSwapchainKHR m_pSwapChain;
   uint32_t m_iSwapChainImageCount;
-  SwapChainItemContext m_aSwapChainItemCtx[2];
+  std::vector<SwapChainItemContext> m_aSwapChainItemCtx;
   VkFormat m_aSwapChainImageFormat;
   VkFormat m_aDepthStencilFormat;
   VkExtent2D m_aSwapChainExtent;
   VkRenderPass m_pSwapChainFBsCompatibleRenderPass;
+  /// Recreate the swap chain before the next acquisition.
+  bool m_bSwapChainDirty;
+  /// Recreate the render pass along with it, the sample count changed.
+  bool m_bRenderPassDirty;
 };
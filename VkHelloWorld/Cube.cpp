@@ -1,33 +1,37 @@
 #include <VulkanRenderContext.hpp>
 #include <vector>
+#include <algorithm>
 #include <Camera.hpp>
-#include "VkUploadBuffer.h"
 #include <GeometryGenerator.hpp>
 #include <glm/glm.hpp>
 
 #include "VkTexture.h"
+#include "VkTaskGraph.h"
 
 struct ObjectConstants {
   glm::mat4 WorldViewProj;
   glm::mat4 TexTransform;
 };
 
-class FrameResources {
-public:
-  static VKHRESULT CreateBuffers(VkDevice pDevice, uint32_t uFrameCount) {
-    VKHRESULT hr;
+/// Fewer draws aren't worth waking a record thread for.
+static const uint32_t s_uMinDrawsPerThread = 64;
 
-    V_RETURN(ObjectUBs.CreateBuffer(pDevice, uFrameCount, sizeof(ObjectConstants), true));
+/// Matches the local size of box_animate.comp.
+static const uint32_t s_uAnimateGroupSize = 64;
 
-    return hr;
-  }
-
-  static void FreeBuffers() { ObjectUBs.FreeBuffer(); }
-
-  static VkUploadBuffer ObjectUBs;
+struct AnimateConstants {
+  float Time;
+  uint32_t DrawCount;
 };
 
-VkUploadBuffer FrameResources::ObjectUBs;
+/// Set per draw with extended dynamic state, baked into the PSOs otherwise.
+static const RasterDynamicState s_BoxRasterState = {
+    VK_CULL_MODE_BACK_BIT,           // CullMode;
+    VK_FRONT_FACE_COUNTER_CLOCKWISE, // FrontFace;
+    VK_TRUE,                         // DepthTestEnable;
+    VK_TRUE,                         // DepthWriteEnable;
+    VK_COMPARE_OP_LESS               // DepthCompareOp;
+};
 
 class CubeRenderContext : public VulkanRenderContext {
 public:
@@ -41,24 +45,25 @@ public:
 
     m_pDiffuseDescriptorSetLayout = VK_NULL_HANDLE;
     m_pDescriptorSetLayout = VK_NULL_HANDLE;
+    m_pAnimateDescriptorSetLayout = VK_NULL_HANDLE;
     m_pPipelineLayout = VK_NULL_HANDLE;
-    m_pPSO = VK_NULL_HANDLE;
+    m_pAnimatePipelineLayout = VK_NULL_HANDLE;
+    m_aPSOs[0] = m_aPSOs[1] = VkPipelineCompiler::InvalidHandle;
+    m_pAnimatePSO = VK_NULL_HANDLE;
 
-    m_pVertexBuffer = VK_NULL_HANDLE;
-    m_pIndexBuffer = VK_NULL_HANDLE;
+    m_pDrawOffsetsBuffer = VK_NULL_HANDLE;
+    m_pDrawOffsetsMem = nullptr;
+    m_cbDrawOffsetsPerFrame = 0;
 
-    m_pVertexUploadBuffer = VK_NULL_HANDLE;
-    m_pVertexUploadMem = VK_NULL_HANDLE;
-    m_pVertexBuffer = VK_NULL_HANDLE;
-    m_pVertexMem = VK_NULL_HANDLE;
-    m_pIndexUploadBuffer = VK_NULL_HANDLE;
-    m_pIndexUploadMem = VK_NULL_HANDLE;
-    m_pIndexBuffer = VK_NULL_HANDLE;
-    m_pIndexMem = VK_NULL_HANDLE;
+    m_BoxRange = {};
 
     m_pDescriptorPool = VK_NULL_HANDLE;
+    m_pObjectDescriptorSet = VK_NULL_HANDLE;
+    m_pDiffuseDiscriptorSet = VK_NULL_HANDLE;
+    m_pAnimateDescriptorSet = VK_NULL_HANDLE;
 
-    m_uIndexCount = 0;
+    m_ObjectConstants.WorldViewProj = glm::mat4(1.0f);
+    m_ObjectConstants.TexTransform = glm::mat4(1.0f);
 
     m_Camera.SetOrbit(glm::vec3(.0f), 5.0f, 0.25f * glm::pi<float>(), 1.25f * glm::pi<float>());
   }
@@ -66,96 +71,92 @@ public:
   virtual VKHRESULT Initialize() override {
 
     VKHRESULT hr;
-    V_RETURN(__super::Initialize());
-
-    /// Start Record initialize commands.
-    auto pCmdBuffer = m_aRendererItemCtx[m_iCurrRendererItem].pCommandBuffer;
-    auto pFence = m_aRendererItemCtx[m_iCurrRendererItem].pCmdBufferInFightFence;
-
-    VkCommandBufferBeginInfo cmdBeginInfo = {
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, // sType;
-        nullptr,                                     // pNext;
-        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // flags;
-        nullptr,                                     // pInheritanceInfo;
-    };
-    V(vkBeginCommandBuffer(pCmdBuffer, &cmdBeginInfo));
-
-    V_RETURN(CreateBuffers());
-    V_RETURN(LoadTextures());
-    V_RETURN(CreateStaticSamplers());
-
-    V_RETURN(CreatePSOs());
-    V_RETURN(CreateDescriptorPool());
-    V_RETURN(CreateDescriptorSets());
-
-    /// Submit intialize commands.
-    vkEndCommandBuffer(pCmdBuffer);
-
-    VkSubmitInfo submitInfo = {
-        VK_STRUCTURE_TYPE_SUBMIT_INFO, // sType;
-        nullptr,                       // pNext;
-        0,                             // waitSemaphoreCount;
-        nullptr,                       // pWaitSemaphores;
-        nullptr,                       // pWaitDstStageMask;
-        1,                             // commandBufferCount;
-        &pCmdBuffer,                   // pCommandBuffers;
-        0,                             // signalSemaphoreCount;
-        nullptr                        // pSignalSemaphores;
-    };
-
-    vkResetFences(m_pDevice, 1, &pFence);
-    V(vkQueueSubmit(m_pGraphicQueue, 1, &submitInfo, pFence));
-    vkWaitForFences(m_pDevice, 1, &pFence, false, UINT64_MAX);
-
-    /// Right not post some clean up.
-    PostInitialize();
+    VkTaskGraph startup;
+    VkTaskGraph::TaskId device, shaders, geometry, diffuseMap, maskMap, buffers, textures, samplers,
+        pipelines, animation, descriptors;
+
+    /// File reads, decoding and geometry overlap the device creation. Whatever records into the
+    /// upload context, or needs the window, stays on this thread.
+    device = startup.Add("Instance/device", [this]() {
+      VKHRESULT hr;
+      V_RETURN(VulkanRenderContext::Initialize());
+      m_Camera.SetLens(0.25f * glm::pi<float>(), GetAspectRatio(), 0.1f, 1000.0f);
+      return hr;
+    }, {}, true);
+    shaders = startup.Add("Load shaders", [this]() { return LoadShaders(); });
+    geometry = startup.Add("Generate geometry", [this]() {
+      m_BoxMesh = GeometryGenerator::CreateBox(2.0f, 2.0f, 2.0f, 0);
+      return (VKHRESULT)VK_SUCCESS;
+    });
+    diffuseMap = startup.Add("Decode flare.dds", [this]() {
+      return m_aDiffuseMap.DecodeDDSFile(L"Media/Textures/DX11/flare.dds");
+    });
+    maskMap = startup.Add("Decode flarealpha.dds", [this]() {
+      return m_aMaskDiffuseMap.DecodeDDSFile(L"Media/Textures/DX11/flarealpha.dds");
+    });
+    buffers = startup.Add("Upload geometry", [this]() { return CreateBuffers(); },
+                          {device, geometry}, true);
+    textures = startup.Add("Upload textures", [this]() { return UploadTextures(); },
+                           {device, diffuseMap, maskMap}, true);
+    samplers = startup.Add("Create samplers", [this]() { return CreateStaticSamplers(); }, {device});
+    /// Compiles in the background, the first frames clear until it is ready.
+    pipelines = startup.Add("Submit pipelines", [this]() { return CreatePSOs(); },
+                            {device, shaders});
+    /// Needs the set layout shared with the box's pipeline layout.
+    animation = startup.Add("Create animation", [this]() { return CreateAnimation(); },
+                            {pipelines});
+    descriptors = startup.Add("Create descriptors", [this]() {
+      VKHRESULT hr;
+      V_RETURN(CreateDescriptorPool());
+      V_RETURN(CreateDescriptorSets());
+      return hr;
+    }, {buffers, textures, samplers, pipelines, animation});
+    /// The first frame submitted afterwards waits for the uploads on the GPU.
+    startup.Add("Submit uploads", [this]() { return m_UploadContext.Submit(); }, {descriptors},
+                true);
+
+    hr = startup.Run(GetStartupThreadCount());
+    m_aStartupTimeline = startup.GetTimings();
 
     return hr;
   }
 
-  void PostInitialize() {
-
-    DestroyVmaBuffer(m_pVertexUploadBuffer, m_pVertexUploadMem);
-    m_pVertexUploadBuffer = nullptr;
-    m_pVertexUploadMem = nullptr;
-    DestroyVmaBuffer(m_pIndexUploadBuffer, m_pIndexUploadMem);
-    m_pIndexUploadBuffer = nullptr;
-    m_pIndexUploadMem = nullptr;
-
-    m_aDiffuseMap.DisposeUploaders();
-    m_aMaskDiffuseMap.DisposeUploaders();
-  }
-
   virtual void Cleanup() override {
 
-    FrameResources::FreeBuffers();
-
     for (auto &sampler : m_aStaticSamplers) {
       vkDestroySampler(m_pDevice, sampler, nullptr);
       sampler = VK_NULL_HANDLE;
     }
 
-    DestroyVmaBuffer(m_pVertexUploadBuffer, m_pVertexUploadMem);
-    DestroyVmaBuffer(m_pVertexBuffer, m_pVertexMem);
-    DestroyVmaBuffer(m_pIndexUploadBuffer, m_pIndexUploadMem);
-    DestroyVmaBuffer(m_pIndexBuffer, m_pIndexMem);
+    m_GeometryPool.Free(m_BoxRange);
+    m_BoxRange = {};
 
     m_aDiffuseMap.DisposeFinally(m_pDevice);
     m_aMaskDiffuseMap.DisposeFinally(m_pDevice);
 
     vkDestroyDescriptorPool(m_pDevice, m_pDescriptorPool, nullptr);
 
-    vkDestroyPipeline(m_pDevice, m_pPSO, nullptr);
+    if (m_pDrawOffsetsMem) {
+      DestroyVmaBuffer(m_pDrawOffsetsBuffer, m_pDrawOffsetsMem);
+      m_pDrawOffsetsBuffer = VK_NULL_HANDLE;
+      m_pDrawOffsetsMem = nullptr;
+    }
+    vkDestroyPipeline(m_pDevice, m_pAnimatePSO, nullptr);
+    vkDestroyPipelineLayout(m_pDevice, m_pAnimatePipelineLayout, nullptr);
+
+    /// The compiler owns the PSOs, pending ones may still use the layout.
+    m_PipelineCompiler.WaitIdle();
     vkDestroyPipelineLayout(m_pDevice, m_pPipelineLayout, nullptr);
     vkDestroyDescriptorSetLayout(m_pDevice, m_pDescriptorSetLayout, nullptr);
     vkDestroyDescriptorSetLayout(m_pDevice, m_pDiffuseDescriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_pDevice, m_pAnimateDescriptorSetLayout, nullptr);
 
-    __super::Cleanup();
+    VulkanRenderContext::Cleanup();
   }
 
   virtual void Update(float fTime, float fTimeElapsed) override {
 
-    ObjectConstants objConstants;
+    ObjectConstants &objConstants = m_ObjectConstants;
 
     objConstants.WorldViewProj = m_Camera.GetViewProj();
 
@@ -168,9 +169,8 @@ public:
     glm::mat4 matGLSLTexcoordsFixup(1.0f, .0f, .0f, .0f, .0f, -1.0f, .0f, .0f, .0f, .0f, 1.0f, .0f,
                                     .0f, 1.0f, .0f, 1.0f);
 
+    /// Copied into the frame's uniforms once the slot was waited by `RenderFrame`.
     objConstants.TexTransform = matGLSLTexcoordsFixup * matTrans2 * matRotate * matTrans1;
-
-    FrameResources::ObjectUBs.CopyData(&objConstants, sizeof(objConstants), m_iCurrRendererItem);
   }
 
   virtual void RenderFrame(float fTime, float fTimeElapsed) override {
@@ -179,75 +179,161 @@ public:
     RendererItemContext *pRendererContext = &m_aRendererItemCtx[m_iCurrRendererItem];
     VkCommandBuffer pCmdBuffer = pRendererContext->pCommandBuffer;
     SwapChainItemContext *pSwapchainContext;
+    VkCommandBuffer pComputeCmdBuffer;
+    uint32_t uObjectOffset;
+    /// The slot's draw offsets, written by this frame's animation only.
+    uint32_t uOffsetsOffset = m_iCurrRendererItem * (uint32_t)m_cbDrawOffsetsPerFrame;
 
-    V(PrepareNextFrame(&pSwapchainContext));
-
+    /// The ring slot owns the acquiring semaphore, so wait for the slot before acquiring.
     V(WaitForPreviousGraphicsCommandBufferFence(pRendererContext));
 
+    /// Skipped while the swap chain is out of date or the window is minimized.
+    hr = PrepareNextFrame(&pSwapchainContext);
+    if (!pSwapchainContext)
+      return;
+
+    /// First allocation of the frame, so the offset is the same for every frame of the slot, which
+    /// the static command buffers rely on.
+    V(m_FrameUniforms.Push(&m_ObjectConstants, sizeof(m_ObjectConstants), &uObjectOffset));
+
+    /// On the compute queue the animation overlaps the draws of the previous frame, the draws of
+    /// this frame wait for it at the vertex shader through the compute timeline.
+    pComputeCmdBuffer = BeginAsyncCompute();
+    if (pComputeCmdBuffer) {
+      CmdAnimate(pComputeCmdBuffer, fTimeElapsed);
+      if (HasDedicatedComputeQueue())
+        CmdTransferDrawOffsets(pComputeCmdBuffer, true);
+      V(SubmitAsyncCompute(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT));
+    }
+
     VkCommandBufferBeginInfo cmdBeginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr,
-                                             VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT, nullptr};
-    VkClearValue clearValue[2] = {};
-    VkRenderPassBeginInfo passBeginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-                                           nullptr,
-                                           m_pSwapChainFBsCompatibleRenderPass,
-                                           pSwapchainContext->pFrameBuffer,
-                                           m_ScissorRect,
-                                           2,
-                                           clearValue};
+                                             VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr};
+    VkRenderGraph::ResourceId backBuffer, msaaColor, depthStencil, color;
+    VkRenderGraph::ResourceId drawOffsets = VkRenderGraph::InvalidResource;
+    VkRenderGraph::PassId animatePass, mainPass;
+    VkClearColorValue clearColor;
+    /// Compiled in the background, the pass only clears until it is ready.
+    VkPipeline pPSO = m_PipelineCompiler.GetPipeline(m_aPSOs[IsMsaaEnabled()]);
+    bool bStatic = pPSO && IsStaticCommandsEnabled();
+    bool bParallel = pPSO && !bStatic && GetRecordThreadCount() > 1;
+    uint32_t uDrawCount = GetDrawCount();
+    /// Active queries only carry over into secondary command buffers with inherited queries.
+    bool bCollectStatistics =
+        !(bStatic || bParallel) || m_aDeviceConfig.InheritedQueriesEnabled;
 
     const glm::vec4 lightBlue{0.678431392f, 0.847058892f, 0.901960850f, 1.000000000f};
-    memcpy(&clearValue[0].color, &lightBlue, sizeof(glm::vec4));
-    clearValue[1].depthStencil.depth = 1.0f;
-    clearValue[1].depthStencil.stencil = 0;
+    memcpy(&clearColor, &lightBlue, sizeof(glm::vec4));
+
+    /// One draw per item, recorded inline or split across the record threads.
+    auto fnRecordDraws = [this, pPSO, uObjectOffset, uOffsetsOffset](
+                             VkCommandBuffer pCmdBuffer, uint32_t uBegin, uint32_t uEnd) {
+      VkDescriptorSet descriptorSets[3] = {m_pObjectDescriptorSet, m_pDiffuseDiscriptorSet,
+                                           m_pAnimateDescriptorSet};
+      uint32_t dynamicOffsets[2] = {uObjectOffset, uOffsetsOffset};
+
+      vkCmdBindDescriptorSets(pCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0,
+                              _countof(descriptorSets), descriptorSets, _countof(dynamicOffsets),
+                              dynamicOffsets);
+      vkCmdBindPipeline(pCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPSO);
+      /// Dynamic state is not inherited, every secondary command buffer sets its own.
+      CmdSetViewportState(pCmdBuffer);
+      CmdSetRasterState(pCmdBuffer, s_BoxRasterState);
+      /// Every mesh lives in the pool's buffers, bound once.
+      m_GeometryPool.CmdBind(pCmdBuffer);
+      /// The first instance selects the draw's animated offset.
+      for (uint32_t i = uBegin; i < uEnd; ++i)
+        m_GeometryPool.CmdDraw(pCmdBuffer, m_BoxRange, 1, i);
+    };
 
-    /// Reset command buffer.
-    V(vkResetCommandBuffer(pCmdBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT));
+    /// The attachments are declared anew every frame, the graph derives the barriers.
+    m_RenderGraph.Reset();
+    ImportSwapChainAttachments(pSwapchainContext, &backBuffer, &msaaColor, &depthStencil);
+    color = IsMsaaEnabled() ? msaaColor : backBuffer;
+
+    /// Without a compute queue the animation runs ahead of the draws, the graph orders them.
+    if (!pComputeCmdBuffer) {
+      drawOffsets = m_RenderGraph.ImportBuffer(
+          "DrawOffsets", m_pDrawOffsetsBuffer, m_cbDrawOffsetsPerFrame * m_aRendererItemCtx.size(),
+          {VK_IMAGE_LAYOUT_UNDEFINED, 0, 0}, false);
+      animatePass = m_RenderGraph.AddPass(
+          "Animate", RenderGraphPassType::Compute, [&](const RenderGraphPassContext &context) {
+            CmdAnimate(context.pCmdBuffer, fTimeElapsed);
+          });
+      m_RenderGraph.UseBuffer(animatePass, drawOffsets, RenderGraphAccess::ShaderWrite);
+    }
 
+    mainPass = m_RenderGraph.AddPass(
+        "MainPass", RenderGraphPassType::Graphics,
+        [&](const RenderGraphPassContext &context) {
+          VkCommandBuffer pStaticCmdBuffer;
+          VkCommandBufferInheritanceInfo inheritanceInfo = {
+              VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO, // sType;
+              nullptr,                                           // pNext;
+              context.pRenderPass,                               // renderPass;
+              0,                                                 // subpass;
+              context.pFramebuffer,                              // framebuffer;
+              VK_FALSE,                                          // occlusionQueryEnable;
+              0,                                                 // queryFlags;
+              bCollectStatistics ? m_GpuProfiler.GetPipelineStatisticsFlags()
+                                 : 0 // pipelineStatistics;
+          };
+
+          if (bStatic) {
+            /// Recorded once per slot, the per-frame data lives in the slot's uniform buffer.
+            V(PrepareStaticCommandBuffer(
+                [&](VkCommandBuffer pSecondaryCmdBuffer) {
+                  fnRecordDraws(pSecondaryCmdBuffer, 0, uDrawCount);
+                },
+                &pStaticCmdBuffer));
+            vkCmdExecuteCommands(context.pCmdBuffer, 1, &pStaticCmdBuffer);
+          } else if (bParallel) {
+            V(m_ParallelRecorder.Record(m_iCurrRendererItem, inheritanceInfo, uDrawCount,
+                                        s_uMinDrawsPerThread, fnRecordDraws));
+            m_ParallelRecorder.CmdExecute(context.pCmdBuffer);
+          } else if (pPSO) {
+            fnRecordDraws(context.pCmdBuffer, 0, uDrawCount);
+          }
+        },
+        (bStatic || bParallel) ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                               : VK_SUBPASS_CONTENTS_INLINE);
+    m_RenderGraph.UseColorAttachment(mainPass, color, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor,
+                                     IsMsaaEnabled() ? backBuffer
+                                                     : VkRenderGraph::InvalidResource);
+    m_RenderGraph.UseDepthStencilAttachment(mainPass, depthStencil, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    if (drawOffsets != VkRenderGraph::InvalidResource)
+      m_RenderGraph.UseBuffer(mainPass, drawOffsets, RenderGraphAccess::ShaderRead);
+
+    /// The slot's command pool was reset after its frame completed.
     V(vkBeginCommandBuffer(pCmdBuffer, &cmdBeginInfo));
 
-    vkCmdBeginRenderPass(pCmdBuffer, &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkDescriptorSet descriptorSets[2] = {m_aDescriptorSets[m_iCurrRendererItem],
-                                         m_pDiffuseDiscriptorSet};
-
-    vkCmdBindDescriptorSets(pCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0,
-                            _countof(descriptorSets), descriptorSets, 0, nullptr);
+    /// The compute queue family released the offsets, the submission waits for it.
+    if (pComputeCmdBuffer && HasDedicatedComputeQueue())
+      CmdTransferDrawOffsets(pCmdBuffer, false);
 
-    vkCmdBindPipeline(pCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPSO);
+    m_GpuProfiler.CmdResetFrame(pCmdBuffer, m_iCurrRendererItem);
+    uint32_t uMainPassScope =
+        m_GpuProfiler.CmdBeginScope(pCmdBuffer, "MainPass", bCollectStatistics);
 
-    VkDeviceSize vbOffsets[] = {0};
-    vkCmdBindVertexBuffers(pCmdBuffer, 0, 1, &m_pVertexBuffer, vbOffsets);
-    vkCmdBindIndexBuffer(pCmdBuffer, m_pIndexBuffer, 0, VK_INDEX_TYPE_UINT16);
-    vkCmdDrawIndexed(pCmdBuffer, m_uIndexCount, 1, 0, 0, 0);
+    /// The slot was waited above, its transient resources and framebuffers are free.
+    V(m_RenderGraph.Execute(pCmdBuffer, m_iCurrRendererItem));
 
-    vkCmdEndRenderPass(pCmdBuffer);
+    m_GpuProfiler.CmdEndScope(pCmdBuffer, uMainPassScope);
 
     V(vkEndCommandBuffer(pCmdBuffer));
 
-    VkSubmitInfo commitInfo = {};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    commitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    commitInfo.waitSemaphoreCount = 1;
-    commitInfo.pWaitSemaphores = &pSwapchainContext->pImageAvailableSem;
-    commitInfo.pWaitDstStageMask = waitStages;
-    commitInfo.commandBufferCount = 1;
-    commitInfo.pCommandBuffers = &pCmdBuffer;
-    commitInfo.signalSemaphoreCount = 1;
-    commitInfo.pSignalSemaphores = &pRendererContext->pRenderFinishedSem;
-
-    V(vkQueueSubmit(m_pGraphicQueue, 1, &commitInfo, pRendererContext->pCmdBufferInFightFence));
+    /// Waits for the acquired image and the async compute work of the frame, if any.
+    V(SubmitGraphicsCommandBuffer(pRendererContext));
 
     V(Present());
   }
 
-  virtual VKHRESULT Resize(int cx, int cy) {
+  virtual VKHRESULT OnSwapChainRecreated() override {
 
     VKHRESULT hr;
 
-    V_RETURN(__super::Resize(cx, cy));
-
     m_Camera.SetLens(0.25f * glm::pi<float>(), GetAspectRatio(), 0.1f, 1000.0f);
 
+    /// Viewport and scissor are dynamic, only a sample count not seen before needs a PSO.
     V(CreatePSOs());
 
     return hr;
@@ -263,16 +349,25 @@ public:
   }
 
 private:
-  VKHRESULT LoadTextures() {
+  VKHRESULT LoadShaders() {
     VKHRESULT hr;
-    VkCommandBuffer pCmdBuffer = m_aRendererItemCtx[m_iCurrRendererItem].pCommandBuffer;
 
-    V_RETURN(m_aDiffuseMap.LoadFromDDSFile(
-        m_pDevice, pCmdBuffer, L"Media/Textures/DX11/flare.dds", VK_ACCESS_SHADER_READ_BIT,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+    V_RETURN(LoadSPIRVFile(L"shaders/box.vert.spv", &m_aBoxShaderCode[0]));
+    V_RETURN(LoadSPIRVFile(L"shaders/box.frag.spv", &m_aBoxShaderCode[1]));
+    V_RETURN(LoadSPIRVFile(L"shaders/box_animate.comp.spv", &m_aAnimateShaderCode));
 
-    V_RETURN(m_aMaskDiffuseMap.LoadFromDDSFile(
-        m_pDevice, pCmdBuffer, L"Media/Textures/DX11/flarealpha.dds", VK_ACCESS_SHADER_READ_BIT,
+    return hr;
+  }
+
+  VKHRESULT UploadTextures() {
+    VKHRESULT hr;
+
+    V_RETURN(m_aDiffuseMap.UploadDecoded(m_pDevice, &m_UploadContext, VK_ACCESS_SHADER_READ_BIT,
+                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+
+    V_RETURN(m_aMaskDiffuseMap.UploadDecoded(
+        m_pDevice, &m_UploadContext, VK_ACCESS_SHADER_READ_BIT,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
 
     return hr;
@@ -282,25 +377,12 @@ private:
 
     VKHRESULT hr;
     using Vertex = GeometryGenerator::Vertex;
-    auto box = GeometryGenerator::CreateBox(2.0f, 2.0f, 2.0f, 0);
-    auto &vertices = box.Vertices;
-    auto &indices = box.GetIndices16();
-
-    size_t vbSize = vertices.size() * sizeof(Vertex);
-    size_t ibSize = indices.size() * sizeof(uint16_t);
+    auto &vertices = m_BoxMesh.Vertices;
+    auto &indices = m_BoxMesh.Indices32;
 
-    auto pCmdBuffer = m_aRendererItemCtx[m_iCurrRendererItem].pCommandBuffer;
-
-    V_RETURN(CreateDefaultBuffer(m_pDevice, pCmdBuffer, vertices.data(), vbSize,
-                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pVertexUploadBuffer,
-                                 &m_pVertexUploadMem, &m_pVertexBuffer, &m_pVertexMem));
-
-    V_RETURN(CreateDefaultBuffer(m_pDevice, pCmdBuffer, indices.data(), ibSize,
-                                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &m_pIndexUploadBuffer,
-                                 &m_pIndexUploadMem, &m_pIndexBuffer, &m_pIndexMem));
-    m_uIndexCount = (uint32_t)indices.size();
-
-    V_RETURN(FrameResources::CreateBuffers(m_pDevice, _countof(m_aRendererItemCtx)));
+    V_RETURN(m_GeometryPool.Allocate(&m_UploadContext, vertices.data(), (uint32_t)vertices.size(),
+                                     sizeof(Vertex), indices.data(), (uint32_t)indices.size(),
+                                     &m_BoxRange));
 
     return hr;
   }
@@ -338,134 +420,80 @@ private:
     return hr;
   }
 
+  /// Submits the PSO of the current sample count to the background compiler, if not yet.
   VKHRESULT CreatePSOs() {
-    VKHRESULT hr;
-    VkShaderModule shaderModules[2] = {0};
-    /// Shader Stages.
-    VkPipelineShaderStageCreateInfo shaderStageInfos[2] = {};
-    VkPipelineVertexInputStateCreateInfo VIinfo = {};
-    VkPipelineInputAssemblyStateCreateInfo IAinfo = {};
-    VkPipelineViewportStateCreateInfo VPinfo = {};
-    VkPipelineRasterizationStateCreateInfo RSinfo = {};
-    VkPipelineMultisampleStateCreateInfo MSAAinfo = {};
-    VkPipelineDepthStencilStateCreateInfo DSSinfo = {};
+    VKHRESULT hr = VK_SUCCESS;
+    VkGraphicsPipelineDesc desc = {};
     VkPipelineColorBlendAttachmentState BAS = {};
-    VkPipelineColorBlendStateCreateInfo BSinfo = {};
-    /// PSO
-    VkGraphicsPipelineCreateInfo PSOinfo = {};
-
-    shaderModules[0] = CreateShaderModuleFromSPIRVFile(m_pDevice, L"shaders/box.vert.spv");
-    shaderModules[1] = CreateShaderModuleFromSPIRVFile(m_pDevice, L"shaders/box.frag.spv");
-
-    shaderStageInfos[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStageInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStageInfos[0].module = shaderModules[0];
-    shaderStageInfos[0].pName = "main";
+    const char *pszName = IsMsaaEnabled() ? "Box (MSAA)" : "Box";
 
-    shaderStageInfos[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStageInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStageInfos[1].module = shaderModules[1];
-    shaderStageInfos[1].pName = "main";
+    if (m_aPSOs[IsMsaaEnabled()] != VkPipelineCompiler::InvalidHandle)
+      return hr;
 
     V_RETURN(CreatePiplineLayout());
 
+    /// Preloaded at startup, the files are the fallback of the compiling thread.
+    desc.VertexShaderFile = L"shaders/box.vert.spv";
+    desc.FragmentShaderFile = L"shaders/box.frag.spv";
+    desc.VertexShaderCode = m_aBoxShaderCode[0];
+    desc.FragmentShaderCode = m_aBoxShaderCode[1];
+
     /// Vertex Binding  Information.
-    VkVertexInputBindingDescription bindingDescs = {};
-    bindingDescs.binding = 0;
-    bindingDescs.stride = sizeof(GeometryGenerator::Vertex);
-    bindingDescs.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription attribDescs[2] = {};
-    attribDescs[0].binding = 0;
-    attribDescs[0].location = 0;
-    attribDescs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attribDescs[0].offset = offsetof(GeometryGenerator::Vertex, Position);
-
-    attribDescs[1].binding = 0;
-    attribDescs[1].location = 1;
-    attribDescs[1].format = VK_FORMAT_R32G32_SFLOAT;
-    attribDescs[1].offset = offsetof(GeometryGenerator::Vertex, TexC);
-
-    /// Vertex Input Infos.
-    VIinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    VIinfo.vertexBindingDescriptionCount = 1;
-    VIinfo.pVertexBindingDescriptions = &bindingDescs;
-    VIinfo.vertexAttributeDescriptionCount = _countof(attribDescs);
-    VIinfo.pVertexAttributeDescriptions = attribDescs;
+    desc.VertexBindings.push_back(
+        {0, sizeof(GeometryGenerator::Vertex), VK_VERTEX_INPUT_RATE_VERTEX});
+    desc.VertexAttributes.push_back(
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(GeometryGenerator::Vertex, Position)});
+    desc.VertexAttributes.push_back(
+        {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(GeometryGenerator::Vertex, TexC)});
 
     /// IA States
-    IAinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    IAinfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    IAinfo.primitiveRestartEnable = VK_FALSE;
+    desc.InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    desc.InputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    desc.InputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VPinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    VPinfo.viewportCount = 1;
-    VPinfo.pViewports = &m_Viewport;
-    VPinfo.scissorCount = 1;
-    VPinfo.pScissors = &m_ScissorRect;
+    desc.ViewportCount = 1;
 
     /// Rasterization States.
-    RSinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    RSinfo.depthClampEnable = VK_FALSE;
-    RSinfo.rasterizerDiscardEnable = VK_FALSE;
-    RSinfo.polygonMode = VK_POLYGON_MODE_FILL;
-    RSinfo.lineWidth = 1.0f;
-    RSinfo.cullMode = VK_CULL_MODE_BACK_BIT;
-    RSinfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    RSinfo.depthBiasEnable = VK_FALSE;
+    desc.Rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    desc.Rasterization.depthClampEnable = VK_FALSE;
+    desc.Rasterization.rasterizerDiscardEnable = VK_FALSE;
+    desc.Rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    desc.Rasterization.lineWidth = 1.0f;
+    desc.Rasterization.cullMode = s_BoxRasterState.CullMode;
+    desc.Rasterization.frontFace = s_BoxRasterState.FrontFace;
+    desc.Rasterization.depthBiasEnable = VK_FALSE;
 
     /// MSAA setting
-    MSAAinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    MSAAinfo.sampleShadingEnable = VK_FALSE;
-    MSAAinfo.rasterizationSamples = IsMsaaEnabled()
-                                        ? (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel
-                                        : VK_SAMPLE_COUNT_1_BIT;
-    MSAAinfo.minSampleShading = 1.0f; /// Optional.
-    MSAAinfo.pSampleMask = nullptr;
-    MSAAinfo.alphaToCoverageEnable = VK_FALSE;
-
-    DSSinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    DSSinfo.depthTestEnable = VK_TRUE;
-    DSSinfo.depthCompareOp = VK_COMPARE_OP_LESS;
-    DSSinfo.depthWriteEnable = VK_TRUE;
-    DSSinfo.stencilTestEnable = VK_FALSE;
+    desc.Multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    desc.Multisample.sampleShadingEnable = VK_FALSE;
+    desc.Multisample.rasterizationSamples =
+        IsMsaaEnabled() ? (VkSampleCountFlagBits)m_aDeviceConfig.MsaaQaulityLevel
+                        : VK_SAMPLE_COUNT_1_BIT;
+    desc.Multisample.minSampleShading = 1.0f; /// Optional.
+    desc.Multisample.pSampleMask = nullptr;
+    desc.Multisample.alphaToCoverageEnable = VK_FALSE;
+
+    desc.DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    desc.DepthStencil.depthTestEnable = s_BoxRasterState.DepthTestEnable;
+    desc.DepthStencil.depthCompareOp = s_BoxRasterState.DepthCompareOp;
+    desc.DepthStencil.depthWriteEnable = s_BoxRasterState.DepthWriteEnable;
+    desc.DepthStencil.stencilTestEnable = VK_FALSE;
 
     /// Blend State
     BAS.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     BAS.blendEnable = VK_FALSE;
-    BSinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    BSinfo.attachmentCount = 1;
-    BSinfo.logicOpEnable = VK_FALSE;
-    BSinfo.logicOp = VK_LOGIC_OP_COPY;
-    BSinfo.pAttachments = &BAS;
-
-    /// PSO
-    PSOinfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    PSOinfo.layout = m_pPipelineLayout;
-    PSOinfo.pVertexInputState = &VIinfo;
-    PSOinfo.pInputAssemblyState = &IAinfo;
-    PSOinfo.stageCount = _countof(shaderStageInfos);
-    PSOinfo.pStages = shaderStageInfos;
-    PSOinfo.pViewportState = &VPinfo;
-    PSOinfo.pRasterizationState = &RSinfo;
-    PSOinfo.pColorBlendState = &BSinfo;
-    PSOinfo.pDepthStencilState = &DSSinfo;
-    PSOinfo.pMultisampleState = &MSAAinfo;
-
-    PSOinfo.renderPass = m_pSwapChainFBsCompatibleRenderPass;
-    PSOinfo.subpass = 0;
-    PSOinfo.basePipelineHandle = VK_NULL_HANDLE;
-    PSOinfo.basePipelineIndex = -1;
-
-    if (m_pPSO) {
-      vkDestroyPipeline(m_pDevice, m_pPSO, nullptr);
-      m_pPSO = nullptr;
-    }
-    V(vkCreateGraphicsPipelines(m_pDevice, nullptr, 1, &PSOinfo, nullptr, &m_pPSO));
+    desc.BlendAttachments.push_back(BAS);
+
+    desc.DynamicStates = GetPipelineDynamicStates();
 
-    vkDestroyShaderModule(m_pDevice, shaderModules[0], nullptr);
-    vkDestroyShaderModule(m_pDevice, shaderModules[1], nullptr);
+    desc.Layout = m_pPipelineLayout;
+    desc.RenderPass = m_pSwapChainFBsCompatibleRenderPass;
+    desc.Subpass = 0;
+
+    /// Kept for the lifetime of the context, a compatible render pass of the same sample count
+    /// reuses it after the swap chain was recreated.
+    m_aPSOs[IsMsaaEnabled()] = m_PipelineCompiler.Submit(pszName, std::move(desc));
 
     return hr;
   }
@@ -478,11 +506,11 @@ private:
       /// Create Pipeline layout along with it.
       VkDescriptorSetLayoutBinding layoutBindings[] = {
           {
-              0,                                 // binding;
-              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, // descriptorType;
-              1,                                 // descriptorCount;
-              VK_SHADER_STAGE_VERTEX_BIT,        // stageFlags;
-              nullptr                            // pImmutableSamplers;
+              0,                                         // binding;
+              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, // descriptorType;
+              1,                                         // descriptorCount;
+              VK_SHADER_STAGE_VERTEX_BIT,                // stageFlags;
+              nullptr                                    // pImmutableSamplers;
           },
       };
 
@@ -514,11 +542,30 @@ private:
                                            &m_pDiffuseDescriptorSetLayout));
     }
 
+    if (!m_pAnimateDescriptorSetLayout) {
+      /// Written by the animation, read by the box's vertex shader.
+      VkDescriptorSetLayoutBinding layoutBindings[] = {
+          {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1,
+           VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+      };
+
+      VkDescriptorSetLayoutCreateInfo createInfo = {
+          VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, // sType;
+          nullptr,                                             // pNext;
+          0,                                                   // flags;
+          _countof(layoutBindings),                            // bindingCount;
+          layoutBindings                                       // pBindings;
+      };
+      V_RETURN(vkCreateDescriptorSetLayout(m_pDevice, &createInfo, nullptr,
+                                           &m_pAnimateDescriptorSetLayout));
+    }
+
     if (!m_pPipelineLayout) {
       VkPipelineLayoutCreateInfo layoutInfo = {
           VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
       };
-      VkDescriptorSetLayout setLayouts[] = {m_pDescriptorSetLayout, m_pDiffuseDescriptorSetLayout};
+      VkDescriptorSetLayout setLayouts[] = {m_pDescriptorSetLayout, m_pDiffuseDescriptorSetLayout,
+                                            m_pAnimateDescriptorSetLayout};
       layoutInfo.setLayoutCount = _countof(setLayouts);
       layoutInfo.pSetLayouts = setLayouts;
       V_RETURN(vkCreatePipelineLayout(m_pDevice, &layoutInfo, nullptr, &m_pPipelineLayout));
@@ -530,11 +577,13 @@ private:
   VKHRESULT CreateDescriptorPool() {
 
     VKHRESULT hr;
-    VkDescriptorPoolSize poolSizes[2] = {};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = _countof(m_aRendererItemCtx);
+    VkDescriptorPoolSize poolSizes[3] = {};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = 1;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = 2;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo createInfo = {
         VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, // sType;
@@ -552,54 +601,59 @@ private:
 
   VKHRESULT CreateDescriptorSets() {
     VKHRESULT hr;
-    VkDescriptorSetLayout aPerFrameSetLayouts[_countof(m_aDescriptorSets)];
-    uint32_t i;
-    uint32_t uUBByteOffset;
-
-    for (i = 0; i < _countof(m_aDescriptorSets); ++i)
-      aPerFrameSetLayouts[i] = m_pDescriptorSetLayout;
+    VkDescriptorSetLayout setLayouts[3] = {m_pDescriptorSetLayout, m_pDiffuseDescriptorSetLayout,
+                                           m_pAnimateDescriptorSetLayout};
+    VkDescriptorSet descriptorSets[3];
 
     VkDescriptorSetAllocateInfo setsInfo = {
         VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, // sType;
         nullptr,                                        // pNext;
         m_pDescriptorPool,                              // descriptorPool;
-        _countof(m_aDescriptorSets),                    // descriptorSetCount;
-        aPerFrameSetLayouts                             // pSetLayouts;
+        _countof(setLayouts),                           // descriptorSetCount;
+        setLayouts                                      // pSetLayouts;
+    };
+    V_RETURN(vkAllocateDescriptorSets(m_pDevice, &setsInfo, descriptorSets));
+    m_pObjectDescriptorSet = descriptorSets[0];
+    m_pDiffuseDiscriptorSet = descriptorSets[1];
+    m_pAnimateDescriptorSet = descriptorSets[2];
+
+    /// Every frame's constants, selected by the dynamic offset of the draw.
+    VkDescriptorBufferInfo bufferInfos[1] = {
+        m_FrameUniforms.GetDescriptorInfo(sizeof(ObjectConstants)),
+    };
+    /// One slot's offsets, selected by the dynamic offset as well.
+    VkDescriptorBufferInfo offsetsInfos[1] = {
+        {m_pDrawOffsetsBuffer, 0, m_cbDrawOffsetsPerFrame},
     };
-    V_RETURN(vkAllocateDescriptorSets(m_pDevice, &setsInfo, m_aDescriptorSets));
-
-    setsInfo.descriptorSetCount = 1;
-    setsInfo.pSetLayouts = &m_pDiffuseDescriptorSetLayout;
-    V_RETURN(vkAllocateDescriptorSets(m_pDevice, &setsInfo, &m_pDiffuseDiscriptorSet));
-
-    uUBByteOffset = CalcUniformBufferByteSize(sizeof(ObjectConstants));
-
-    for (i = 0; i < _countof(m_aDescriptorSets); ++i) {
-      VkDescriptorBufferInfo bufferInfos[1] = {
-          {
-              FrameResources::ObjectUBs.GetResource(), // buffer;
-              uUBByteOffset * i,                       // offset;
-              sizeof(ObjectConstants)                  // range;
-          },
-      };
 
-      VkWriteDescriptorSet descriptorWrite[] = {
-          {
-              VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, // sType;
-              nullptr,                                // pNext;
-              m_aDescriptorSets[i],                   // dstSet;
-              0,                                      // dstBinding;
-              0,                                      // dstArrayElement;
-              _countof(bufferInfos),                  // descriptorCount;
-              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,      // descriptorType;
-              nullptr,                                // pImageInfo;
-              bufferInfos,                            // pBufferInfo;
-              nullptr                                 // pTexelBufferView;
-          },
-      };
+    VkWriteDescriptorSet uniformWrite[] = {
+        {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,    // sType;
+            nullptr,                                   // pNext;
+            m_pObjectDescriptorSet,                    // dstSet;
+            0,                                         // dstBinding;
+            0,                                         // dstArrayElement;
+            _countof(bufferInfos),                     // descriptorCount;
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, // descriptorType;
+            nullptr,                                   // pImageInfo;
+            bufferInfos,                               // pBufferInfo;
+            nullptr                                    // pTexelBufferView;
+        },
+        {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,    // sType;
+            nullptr,                                   // pNext;
+            m_pAnimateDescriptorSet,                   // dstSet;
+            0,                                         // dstBinding;
+            0,                                         // dstArrayElement;
+            _countof(offsetsInfos),                    // descriptorCount;
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, // descriptorType;
+            nullptr,                                   // pImageInfo;
+            offsetsInfos,                              // pBufferInfo;
+            nullptr                                    // pTexelBufferView;
+        },
+    };
 
-      vkUpdateDescriptorSets(m_pDevice, _countof(descriptorWrite), descriptorWrite, 0, nullptr);
-    }
+    vkUpdateDescriptorSets(m_pDevice, _countof(uniformWrite), uniformWrite, 0, nullptr);
 
     VkDescriptorImageInfo samplerInfos[2] = {
         {
@@ -633,31 +687,119 @@ private:
     return hr;
   }
 
-  VkBuffer m_pVertexBuffer;
-  VMAHandle m_pVertexMem;
-  VkBuffer m_pVertexUploadBuffer;
-  VMAHandle m_pVertexUploadMem;
-  VkBuffer m_pIndexBuffer;
-  VMAHandle m_pIndexMem;
-  VkBuffer m_pIndexUploadBuffer;
-  VMAHandle m_pIndexUploadMem;
+  /// Offsets buffer with a region per frame slot, and the compute pipeline writing it.
+  VKHRESULT CreateAnimation() {
+    VKHRESULT hr;
+    VkPhysicalDeviceProperties properties;
+    VkDeviceSize cbAlignment;
+    VkShaderModule pShaderModule;
+    VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                                             sizeof(AnimateConstants)};
+    VkPipelineLayoutCreateInfo layoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    VkComputePipelineCreateInfo pipelineInfo = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+
+    vkGetPhysicalDeviceProperties(m_pPhysicalDevice, &properties);
+    cbAlignment = properties.limits.minStorageBufferOffsetAlignment;
+    m_cbDrawOffsetsPerFrame =
+        (GetDrawCount() * sizeof(glm::vec4) + cbAlignment - 1) / cbAlignment * cbAlignment;
+    V_RETURN(CreateDeviceBuffer(m_pDevice, m_cbDrawOffsetsPerFrame * m_aRendererItemCtx.size(),
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &m_pDrawOffsetsBuffer,
+                                &m_pDrawOffsetsMem));
+
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_pAnimateDescriptorSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+    V_RETURN(vkCreatePipelineLayout(m_pDevice, &layoutInfo, nullptr, &m_pAnimatePipelineLayout));
+
+    pShaderModule =
+        CreateShaderModule(m_pDevice, m_aAnimateShaderCode.data(),
+                           m_aAnimateShaderCode.size() * sizeof(uint32_t));
+    V_RETURN(!(pShaderModule && !!("Failed to create the animation shader!")));
+
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = pShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pAnimatePipelineLayout;
+    hr = m_PipelineCache.CreateComputePipelines(1, &pipelineInfo, &m_pAnimatePSO);
+    vkDestroyShaderModule(m_pDevice, pShaderModule, nullptr);
+    V_RETURN(hr);
+
+    return hr;
+  }
+
+  /// Write the draw offsets into the current slot's region.
+  void CmdAnimate(VkCommandBuffer pCmdBuffer, float fTime) {
+    AnimateConstants constants = {fTime, GetDrawCount()};
+    uint32_t uOffsetsOffset = m_iCurrRendererItem * (uint32_t)m_cbDrawOffsetsPerFrame;
+
+    vkCmdBindPipeline(pCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pAnimatePSO);
+    vkCmdBindDescriptorSets(pCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pAnimatePipelineLayout,
+                            0, 1, &m_pAnimateDescriptorSet, 1, &uOffsetsOffset);
+    vkCmdPushConstants(pCmdBuffer, m_pAnimatePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(constants), &constants);
+    vkCmdDispatch(pCmdBuffer, (constants.DrawCount + s_uAnimateGroupSize - 1) / s_uAnimateGroupSize,
+                  1, 1);
+  }
+
+  /// Release the slot's offsets on the compute queue, or acquire them on the graphics queue. The
+  /// compute queue never acquires them back, it overwrites them.
+  void CmdTransferDrawOffsets(VkCommandBuffer pCmdBuffer, bool bRelease) {
+    VkBufferMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,                  // sType;
+        nullptr,                                                  // pNext;
+        bRelease ? VK_ACCESS_SHADER_WRITE_BIT : (VkAccessFlags)0, // srcAccessMask;
+        bRelease ? (VkAccessFlags)0 : VK_ACCESS_SHADER_READ_BIT,  // dstAccessMask;
+        (uint32_t)m_iComputeQueueFamilyIndex,                     // srcQueueFamilyIndex;
+        (uint32_t)m_iGraphicQueueFamilyIndex,                     // dstQueueFamilyIndex;
+        m_pDrawOffsetsBuffer,                                     // buffer;
+        m_iCurrRendererItem * m_cbDrawOffsetsPerFrame,            // offset;
+        m_cbDrawOffsetsPerFrame                                   // size;
+    };
+
+    vkCmdPipelineBarrier(
+        pCmdBuffer,
+        bRelease ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        bRelease ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+        0, nullptr, 1, &barrier, 0, nullptr);
+  }
+
+  /// Startup products, consumed by the tasks depending on them.
+  GeometryGenerator::MeshData m_BoxMesh;
+  std::vector<uint32_t> m_aBoxShaderCode[2];
+  std::vector<uint32_t> m_aAnimateShaderCode;
+
+  /// In `m_GeometryPool`.
+  VkMeshRange m_BoxRange;
 
   VkTexture m_aDiffuseMap;
   VkTexture m_aMaskDiffuseMap;
 
   VkSampler m_aStaticSamplers[2];
 
-  uint32_t m_uIndexCount;
-
   VkDescriptorSetLayout m_pDescriptorSetLayout;
   VkDescriptorSetLayout m_pDiffuseDescriptorSetLayout;
+  VkDescriptorSetLayout m_pAnimateDescriptorSetLayout;
 
   VkPipelineLayout m_pPipelineLayout;
-  VkPipeline m_pPSO;
+  /// Indexed by IsMsaaEnabled(), the render pass bakes the sample count in.
+  VkPipelineCompiler::Handle m_aPSOs[2];
+  VkPipelineLayout m_pAnimatePipelineLayout;
+  VkPipeline m_pAnimatePSO;
+
+  /// One vec4 per draw and frame slot, the slot's region is bound by a dynamic offset.
+  VkBuffer m_pDrawOffsetsBuffer;
+  VMAHandle m_pDrawOffsetsMem;
+  VkDeviceSize m_cbDrawOffsetsPerFrame; /// Aligned.
 
   VkDescriptorPool m_pDescriptorPool;
-  VkDescriptorSet m_aDescriptorSets[_countof(m_aRendererItemCtx)];
+  VkDescriptorSet m_pObjectDescriptorSet;
   VkDescriptorSet m_pDiffuseDiscriptorSet;
+  VkDescriptorSet m_pAnimateDescriptorSet;
+
+  /// Written by `Update`, pushed to the frame's uniforms by `RenderFrame`.
+  ObjectConstants m_ObjectConstants;
 
   ArcBallCamera m_Camera;
 };
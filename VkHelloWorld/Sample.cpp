@@ -3,11 +3,16 @@
 #include <GLFW/glfw3.h>
 #ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
+#include <GLFW/glfw3native.h>
 #else
-#error Unsupport yet
+#include <sys/resource.h>
 #endif
-#include <GLFW/glfw3native.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -20,22 +25,51 @@ static struct UIState {
   double FrameStatLastTimeStamp;
   uint32_t FrameStatLastFrameCount;
   uint64_t FrameStatTotalFrameCount;
+  double StallLogLastTimeStamp;
+  uint32_t StallLogLastFrameCount;
 } g_UIState;
 
+/// Seconds between two stall summaries of the windowed sample.
+static const double s_StallLogInterval = 5.0;
+
 static void ProcessKeyStrokesInput(GLFWwindow *window);
 static void ReportFrameStats(GLFWwindow *window);
 static void OnResizeWindow(GLFWwindow *window, int cx, int cy);
 static void OnCursorPosChanged(GLFWwindow *window, double xpos, double ypos);
 static void OnMouseButtonEvent(GLFWwindow *window, int button, int action, int mods);
 static void OnMouseScroll(GLFWwindow *window, double xoffset, double yoffset);
+static double GetProcessCpuTime();
+static double GetProcessPeakResidentMegaBytes();
+static void OpenGpuProfilerLog(VulkanRenderContext *pRenderContext);
+static void ReportPipelineCache(VulkanRenderContext *pRenderContext);
+static void ReportDevice(VulkanRenderContext *pRenderContext);
+static void ReportAttachmentMemory(VulkanRenderContext *pRenderContext);
+static void ExportFrameStats(VulkanRenderContext *pRenderContext);
+static void PrintFrameTimePercentiles(const char *pszName, const FrameTimePercentiles &percentiles);
+static void PrintFrameStalls(const char *pszIndent, const FrameStatsSummary &stats);
+static double GetMillisecondsSince(std::chrono::steady_clock::time_point start);
+static void ReportStartup(VulkanRenderContext *pRenderContext, double instanceMs,
+                          double firstFrameMs);
+static void ApplyEnvironmentOptions(VulkanRenderContext *pRenderContext);
+static VKHRESULT MeasureSerialStartup(const char *pTitle, int width, int height,
+                                      double *pFirstFrameMs);
+static void PrintPipelineStatistics(int indent, const GpuPipelineStatistics &stats);
+
+int RunSampleHeadless(const char *pTitle, int width, int height, uint32_t uFrameCount,
+                      VulkanRenderContext *pRenderContext);
+extern VulkanRenderContext *CreateSampleRenderContext();
 
 int RunSample(const char *pTitle, int width, int height, VulkanRenderContext *pRenderContext) {
 
   VKHRESULT hr;
 
+#ifdef _WIN32
   GLFWwindow *window;
   std::wstring iconPath;
   float fTime, fElapsed;
+  std::chrono::steady_clock::time_point startupTime;
+  double instanceMs;
+  bool bFirstFrame = true;
 
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -52,23 +86,30 @@ int RunSample(const char *pTitle, int width, int height, VulkanRenderContext *pR
   glfwSetMouseButtonCallback(window, OnMouseButtonEvent);
   glfwSetScrollCallback(window, OnMouseScroll);
 
+  ApplyEnvironmentOptions(pRenderContext);
+
+  /// The first frame time covers everything from the instance on.
+  startupTime = std::chrono::steady_clock::now();
   pRenderContext->CreateVkInstance(pTitle);
-#if _WIN32
+  instanceMs = GetMillisecondsSince(startupTime);
   pRenderContext->CreateWindowSurface((void *)glfwGetWin32Window(window));
-#else
-#error Unsupport yet.
-#endif
   V(pRenderContext->Initialize());
   if (VK_FAILED(hr)) {
     return -1;
   }
+  OpenGpuProfilerLog(pRenderContext);
+  ReportDevice(pRenderContext);
   // Call it for the first time.
   pRenderContext->Resize(width, height);
 
   g_UIState.Timer.Resume();
 
   while (!glfwWindowShouldClose(window)) {
+    /// Sample the input as late as the latency policy allows.
+    pRenderContext->WaitForFrameStart();
+    glfwPollEvents();
     ProcessKeyStrokesInput(window);
+    pRenderContext->MarkInputSampled();
     ReportFrameStats(window);
 
     g_UIState.Timer.Tick();
@@ -78,15 +119,412 @@ int RunSample(const char *pTitle, int width, int height, VulkanRenderContext *pR
 
     pRenderContext->Update(fTime, fElapsed);
     pRenderContext->RenderFrame(fTime, fElapsed);
-
-    glfwPollEvents();
+    if (bFirstFrame) {
+      ReportStartup(pRenderContext, instanceMs, GetMillisecondsSince(startupTime));
+      ReportAttachmentMemory(pRenderContext);
+      bFirstFrame = false;
+    }
   }
 
+  /// The pipelines compile in the background while the first frames are drawn.
+  ReportPipelineCache(pRenderContext);
+  ExportFrameStats(pRenderContext);
   pRenderContext->Destroy();
 
   glfwTerminate();
 
   return hr;
+#else
+  /// Window surfaces are only created for Win32, see `CreateWindowSurface`.
+  hr = VK_ERROR_EXTENSION_NOT_PRESENT;
+  fprintf(stderr, "%s: windowed mode is unsupported on this platform, run with --headless.\n",
+          pTitle);
+  return hr;
+#endif
+}
+
+int RunSampleHeadless(const char *pTitle, int width, int height, uint32_t uFrameCount,
+                      VulkanRenderContext *pRenderContext) {
+
+  VKHRESULT hr;
+  float fTime, fElapsed;
+  uint32_t i;
+  double startTime, cpuStartTime, totalTime, cpuTotalTime;
+  uint64_t cbDeviceUsed = 0, cbDeviceReserved = 0;
+  uint64_t acbCategories[(uint32_t)VkMemoryCategory::Count];
+  AsyncComputeStats computeStats;
+  bool bGpuTimed;
+  std::vector<GpuPassTiming> passTimings;
+  GpuPipelineStatistics frameStatistics;
+  bool bHasStatistics;
+  PresentLatencyStats latencyStats;
+  bool bLatencyMeasured;
+  FrameStatsSummary frameStats;
+  bool bFrameStats;
+  uint64_t uFirstTimedFrame;
+  std::chrono::steady_clock::time_point startupTime;
+  double instanceMs, firstFrameMs, serialFirstFrameMs;
+  bool bSerialBaseline;
+
+  ApplyEnvironmentOptions(pRenderContext);
+
+  V_RETURN(pRenderContext->SetHeadlessEnabled(true));
+  /// The offscreen images are created once, at the requested size.
+  pRenderContext->Resize(width, height);
+  startupTime = std::chrono::steady_clock::now();
+  V_RETURN(pRenderContext->CreateVkInstance(pTitle));
+  instanceMs = GetMillisecondsSince(startupTime);
+  V(pRenderContext->Initialize());
+  if (VK_FAILED(hr)) {
+    return -1;
+  }
+  OpenGpuProfilerLog(pRenderContext);
+  ReportDevice(pRenderContext);
+
+  /// The first frame only waits for the uploads, the pipelines may still be compiling.
+  g_UIState.Timer.Resume();
+  g_UIState.Timer.Tick();
+  pRenderContext->Update(.0f, .0f);
+  pRenderContext->RenderFrame(.0f, .0f);
+  firstFrameMs = GetMillisecondsSince(startupTime);
+  ReportStartup(pRenderContext, instanceMs, firstFrameMs);
+  ReportAttachmentMemory(pRenderContext);
+
+  /// The frames are timed with every pipeline in place, the warm-up frame is left out.
+  pRenderContext->GetPipelineCompiler()->WaitIdle();
+  ReportPipelineCache(pRenderContext);
+  uFirstTimedFrame = pRenderContext->GetNextFrameValue();
+
+  g_UIState.Timer.Tick();
+  startTime = g_UIState.Timer.TotalElapsed();
+  cpuStartTime = GetProcessCpuTime();
+
+  for (i = 0; i < uFrameCount; ++i) {
+    /// No input, but the frame is paced and measured the same way.
+    pRenderContext->WaitForFrameStart();
+    pRenderContext->MarkInputSampled();
+    g_UIState.Timer.Tick();
+
+    fElapsed = (float)g_UIState.Timer.TotalElapsed();
+    fTime = (float)g_UIState.Timer.DeltaElasped();
+
+    pRenderContext->Update(fTime, fElapsed);
+    pRenderContext->RenderFrame(fTime, fElapsed);
+  }
+
+  /// The timings cover every submitted frame, and nothing past them.
+  V(pRenderContext->WaitIdle());
+  totalTime = g_UIState.Timer.TotalElapsed() - startTime;
+  cpuTotalTime = GetProcessCpuTime() - cpuStartTime;
+
+  GetVmaMemoryUsage(&cbDeviceUsed, &cbDeviceReserved);
+  GetVmaCategoryUsage(acbCategories);
+  bGpuTimed = pRenderContext->GetAsyncComputeStats(&computeStats);
+  passTimings = pRenderContext->GetGpuProfiler()->GetLastFrameTimings();
+  bHasStatistics = pRenderContext->GetGpuProfiler()->GetLastFrameStatistics(&frameStatistics);
+  bLatencyMeasured = pRenderContext->GetPresentLatencyStats(&latencyStats);
+  bFrameStats = pRenderContext->CalcFrameStats(&frameStats, uFrameCount, uFirstTimedFrame);
+  ExportFrameStats(pRenderContext);
+  pRenderContext->Destroy();
+
+  /// Opt-in, a whole second startup. It runs last, so the warm file and pipeline caches favor
+  /// the baseline rather than the measured startup.
+  bSerialBaseline = false;
+  if (const char *pszSerialBaseline = getenv("VK_TRIAL_STARTUP_BASELINE"))
+    bSerialBaseline = atoi(pszSerialBaseline) != 0 &&
+                      VK_SUCCEEDED(MeasureSerialStartup(pTitle, width, height,
+                                                        &serialFirstFrameMs));
+
+  printf("%s headless: %u frames, %dx%d, %u frames in flight, %u record threads%s\n", pTitle,
+         uFrameCount, width, height, pRenderContext->GetFrameCount(),
+         pRenderContext->GetRecordThreadCount(),
+         pRenderContext->IsStaticCommandsEnabled() ? ", static commands" : "");
+  if (uFrameCount) {
+    printf("  FPS: %.1f, MSPF: %.3f, CPU ms per frame: %.3f\n", uFrameCount / totalTime,
+           1000.0 * totalTime / uFrameCount, 1000.0 * cpuTotalTime / uFrameCount);
+  }
+  if (bSerialBaseline) {
+    printf("  First frame ms, %u startup threads: %.3f, serial baseline: %.3f (%.2fx)\n",
+           pRenderContext->GetStartupThreadCount(), firstFrameMs, serialFirstFrameMs,
+           firstFrameMs > 0.0 ? serialFirstFrameMs / firstFrameMs : 0.0);
+  }
+  printf("  Device memory used: %.2f MiB, reserved: %.2f MiB, peak resident: %.2f MiB\n",
+         cbDeviceUsed / (1024.0 * 1024.0), cbDeviceReserved / (1024.0 * 1024.0),
+         GetProcessPeakResidentMegaBytes());
+  printf("  Device memory by category, MiB:");
+  for (i = 0; i < (uint32_t)VkMemoryCategory::Count; ++i) {
+    printf(" %s %.2f", GetMemoryCategoryName((VkMemoryCategory)i),
+           acbCategories[i] / (1024.0 * 1024.0));
+  }
+  printf("\n");
+  if (bGpuTimed && computeStats.OverlapMeasured) {
+    printf("  GPU ms per frame, graphics: %.3f, async compute: %.3f, overlapped: %.3f (%.0f%%)\n",
+           computeStats.GraphicsMs, computeStats.ComputeMs, computeStats.OverlapMs,
+           100.0f * computeStats.OverlapRatio);
+  } else if (bGpuTimed) {
+    printf("  GPU ms per frame, graphics: %.3f, async compute: %.3f, overlapped: n/a\n",
+           computeStats.GraphicsMs, computeStats.ComputeMs);
+  }
+  if (bLatencyMeasured) {
+    printf("  Input to present ms, average: %.3f, max: %.3f, start delay: %.3f (%s)\n",
+           latencyStats.InputToPresentMs, latencyStats.MaxInputToPresentMs,
+           latencyStats.FrameStartDelayMs, latencyStats.PresentWait ? "present wait" : "GPU done");
+  }
+  if (bFrameStats) {
+    /// Averages hide the stutters, the tail and the hitches don't.
+    printf("  Frame times over %u frames, %u hitches over %.3f ms:\n", frameStats.FrameCount,
+           frameStats.HitchCount, frameStats.HitchThresholdMs);
+    PrintFrameTimePercentiles("CPU", frameStats.Cpu);
+    PrintFrameTimePercentiles("GPU", frameStats.Gpu);
+    PrintFrameTimePercentiles("Present interval", frameStats.PresentInterval);
+    PrintFrameStalls("    ", frameStats);
+  }
+  for (auto &timing : passTimings) {
+    printf("  %*s%s: %.3f ms\n", 2 * timing.Depth, "", timing.Name.c_str(), timing.Milliseconds);
+    if (timing.HasStatistics)
+      PrintPipelineStatistics(2 * timing.Depth + 4, timing.Statistics);
+  }
+  if (bHasStatistics) {
+    printf("  Frame pipeline statistics:\n");
+    PrintPipelineStatistics(4, frameStatistics);
+  }
+
+  return 0;
+}
+
+void OpenGpuProfilerLog(VulkanRenderContext *pRenderContext) {
+  if (const char *pszFileName = getenv("VK_TRIAL_GPU_PROFILE_CSV"))
+    pRenderContext->GetGpuProfiler()->OpenCsvLog(pszFileName);
+}
+
+void ExportFrameStats(VulkanRenderContext *pRenderContext) {
+  const char *pszFileName = getenv("VK_TRIAL_FRAME_STATS");
+  size_t len;
+
+  if (!pszFileName)
+    return;
+  /// JSON by the extension, CSV otherwise.
+  len = strlen(pszFileName);
+  if (len >= 5 && _stricmp(pszFileName + len - 5, ".json") == 0)
+    pRenderContext->GetFrameStats()->ExportJson(pszFileName);
+  else
+    pRenderContext->GetFrameStats()->ExportCsv(pszFileName);
+}
+
+void PrintFrameTimePercentiles(const char *pszName, const FrameTimePercentiles &percentiles) {
+  if (!percentiles.Count)
+    return;
+  printf("    %-16s avg %8.3f, p50 %8.3f, p95 %8.3f, p99 %8.3f, max %8.3f ms\n", pszName,
+         percentiles.Average, percentiles.P50, percentiles.P95, percentiles.P99, percentiles.Max);
+}
+
+void PrintFrameStalls(const char *pszIndent, const FrameStatsSummary &stats) {
+  printf("%sBound by CPU: %u, GPU: %u, present: %u frames\n", pszIndent,
+         stats.BoundCounts[(uint32_t)FrameBound::Cpu], stats.BoundCounts[(uint32_t)FrameBound::Gpu],
+         stats.BoundCounts[(uint32_t)FrameBound::Present]);
+  printf("%sBlocked ms avg/max, acquire: %.3f/%.3f, GPU wait: %.3f/%.3f, present: %.3f/%.3f, "
+         "pacing: %.3f/%.3f\n",
+         pszIndent, stats.AverageStalls.AcquireMs, stats.MaxStalls.AcquireMs,
+         stats.AverageStalls.GpuWaitMs, stats.MaxStalls.GpuWaitMs, stats.AverageStalls.PresentMs,
+         stats.MaxStalls.PresentMs, stats.AverageStalls.PacingMs, stats.MaxStalls.PacingMs);
+}
+
+void ReportPipelineCache(VulkanRenderContext *pRenderContext) {
+  PipelineCacheStats stats;
+  std::vector<PipelineCompileStats> aCompileStats;
+
+  /// Compare a cold against a warm start.
+  pRenderContext->GetPipelineCache()->GetStats(&stats);
+  printf("Pipeline cache: %s start, %zu bytes loaded, %u pipelines created in %.3f ms\n",
+         stats.WarmStart ? "warm" : "cold", stats.LoadedBytes, stats.PipelineCount, stats.CreateMs);
+
+  pRenderContext->GetPipelineCompiler()->GetStats(&aCompileStats);
+  for (auto &compile : aCompileStats) {
+    if (!compile.Ready)
+      printf("  %-24s pending\n", compile.Name.c_str());
+    else if (compile.Result != VK_SUCCESS)
+      printf("  %-24s failed (%d)\n", compile.Name.c_str(), (int)compile.Result);
+    else
+      printf("  %-24s %8.3f ms compile, %8.3f ms queued\n", compile.Name.c_str(),
+             compile.CompileMs, compile.QueuedMs);
+  }
+}
+
+void ReportDevice(VulkanRenderContext *pRenderContext) {
+  const PhysicalDeviceCaps &caps = pRenderContext->GetDeviceCaps();
+  static const char *const s_aTypeNames[] = {"other", "integrated", "discrete", "virtual", "CPU"};
+
+  printf("Device %u: %s (%s%s), score %lld%s, %.0f MiB device local%s%s\n", caps.DeviceIndex,
+         caps.DeviceName,
+         (uint32_t)caps.DeviceType < _countof(s_aTypeNames) ? s_aTypeNames[caps.DeviceType] : "?",
+         caps.UnifiedMemory ? ", unified memory" : "", (long long)caps.Score,
+         caps.Forced ? " (forced)" : "", caps.DeviceLocalBytes / (1024.0 * 1024.0),
+         caps.DedicatedTransferQueue ? ", transfer queue" : "",
+         caps.DedicatedComputeQueue ? ", compute queue" : "");
+}
+
+void ReportAttachmentMemory(VulkanRenderContext *pRenderContext) {
+  static const VkExtent2D s_aSizes[] = {{1920, 1080}, {3840, 2160}};
+  AttachmentMemoryEstimate estimate, usage;
+
+  /// The aliasing saving is known up front, what lazily allocated memory saves on top of it only
+  /// once the attachments were rendered to.
+  for (auto &size : s_aSizes) {
+    if (VK_FAILED(pRenderContext->EstimateAttachmentMemory(size.width, size.height, 4,
+                                                           &estimate)))
+      continue;
+    printf("Attachments %ux%u MSAA 4x: %.1f MiB dedicated, %.1f MiB packed, %.1f MiB saved by "
+           "aliasing%s\n",
+           size.width, size.height, estimate.DedicatedBytes / (1024.0 * 1024.0),
+           estimate.PackedBytes / (1024.0 * 1024.0),
+           (estimate.DedicatedBytes - estimate.PackedBytes) / (1024.0 * 1024.0),
+           estimate.LazilyAllocated ? ", lazily allocated" : "");
+  }
+
+  pRenderContext->GetAttachmentMemory(&usage);
+  if (usage.LazilyAllocated) {
+    printf("Current attachments: %.1f MiB packed, %.1f MiB lazily committed\n",
+           usage.PackedBytes / (1024.0 * 1024.0), usage.CommittedBytes / (1024.0 * 1024.0));
+  }
+}
+
+double GetMillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void ReportStartup(VulkanRenderContext *pRenderContext, double instanceMs, double firstFrameMs) {
+  const std::vector<TaskTiming> &aTimeline = pRenderContext->GetStartupTimeline();
+  const int iBarWidth = 40;
+  float fEndMs = .0f;
+  int iStart, iLength;
+
+  printf("First frame: %.3f ms, instance: %.3f ms\n", firstFrameMs, instanceMs);
+
+  /// One row per task, the bars share the scale of the whole startup graph.
+  for (auto &timing : aTimeline)
+    fEndMs = std::max(fEndMs, timing.EndMs);
+  for (auto &timing : aTimeline) {
+    iStart = fEndMs > .0f ? (int)(iBarWidth * timing.StartMs / fEndMs) : 0;
+    iLength = fEndMs > .0f ? (int)(iBarWidth * timing.EndMs / fEndMs) - iStart : 0;
+    iLength = std::max(1, std::min(iLength, iBarWidth - iStart));
+    printf("  %-24s T%u |%*s%s%*s| %8.3f ms .. %8.3f ms%s\n", timing.Name.c_str(),
+           timing.Thread, iStart, "", std::string(iLength, '#').c_str(),
+           iBarWidth - iStart - iLength, "", timing.StartMs, timing.EndMs,
+           timing.Skipped ? ", skipped" : timing.Result != VK_SUCCESS ? ", failed" : "");
+  }
+}
+
+/// Same steps up to the first frame as `RunSampleHeadless`, on a fresh context whose startup
+/// tasks all run on the calling thread.
+VKHRESULT MeasureSerialStartup(const char *pTitle, int width, int height,
+                               double *pFirstFrameMs) {
+  VKHRESULT hr;
+  VulkanRenderContext *pRenderContext = CreateSampleRenderContext();
+  std::chrono::steady_clock::time_point startupTime;
+
+  ApplyEnvironmentOptions(pRenderContext);
+  V(pRenderContext->SetStartupThreadCount(1));
+  if (VK_SUCCEEDED(hr))
+    V(pRenderContext->SetHeadlessEnabled(true));
+  if (VK_SUCCEEDED(hr)) {
+    pRenderContext->Resize(width, height);
+    startupTime = std::chrono::steady_clock::now();
+    V(pRenderContext->CreateVkInstance(pTitle));
+  }
+  if (VK_SUCCEEDED(hr))
+    V(pRenderContext->Initialize());
+  if (VK_SUCCEEDED(hr)) {
+    pRenderContext->Update(.0f, .0f);
+    pRenderContext->RenderFrame(.0f, .0f);
+    *pFirstFrameMs = GetMillisecondsSince(startupTime);
+
+    pRenderContext->GetPipelineCompiler()->WaitIdle();
+    pRenderContext->WaitIdle();
+    pRenderContext->Destroy();
+  }
+  SAFE_DELETE(pRenderContext);
+
+  return hr;
+}
+
+/// Latency against throughput trade-off, and the workload, are per-deployment choices. Must run
+/// before the instance is created.
+void ApplyEnvironmentOptions(VulkanRenderContext *pRenderContext) {
+  if (const char *pszFramesInFlight = getenv("VK_TRIAL_FRAMES_IN_FLIGHT"))
+    pRenderContext->SetFramesInFlight((uint32_t)atoi(pszFramesInFlight));
+  if (const char *pszRecordThreads = getenv("VK_TRIAL_RECORD_THREADS"))
+    pRenderContext->SetRecordThreadCount((uint32_t)atoi(pszRecordThreads));
+  if (const char *pszStaticCommands = getenv("VK_TRIAL_STATIC_COMMANDS"))
+    pRenderContext->SetStaticCommandsEnabled(atoi(pszStaticCommands) != 0);
+  if (const char *pszPipelineCache = getenv("VK_TRIAL_PIPELINE_CACHE"))
+    pRenderContext->SetPipelineCacheFile(pszPipelineCache);
+  if (const char *pszDevice = getenv("VK_TRIAL_DEVICE"))
+    pRenderContext->SetPreferredDevice(pszDevice);
+  if (const char *pszMemoryBudget = getenv("VK_TRIAL_MEMORY_BUDGET_MB"))
+    pRenderContext->SetMemoryBudget((uint64_t)atoi(pszMemoryBudget) << 20);
+  if (const char *pszMemoryLogInterval = getenv("VK_TRIAL_MEMORY_LOG_INTERVAL"))
+    pRenderContext->SetMemoryLogInterval((uint32_t)atoi(pszMemoryLogInterval));
+  if (const char *pszAsyncCompute = getenv("VK_TRIAL_ASYNC_COMPUTE"))
+    pRenderContext->SetAsyncComputeEnabled(atoi(pszAsyncCompute) != 0);
+  if (const char *pszStartupThreads = getenv("VK_TRIAL_STARTUP_THREADS"))
+    pRenderContext->SetStartupThreadCount((uint32_t)atoi(pszStartupThreads));
+  if (const char *pszDrawCount = getenv("VK_TRIAL_DRAW_COUNT"))
+    pRenderContext->SetDrawCount((uint32_t)std::max(1, atoi(pszDrawCount)));
+
+  const char *pszPolicy = getenv("VK_TRIAL_PRESENT_LATENCY");
+
+  if (!pszPolicy)
+    return;
+  if (_stricmp(pszPolicy, "throughput") == 0)
+    pRenderContext->SetPresentLatencyPolicy(PresentLatencyPolicy::Throughput);
+  else if (_stricmp(pszPolicy, "balanced") == 0)
+    pRenderContext->SetPresentLatencyPolicy(PresentLatencyPolicy::Balanced);
+  else if (_stricmp(pszPolicy, "low-latency") == 0)
+    pRenderContext->SetPresentLatencyPolicy(PresentLatencyPolicy::LowLatency);
+  else
+    VK_TRACE("Unknown VK_TRIAL_PRESENT_LATENCY policy %s.\n", pszPolicy);
+}
+
+void PrintPipelineStatistics(int indent, const GpuPipelineStatistics &stats) {
+  printf("%*sIA vertices: %llu, IA primitives: %llu, VS invocations: %llu\n", indent, "",
+         (unsigned long long)stats.InputVertices, (unsigned long long)stats.InputPrimitives,
+         (unsigned long long)stats.VertexInvocations);
+  printf("%*sClipping invocations: %llu, clipping primitives: %llu, FS invocations: %llu\n",
+         indent, "", (unsigned long long)stats.ClippingInvocations,
+         (unsigned long long)stats.ClippingPrimitives,
+         (unsigned long long)stats.FragmentInvocations);
+}
+
+double GetProcessCpuTime() {
+#ifdef _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  ULARGE_INTEGER kernel, user;
+
+  if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+    return 0.0;
+
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  /// 100 nanoseconds unit.
+  return (kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+  return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+double GetProcessPeakResidentMegaBytes() {
+#ifdef _WIN32
+  return 0.0;
+#else
+  struct rusage usage = {};
+
+  getrusage(RUSAGE_SELF, &usage);
+  /// Kilobytes on Linux.
+  return usage.ru_maxrss / 1024.0;
+#endif
 }
 
 void ProcessKeyStrokesInput(GLFWwindow *window) {
@@ -105,14 +543,43 @@ void ReportFrameStats(GLFWwindow *window) {
   g_UIState.FrameStatTotalFrameCount += 1;
 
   if ((timeInterval = (g_UIState.Timer.TotalElapsed() - g_UIState.FrameStatLastTimeStamp)) >= 1.0) {
-    char buff[128];
-    snprintf(buff, _countof(buff), "%s, FPS:%3.1f, MSPF:%.3f", g_UIState.Title.c_str(),
+    auto pRenderContext = reinterpret_cast<VulkanRenderContext *>(glfwGetWindowUserPointer(window));
+    PresentLatencyStats latencyStats;
+    FrameStatsSummary frameStats;
+    char buff[200];
+    pRenderContext->GetPresentLatencyStats(&latencyStats);
+    /// The tail of the last second, averages alone hide the stutters.
+    pRenderContext->CalcFrameStats(&frameStats, g_UIState.FrameStatLastFrameCount);
+    snprintf(buff, _countof(buff),
+                 "%s, FPS:%3.1f, MSPF:%.3f, P99:%.3fms, Hitches:%u, GPU:%.3fms, Latency:%.2fms",
+                 g_UIState.Title.c_str(),
                  (float)(g_UIState.FrameStatLastFrameCount / timeInterval),
-                 (float)(timeInterval / g_UIState.FrameStatLastFrameCount));
+                 (float)(timeInterval / g_UIState.FrameStatLastFrameCount),
+                 frameStats.PresentInterval.Count ? frameStats.PresentInterval.P99
+                                                  : frameStats.Cpu.P99,
+                 frameStats.HitchCount, pRenderContext->GetGpuProfiler()->GetLastFrameMs(),
+                 latencyStats.InputToPresentMs);
     g_UIState.FrameStatLastTimeStamp = g_UIState.Timer.TotalElapsed();
     g_UIState.FrameStatLastFrameCount = 0;
     glfwSetWindowTitle(window, buff);
   }
+
+  /// Where the slow frames waited, logged every few seconds.
+  g_UIState.StallLogLastFrameCount += 1;
+  if (g_UIState.Timer.TotalElapsed() - g_UIState.StallLogLastTimeStamp >= s_StallLogInterval) {
+    auto pRenderContext = reinterpret_cast<VulkanRenderContext *>(glfwGetWindowUserPointer(window));
+    FrameStatsSummary frameStats;
+    if (pRenderContext->CalcFrameStats(&frameStats, g_UIState.StallLogLastFrameCount)) {
+      printf("Frames %llu: p99 %.3f ms, %u hitches\n",
+             (unsigned long long)g_UIState.FrameStatTotalFrameCount,
+             frameStats.PresentInterval.Count ? frameStats.PresentInterval.P99
+                                              : frameStats.Cpu.P99,
+             frameStats.HitchCount);
+      PrintFrameStalls("  ", frameStats);
+    }
+    g_UIState.StallLogLastTimeStamp = g_UIState.Timer.TotalElapsed();
+    g_UIState.StallLogLastFrameCount = 0;
+  }
 }
 
 void OnResizeWindow(GLFWwindow *window, int cx, int cy) {
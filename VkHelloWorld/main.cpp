@@ -1,11 +1,29 @@
 #include <VulkanRenderContext.hpp>
+#include <string.h>
 
 extern VulkanRenderContext *CreateSampleRenderContext();
 extern int RunSample(const char *pTitle, int width, int height, VulkanRenderContext *pRenderContext);
+extern int RunSampleHeadless(const char *pTitle, int width, int height, uint32_t uFrameCount,
+                             VulkanRenderContext *pRenderContext);
+
+int main(int argc, char *argv[]) {
+  bool bHeadless = false;
+  uint32_t uFrameCount = 1000;
+  int i, rc;
+
+  /// --headless [--frames N] renders offscreen for benchmarking.
+  for (i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--headless") == 0)
+      bHeadless = true;
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      uFrameCount = (uint32_t)atoi(argv[++i]);
+  }
 
-int main() {
   auto pRenderContext = CreateSampleRenderContext();
-  int rc = RunSample("TestTriangle", 800, 600, pRenderContext);
+  if (bHeadless)
+    rc = RunSampleHeadless("TestTriangle", 800, 600, uFrameCount, pRenderContext);
+  else
+    rc = RunSample("TestTriangle", 800, 600, pRenderContext);
   SAFE_DELETE(pRenderContext);
   return rc;
 }
\ No newline at end of file
@@ -11,7 +11,13 @@ layout(std140, binding = 0, set = 0) uniform cbPerObject {
 	mat4x4 g_matTexTransform;
 };
 
+/// Written by box_animate.comp, one per draw, indexed by the draw's first instance.
+layout(std430, binding = 0, set = 2) readonly buffer bufDrawOffsets {
+	vec4 g_aDrawOffsets[];
+};
+
 void main() {
-	gl_Position = g_matWorldViewProj * vec4(inputPos, 1.0f);
+	vec3 posW = inputPos + g_aDrawOffsets[gl_InstanceIndex].xyz;
+	gl_Position = g_matWorldViewProj * vec4(posW, 1.0f);
 	vertexTexC = (g_matTexTransform * vec4(inputTexC, 0.0f, 1.0f)).xy;
-}
\ No newline at end of file
+}